@@ -0,0 +1,5 @@
+cmake --build build
+for bench in build/benchmarks/*_bench; do
+    echo "== $(basename "$bench")"
+    "$bench"
+done
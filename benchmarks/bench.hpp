@@ -0,0 +1,42 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+struct BenchResult {
+    double ns_per_op;
+    double mb_per_sec;
+};
+
+// Runs fn `iterations` times after a single warmup call and reports the mean wall time per call. bytes_per_op is
+// only used for the throughput column and may be 0.
+inline auto RunBench(const std::string &name, uint64_t iterations, uint64_t bytes_per_op,
+                     const std::function<void()> &fn) -> BenchResult {
+    fn();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    BenchResult result{};
+    result.ns_per_op = elapsed / static_cast<double>(iterations);
+    result.mb_per_sec =
+        bytes_per_op == 0 ? 0 : (static_cast<double>(bytes_per_op) / (1 << 20)) / (result.ns_per_op / 1e9);
+
+    std::cout << std::left << std::setw(48) << name << std::right << std::setw(14) << std::fixed
+              << std::setprecision(0) << result.ns_per_op << " ns/op";
+    if (bytes_per_op != 0) {
+        std::cout << std::setw(12) << std::setprecision(1) << result.mb_per_sec << " MiB/s";
+    }
+    std::cout << "\n";
+    return result;
+}
+
+#endif // BENCH_HPP
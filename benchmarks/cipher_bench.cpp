@@ -0,0 +1,50 @@
+#include "bench.hpp"
+#include "sodiumcrypto.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+void BenchCipherSuite(SodiumCrypto &crypto, const std::string &suite_name, uint64_t buf_len) {
+    std::vector<unsigned char> plaintext(buf_len, 'x');
+    std::vector<unsigned char> encrypted(buf_len + crypto.EncryptionAddedBytes());
+    std::vector<unsigned char> decrypted(buf_len + crypto.EncryptionAddedBytes());
+    std::vector<unsigned char> header(crypto.EncryptionHeaderLen());
+    std::vector<unsigned char> key(crypto.EncryptionKeyLen());
+    randombytes_buf(key.data(), key.size());
+
+    uint64_t iterations = std::max<uint64_t>(8, (64ULL << 20) / buf_len);
+    std::string size_label = std::to_string(buf_len >> 10) + " KiB";
+
+    RunBench(suite_name + " encrypt " + size_label, iterations, buf_len,
+             [&] { crypto.EncryptBuf(encrypted.data(), header.data(), plaintext.data(), buf_len, key.data()); });
+
+    uint64_t decrypted_len = 0;
+    RunBench(suite_name + " decrypt " + size_label, iterations, buf_len, [&] {
+        crypto.DecryptBuf(decrypted.data(), &decrypted_len, header.data(), encrypted.data(), encrypted.size(),
+                          key.data());
+    });
+}
+
+} // namespace
+
+auto main() -> int {
+    SodiumCrypto crypto;
+    if (crypto.InitCrypto() < 0) {
+        std::cerr << "Failed to init crypto.\n";
+        return -1;
+    }
+
+    for (uint64_t buf_len : {4ULL << 10, 256ULL << 10, 16ULL << 20}) {
+        crypto.SetCipherSuite(CIPHER_XCHACHA20POLY1305);
+        BenchCipherSuite(crypto, "xchacha20poly1305", buf_len);
+
+        if (crypto.SetCipherSuite(CIPHER_AES256GCM) != 0) {
+            std::cout << "aes256gcm unavailable on this host, skipping\n";
+            continue;
+        }
+        BenchCipherSuite(crypto, "aes256gcm", buf_len);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "bench.hpp"
+#include "fstreamfileio.hpp"
+#include "posixfileio.hpp"
+
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Mirrors a store save: a small header segment followed by the body, then a commit over the previous file
+void BenchSave(IFileIO &file_io, const std::string &name, std::vector<unsigned char> &body, uint64_t iterations) {
+    std::array<unsigned char, 96> header{};
+    const std::array<iovec, 2> segments = {{
+        {.iov_base = header.data(), .iov_len = header.size()},
+        {.iov_base = body.data(), .iov_len = body.size()},
+    }};
+
+    RunBench(name + " save", iterations, body.size(), [&] {
+        file_io.OpenWriteTemp();
+        file_io.WriteTempV(segments);
+        file_io.CloseWriteTemp();
+        file_io.CommitTemp();
+    });
+
+    RunBench(name + " load", iterations, body.size(), [&] {
+        file_io.OpenRead(0);
+        file_io.ReadV(segments);
+        file_io.CloseRead();
+    });
+}
+
+} // namespace
+
+auto main() -> int {
+    const std::string dir = "fileio_bench_tmp";
+    std::filesystem::create_directory(dir);
+    const std::string path = dir + "/store";
+
+    for (uint64_t body_len : {4ULL << 10, 1ULL << 20}) {
+        std::vector<unsigned char> body(body_len, 'x');
+        std::string size_label = std::to_string(body_len >> 10) + " KiB";
+        uint64_t iterations = body_len < (1 << 20) ? 200 : 50;
+
+        FStreamFileIO fstream_io(path);
+        BenchSave(fstream_io, "fstream " + size_label, body, iterations);
+
+        PosixFileIO posix_none(path, PosixFileIO::DURABILITY_NONE);
+        BenchSave(posix_none, "posix/none " + size_label, body, iterations);
+
+        PosixFileIO posix_data(path, PosixFileIO::DURABILITY_DATA);
+        BenchSave(posix_data, "posix/data " + size_label, body, iterations);
+
+        PosixFileIO posix_full(path, PosixFileIO::DURABILITY_FULL);
+        BenchSave(posix_full, "posix/full " + size_label, body, iterations);
+
+        PosixFileIO posix_full_generations(path, PosixFileIO::DURABILITY_FULL, 3);
+        BenchSave(posix_full_generations, "posix/full+3 generations " + size_label, body, iterations);
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "argon2id.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <sodium.h>
+#include <thread>
+
+namespace {
+
+const char PASSWORD[] = "correct horse battery staple";
+const uint64_t OPS_LIMIT = crypto_pwhash_OPSLIMIT_MODERATE;
+const uint64_t MEM_LIMIT = crypto_pwhash_MEMLIMIT_MODERATE;
+const uint64_t ITERATIONS = 4;
+
+void BenchArgon2id(const std::string &name, Argon2id &argon2id, uint32_t lanes,
+                   const std::array<unsigned char, crypto_pwhash_SALTBYTES> &salt) {
+    std::array<unsigned char, 32> key = {};
+    RunBench(name, ITERATIONS, MEM_LIMIT, [&] {
+        argon2id.Hash(key, {reinterpret_cast<const unsigned char *>(PASSWORD), strlen(PASSWORD)}, salt, OPS_LIMIT,
+                      MEM_LIMIT / 1024, lanes);
+    });
+}
+
+} // namespace
+
+// Per-unlock latency of the moderate password KDF with libsodium's allocation, a fresh allocation per derivation and
+// the reused, pre-faulted arena
+auto main() -> int {
+    if (sodium_init() < 0) {
+        std::cerr << "Failed to init crypto.\n";
+        return -1;
+    }
+    std::array<unsigned char, crypto_pwhash_SALTBYTES> salt = {};
+    randombytes_buf(salt.data(), salt.size());
+
+    std::array<unsigned char, 32> key = {};
+    RunBench("crypto_pwhash", ITERATIONS, MEM_LIMIT, [&] {
+        crypto_pwhash(key.data(), key.size(), PASSWORD, strlen(PASSWORD), salt.data(), OPS_LIMIT, MEM_LIMIT,
+                      crypto_pwhash_ALG_ARGON2ID13);
+    });
+
+    size_t threads = std::max(1U, std::thread::hardware_concurrency());
+    for (uint32_t lanes : {1U, 4U}) {
+        std::string lanes_label = std::to_string(lanes) + (lanes == 1 ? " lane" : " lanes");
+        Argon2id fresh(threads);
+        BenchArgon2id("argon2id fresh allocation, " + lanes_label, fresh, lanes, salt);
+
+        Argon2id reused(threads, true);
+        BenchArgon2id("argon2id arena, " + lanes_label, reused, lanes, salt);
+    }
+    return 0;
+}
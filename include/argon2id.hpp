@@ -0,0 +1,35 @@
+#ifndef ARGON2ID_HPP
+#define ARGON2ID_HPP
+
+#include "kdfarena.hpp"
+#include "threadpool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+
+// Argon2id version 1.3 as specified in RFC 9106, on top of libsodium's BLAKE2b. libsodium only fills a single lane;
+// here the lanes of each slice are filled in parallel on a thread pool, so a derivation with p lanes takes roughly
+// 1/p of the time of one lane over the same memory.
+class Argon2id {
+  public:
+    static const uint32_t MAX_LANES = 0xffffff;
+    static const size_t MIN_OUT_LEN = 16;
+    static const size_t MIN_SALT_LEN = 8;
+
+    // With fewer than two threads every lane is filled on the calling thread. With reuse_memory the blocks come from
+    // a KdfArena kept between calls instead of a fresh allocation, so concurrent calls to Hash must be serialized.
+    explicit Argon2id(size_t threads, bool reuse_memory = false);
+
+    // m_cost is in KiB and is rounded down to a multiple of 4 * lanes blocks; secret and ad are the optional key and
+    // associated data of the RFC
+    auto Hash(std::span<unsigned char> out, std::span<const unsigned char> password,
+              std::span<const unsigned char> salt, uint32_t t_cost, uint32_t m_cost, uint32_t lanes,
+              std::span<const unsigned char> secret = {}, std::span<const unsigned char> ad = {}) -> int;
+
+  private:
+    std::unique_ptr<ThreadPool> pool_;
+    std::unique_ptr<KdfArena> arena_;
+};
+
+#endif // ARGON2ID_HPP
@@ -0,0 +1,69 @@
+#ifndef CARDINDEX_HPP
+#define CARDINDEX_HPP
+
+#include "creditcard.hpp"
+#include "idbitmap.hpp"
+#include "recorddirectory.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Tags match case-insensitively. Every list that is not empty must be satisfied.
+struct CardFilter {
+    std::vector<std::string> all_tags;             // cards carrying every one of these tags
+    std::vector<std::string> any_tags;             // cards carrying at least one of these tags
+    std::vector<std::string> none_tags;            // cards carrying none of these tags
+    std::vector<CreditCard::CardNetwork> networks; // cards on any of these networks
+};
+
+// In-memory secondary indexes over the directory entries: exact and prefix lookups by normalized name, exact lookups by
+// card number fingerprint, range lookups by packed expiry, and bitmaps per tag and per network for filtering. Store
+// keeps it in step with its directory.
+class CardIndex {
+  public:
+    void Insert(const RecordDirectory::Entry &entry);
+    void Remove(const RecordDirectory::Entry &entry);
+    void Clear();
+
+    // Each lookup returns the matching ids, in ascending order for exact matches and in name order for prefixes
+    auto FindByName(const std::string &name) const -> std::vector<uint32_t>;
+    auto FindByNamePrefix(const std::string &prefix) const -> std::vector<uint32_t>;
+    auto FindByFingerprint(const RecordDirectory::Fingerprint &fingerprint) const -> std::vector<uint32_t>;
+    auto ContainsFingerprint(const RecordDirectory::Fingerprint &fingerprint) const -> bool;
+    // Expiry lookups return ids in expiry order and skip cards without an expiry; both bounds are inclusive
+    auto FindByExpiry(uint16_t first, uint16_t last) const -> std::vector<uint32_t>;
+    auto ExpiryOrder() const -> std::vector<uint32_t>;
+    // Ids in ascending order
+    auto Filter(const CardFilter &filter) const -> std::vector<uint32_t>;
+
+    // Names compare case-insensitively
+    static auto NormalizeName(const std::string &name) -> std::string;
+
+  private:
+    // Fingerprints are keyed hashes, so any of their bytes are already uniformly distributed
+    struct FingerprintHash {
+        auto operator()(const RecordDirectory::Fingerprint &fingerprint) const -> size_t {
+            size_t hash = 0;
+            memcpy(&hash, fingerprint.data(), sizeof(hash));
+            return hash;
+        }
+    };
+
+    std::unordered_map<std::string, std::vector<uint32_t>> by_name_;
+    std::set<std::pair<std::string, uint32_t>> name_order_;
+    std::unordered_map<RecordDirectory::Fingerprint, std::vector<uint32_t>, FingerprintHash> by_fingerprint_;
+    std::set<std::pair<uint16_t, uint32_t>> by_expiry_;
+    IdBitmap all_ids_;
+    std::unordered_map<std::string, IdBitmap> by_tag_;
+    std::unordered_map<uint8_t, IdBitmap> by_network_;
+
+    static auto Lookup(const std::unordered_map<std::string, IdBitmap> &bitmaps, const std::string &key)
+        -> const IdBitmap &;
+};
+
+#endif // CARDINDEX_HPP
@@ -0,0 +1,47 @@
+#ifndef CARDORDERS_HPP
+#define CARDORDERS_HPP
+
+#include "recorddirectory.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Cached permutations of the directory entries, one per sort order. Each is kept sorted as entries are inserted and
+// removed, so listing cards in any order is a walk over an array. Store keeps it in step with its directory.
+class CardOrders {
+  public:
+    enum Order {
+        ORDER_CREATED = 0,
+        ORDER_NAME,
+        ORDER_NETWORK,
+        ORDER_EXPIRY,
+        ORDER_LAST_USED,
+        ORDER_COUNT,
+    };
+
+    void Insert(const RecordDirectory::Entry &entry);
+    void Remove(const RecordDirectory::Entry &entry);
+    void Clear();
+
+    // Names compare case-insensitively and break ties in the other orders; cards without an expiry or never used
+    // come last, and the most recently used card comes first
+    auto Ids(Order order) const -> const std::vector<uint32_t> &;
+
+  private:
+    struct SortKey {
+        uint64_t primary;
+        std::string name;
+        uint32_t id;
+
+        auto operator<(const SortKey &other) const -> bool;
+    };
+
+    std::array<std::vector<SortKey>, ORDER_COUNT> keys_;
+    std::array<std::vector<uint32_t>, ORDER_COUNT> ids_; // ids_[order][i] is keys_[order][i].id
+
+    static auto MakeKey(Order order, const RecordDirectory::Entry &entry) -> SortKey;
+};
+
+#endif // CARDORDERS_HPP
@@ -3,6 +3,7 @@
 
 #include "ui.hpp"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -11,31 +12,46 @@ class CreditCard {
     friend class CreditCardTest;
 
   public:
+    enum CardNetwork {
+        CARD_OTHER = 0,
+        CARD_VISA,
+        CARD_MASTERCARD,
+        CARD_AMEX,
+        CARD_DISCOVER,
+    };
+
+    static const size_t MAX_TAGS = 16;
+    static const size_t MAX_TAG_LEN = 32;
+
     auto SetName(const std::string &name) -> int;
     auto SetCardNumber(const std::string &card_number) -> int;
     auto SetCvv(const std::string &cvv) -> int;
     auto SetMonth(const std::string &month) -> int;
     auto SetYear(const std::string &year) -> int;
+    // Tags are letters and digits only and compare case-insensitively, so they are kept lower-cased, sorted and unique
+    auto SetTags(const std::vector<std::string> &tags) -> int;
 
     auto GetName() const -> std::string;
+    auto GetCardNumber() const -> std::string;
+    auto GetNetwork() const -> CardNetwork;
+    auto GetTags() const -> const std::vector<std::string> &;
+    // Expiry packed as year * 12 + month, so keys order by date and consecutive months are consecutive keys; 0 if unset
+    auto GetExpiryKey() const -> uint16_t;
+    static auto PackExpiry(int month, int year) -> uint16_t;
 
     auto FormatText() const -> std::string;
     void InitFromText(char *text);
 
-  private:
-    enum CardNetwork {
-        CARD_OTHER = 0,
-        CARD_VISA,
-        CARD_MASTERCARD,
-        CARD_AMEX,
-        CARD_DISCOVER,
-    };
+    static auto JoinTags(const std::vector<std::string> &tags) -> std::string;
+    static auto SplitTags(const std::string &text) -> std::vector<std::string>;
 
+  private:
     std::string card_number_;
     std::string cvv_;
     std::string month_;
     std::string year_;
-    CardNetwork network_;
+    CardNetwork network_ = CARD_OTHER;
+    std::vector<std::string> tags_;
 
     std::string name_;
     std::string default_name_;
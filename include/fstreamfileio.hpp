@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <fstream>
 #include <ios>
+#include <mutex>
 #include <string>
 
 class FStreamFileIO : public IFileIO {
@@ -17,9 +18,14 @@ class FStreamFileIO : public IFileIO {
 
     auto Read(char *buf, int64_t stream_size) -> bool override;
     auto WriteTemp(const char *buf, int64_t stream_size) -> bool override;
+    auto ReadV(std::span<const iovec> segments) -> bool override;
+    auto WriteTempV(std::span<const iovec> segments) -> bool override;
+    auto ReadAt(char *buf, int64_t len, uint64_t offset) -> bool override;
+    auto CopyToTemp(uint64_t offset, uint64_t len) -> bool override;
+    auto SeekWriteTemp(uint64_t offset) -> bool override;
     auto CommitTemp() -> int override;
 
-    auto OpenRead() -> int override;
+    auto OpenRead(uint32_t generation) -> int override;
     auto OpenWriteTemp() -> int override;
 
     void CloseRead() override;
@@ -29,12 +35,15 @@ class FStreamFileIO : public IFileIO {
     auto GetPositionWriteTemp() -> int64_t override;
 
     auto GetSize(bool temp) -> uintmax_t override;
+    auto GetSizeRead() -> uintmax_t override;
     auto GetExists(bool temp) -> bool override;
     auto Delete(bool temp) -> bool override;
 
   private:
     std::ifstream in_stream_;
+    std::mutex read_at_mutex_; // a positional read moves in_stream_ and puts it back
     std::ofstream out_stream_;
+    std::string read_path_;
 
     const std::string FILE_PATH;
     const std::string TMP_FILE_PATH;
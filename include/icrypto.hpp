@@ -5,28 +5,83 @@
 #include <cstdlib>
 #include <string>
 
+enum CipherSuiteId : uint8_t {
+    CIPHER_XCHACHA20POLY1305 = 0,
+    CIPHER_AES256GCM,
+};
+
 class ICrypto {
   public:
+    // Upper bounds on HashLen(), SaltLen(), EncryptionKeyLen() and EncryptionHeaderLen(), so callers can size fixed
+    // buffers; every implementation stays within them. An implementation whose hash, salt and key sizes never change
+    // hides these with its exact sizes and sets FIXED_KEY_SIZES.
+    static constexpr bool FIXED_KEY_SIZES = false;
+    static constexpr uint64_t MAX_HASH_LEN = 128;
+    static constexpr uint64_t MAX_SALT_LEN = 32;
+    static constexpr uint64_t MAX_ENCRYPTION_KEY_LEN = 64;
+    static constexpr uint64_t MAX_ENCRYPTION_HEADER_LEN = 32;
+
     virtual auto InitCrypto() -> int = 0;
 
+    virtual auto GetCipherSuite() const -> uint8_t = 0;
+    virtual auto SetCipherSuite(uint8_t cipher_suite) -> int = 0;
+
     virtual auto EncryptionAddedBytes() const -> uint64_t = 0;
     virtual auto EncryptionHeaderLen() const -> uint64_t = 0;
+    virtual auto EncryptionInPlaceOffset() const -> uint64_t = 0;
     virtual auto EncryptionKeyLen() const -> uint64_t = 0;
+    virtual auto RecordAddedBytes() const -> uint64_t = 0;
     virtual auto HashLen() const -> uint64_t = 0;
     virtual auto SaltLen() const -> uint64_t = 0;
 
     virtual auto DeriveEncryptionKey(unsigned char *key, size_t key_len, const unsigned char *password,
                                      const unsigned char *salt) -> int = 0;
+    // The same derivation under explicit limits, for keys that record their own; DeriveEncryptionKey uses
+    // KdfOpsLimit() and KdfMemLimit()
+    virtual auto DeriveEncryptionKeyWithLimits(unsigned char *key, size_t key_len, const unsigned char *password,
+                                               const unsigned char *salt, uint64_t ops_limit, uint64_t mem_limit)
+        -> int = 0;
+    virtual auto KdfOpsLimit() const -> uint64_t = 0;
+    virtual auto KdfMemLimit() const -> uint64_t = 0;
+    // DeriveEncryptionKey fills the KDF memory in KdfLanes() lanes; the lane count is an input of the derivation, so a
+    // key only comes back under the count it was derived with
+    virtual auto KdfLanes() const -> uint32_t = 0;
+    virtual auto SetKdfLanes(uint32_t lanes) -> int = 0;
     virtual auto EncryptBuf(unsigned char *out_data, unsigned char *header, const unsigned char *buf, uintmax_t buf_len,
                             const unsigned char *key) -> int = 0;
+    // In-place variants: buf holds the plaintext at buf + EncryptionInPlaceOffset() and must have room for
+    // buf_len + EncryptionAddedBytes() bytes; on success buf holds the ciphertext. Decryption leaves the plaintext at
+    // encrypted_buf + EncryptionInPlaceOffset().
+    virtual auto EncryptBufInPlace(unsigned char *buf, unsigned char *header, uintmax_t buf_len,
+                                   const unsigned char *key) -> int = 0;
+    virtual auto DecryptBufInPlace(unsigned char *encrypted_buf, uint64_t *out_len, unsigned char *header,
+                                   uintmax_t buf_len, const unsigned char *key) -> int = 0;
+    // Record variants seal one self-contained record as nonce || ciphertext || tag, buf_len + RecordAddedBytes() bytes,
+    // bound to ad so a record cannot be replayed under another identity
+    virtual auto EncryptRecord(unsigned char *out_record, const unsigned char *buf, uintmax_t buf_len,
+                               const unsigned char *ad, uint64_t ad_len, const unsigned char *key) -> int = 0;
+    virtual auto DecryptRecord(unsigned char *out_data, uint64_t *out_len, const unsigned char *record,
+                               uintmax_t record_len, const unsigned char *ad, uint64_t ad_len,
+                               const unsigned char *key) -> int = 0;
+    // Keys for anything other than encryption are derived from the encryption key, one per subkey_id, so a single
+    // password hash unlocks them all. Subkeys are EncryptionKeyLen() bytes.
+    virtual auto DeriveSubkey(unsigned char *subkey, uint64_t subkey_id, const unsigned char *key) -> int = 0;
+    // Keyed BLAKE2b of in, out_len between 16 and 64 bytes, under a key of EncryptionKeyLen() bytes
+    virtual auto KeyedHash(unsigned char *out, size_t out_len, const unsigned char *in, uint64_t in_len,
+                           const unsigned char *key) -> int = 0;
     virtual auto HashPassword(unsigned char *hash, const unsigned char *password) -> int = 0;
     virtual void GenerateSalt(unsigned char *salt) = 0;
+    // Fills key with EncryptionKeyLen() random bytes
+    virtual void GenerateKey(unsigned char *key) = 0;
 
     virtual auto DecryptBuf(unsigned char *out_data, uint64_t *out_len, unsigned char *header,
                             unsigned char *encrypted_buf, uintmax_t buf_len, const unsigned char *key) -> int = 0;
     virtual auto VerifyPasswordHash(const unsigned char *hash, const unsigned char *password) -> int = 0;
 
     virtual void Memzero(void *ptr, size_t len) = 0;
+    // Guarded, swap-locked allocation for plaintext that outlives a single call; SecureFree wipes it
+    virtual auto SecureAlloc(size_t len) -> void * = 0;
+    virtual void SecureFree(void *ptr) = 0;
 };
 
 #endif // ICRYPTO_HPP
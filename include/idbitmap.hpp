@@ -0,0 +1,52 @@
+#ifndef IDBITMAP_HPP
+#define IDBITMAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Compressed set of record ids in the style of a roaring bitmap. Ids are split by their high 16 bits into containers;
+// a container holds a sorted array of the low 16 bits while sparse and switches to a 65536-bit bitset once dense, so
+// set operations work on whole words wherever both sides are dense.
+class IdBitmap {
+  public:
+    void Add(uint32_t id);
+    void Remove(uint32_t id);
+    auto Contains(uint32_t id) const -> bool;
+    auto Cardinality() const -> uint64_t;
+    auto Empty() const -> bool;
+    // Ids in ascending order
+    auto ToVector() const -> std::vector<uint32_t>;
+
+    auto And(const IdBitmap &other) const -> IdBitmap;
+    auto Or(const IdBitmap &other) const -> IdBitmap;
+    auto AndNot(const IdBitmap &other) const -> IdBitmap;
+
+  private:
+    static const uint32_t ARRAY_MAX = 4096; // past this many values a bitset is smaller than an array
+    static const uint32_t BITSET_WORDS = 65536 / 64;
+
+    // Exactly one of array and bitset is in use
+    struct Container {
+        uint16_t key;
+        uint32_t cardinality;
+        std::vector<uint16_t> array;
+        std::vector<uint64_t> bitset;
+
+        auto IsBitset() const -> bool { return !this->bitset.empty(); }
+        auto Contains(uint16_t low) const -> bool;
+        void ToBitset();
+        void ToArray();
+        // Picks the smaller representation after an operation; false if the container ended up empty
+        auto Normalize() -> bool;
+    };
+
+    std::vector<Container> containers_; // sorted by key
+
+    auto Find(uint16_t key) const -> const Container *;
+
+    static auto AndContainers(const Container &a, const Container &b) -> Container;
+    static auto OrContainers(const Container &a, const Container &b) -> Container;
+    static auto AndNotContainers(const Container &a, const Container &b) -> Container;
+};
+
+#endif // IDBITMAP_HPP
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <ios>
+#include <span>
+#include <sys/uio.h>
 
 class IFileIO {
   public:
@@ -10,9 +12,24 @@ class IFileIO {
 
     virtual auto Read(char *buf, int64_t stream_size) -> bool = 0;
     virtual auto WriteTemp(const char *buf, int64_t stream_size) -> bool = 0;
+
+    // Scatter/gather variants: true only if every segment was transferred in full
+    virtual auto ReadV(std::span<const iovec> segments) -> bool = 0;
+    virtual auto WriteTempV(std::span<const iovec> segments) -> bool = 0;
+
+    // Positional read from the file opened by OpenRead; does not move the read position
+    virtual auto ReadAt(char *buf, int64_t len, uint64_t offset) -> bool = 0;
+    // Appends len bytes of the file opened by OpenRead, starting at offset, to the temp file
+    virtual auto CopyToTemp(uint64_t offset, uint64_t len) -> bool = 0;
+    // ReadAt and CopyToTemp must be safe to call from several threads at once: the store reads records on its own
+    // thread while a background save or key rotation reads the same file. Everything else is called from one thread.
+    // Moves the temp file's write position, so a range skipped over can be filled in once its contents are known
+    virtual auto SeekWriteTemp(uint64_t offset) -> bool = 0;
+
     virtual auto CommitTemp() -> int = 0;
 
-    virtual auto OpenRead() -> int = 0;
+    // generation 0 is the live store, 1 its most recent backup, and so on
+    virtual auto OpenRead(uint32_t generation) -> int = 0;
     virtual auto OpenWriteTemp() -> int = 0;
 
     virtual void CloseRead() = 0;
@@ -22,8 +39,9 @@ class IFileIO {
     virtual auto GetPositionWriteTemp() -> int64_t = 0;
 
     virtual auto GetSize(bool temp) -> uintmax_t = 0;
+    virtual auto GetSizeRead() -> uintmax_t = 0; // size of the file opened by OpenRead
     virtual auto GetExists(bool temp) -> bool = 0;
-    virtual auto Delete(bool temp) -> bool = 0; 
+    virtual auto Delete(bool temp) -> bool = 0;
 };
 
 #endif // IFILEIO_HPP
@@ -0,0 +1,21 @@
+#ifndef IKEYCACHE_HPP
+#define IKEYCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Short-lived cache of secrets kept outside the process, so a later process can pick them up by name
+class IKeyCache {
+  public:
+    virtual ~IKeyCache() = default;
+
+    // Replaces any entry of the same name; the entry expires after timeout_seconds
+    virtual auto Put(const std::string &name, const unsigned char *data, size_t len, uint32_t timeout_seconds)
+        -> int = 0;
+    // Returns the entry's length, or -1 if there is none or it does not fit in len bytes
+    virtual auto Get(const std::string &name, unsigned char *data, size_t len) -> int64_t = 0;
+    virtual void Remove(const std::string &name) = 0;
+};
+
+#endif // IKEYCACHE_HPP
@@ -0,0 +1,37 @@
+#ifndef KDFARENA_HPP
+#define KDFARENA_HPP
+
+#include <cstddef>
+
+// Memory for the password KDF, mapped once and kept across derivations so later unlocks neither fault in nor zero
+// fresh pages. The mapping prefers explicit huge pages, then transparent huge pages, to cut the TLB misses of the KDF's
+// random block references, and is faulted in up front. Release wipes whatever was handed out.
+class KdfArena {
+  public:
+    KdfArena() = default;
+    ~KdfArena();
+
+    KdfArena(const KdfArena &) = delete;
+    auto operator=(const KdfArena &) -> KdfArena & = delete;
+
+    // At least len bytes aligned to a page, valid until the next Acquire; a larger len remaps the arena. Null if the
+    // memory cannot be mapped.
+    auto Acquire(size_t len) -> void *;
+    void Release();
+
+    auto Capacity() const -> size_t;
+    // Whether the mapping is backed by reserved huge pages rather than only advised to use transparent ones
+    auto HugeTlb() const -> bool;
+
+  private:
+    static const size_t HUGE_PAGE_LEN = 2 << 20;
+
+    void *base_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    bool huge_tlb_ = false;
+
+    void Unmap();
+};
+
+#endif // KDFARENA_HPP
@@ -0,0 +1,17 @@
+#ifndef KEYRINGKEYCACHE_HPP
+#define KEYRINGKEYCACHE_HPP
+
+#include "ikeycache.hpp"
+
+// Entries are "user" keys in the Linux user session keyring, which the kernel keeps in unswappable memory and drops
+// once they time out. Only processes that possess that keyring, as keyrings(7) defines it, can read them. Every call
+// fails on other systems.
+class KeyringKeyCache final : public IKeyCache {
+  public:
+    auto Put(const std::string &name, const unsigned char *data, size_t len, uint32_t timeout_seconds)
+        -> int override;
+    auto Get(const std::string &name, unsigned char *data, size_t len) -> int64_t override;
+    void Remove(const std::string &name) override;
+};
+
+#endif // KEYRINGKEYCACHE_HPP
@@ -0,0 +1,85 @@
+#ifndef POSIXFILEIO_HPP
+#define POSIXFILEIO_HPP
+
+#include "ifileio.hpp"
+
+#include <cstdint>
+#include <string>
+
+class PosixFileIO final : public IFileIO {
+    friend class PosixFileIOTest;
+
+  public:
+    enum Durability : uint8_t {
+        DURABILITY_NONE = 0, // leave flushing to the kernel
+        DURABILITY_DATA,     // fdatasync the temp file before it is renamed over the store
+        DURABILITY_FULL,     // additionally fsync the directory so the rename itself survives a crash
+    };
+
+    // Each commit retires the store it replaces to "<file_path>.bak.1", shifting older backups up, and keeps at most
+    // `generations` of them
+    explicit PosixFileIO(const std::string &file_path, Durability durability = DURABILITY_FULL,
+                         uint32_t generations = 0);
+    ~PosixFileIO() override;
+
+    PosixFileIO(const PosixFileIO &) = delete;
+    auto operator=(const PosixFileIO &) -> PosixFileIO & = delete;
+
+    auto Read(char *buf, int64_t stream_size) -> bool override;
+    auto WriteTemp(const char *buf, int64_t stream_size) -> bool override;
+    auto ReadV(std::span<const iovec> segments) -> bool override;
+    auto WriteTempV(std::span<const iovec> segments) -> bool override;
+    auto ReadAt(char *buf, int64_t len, uint64_t offset) -> bool override;
+    auto CopyToTemp(uint64_t offset, uint64_t len) -> bool override;
+    auto SeekWriteTemp(uint64_t offset) -> bool override;
+    auto CommitTemp() -> int override;
+
+    auto OpenRead(uint32_t generation) -> int override;
+    auto OpenWriteTemp() -> int override;
+
+    void CloseRead() override;
+    void CloseWriteTemp() override;
+
+    auto GetPositionRead() -> int64_t override;
+    auto GetPositionWriteTemp() -> int64_t override;
+
+    auto GetSize(bool temp) -> uintmax_t override;
+    auto GetSizeRead() -> uintmax_t override;
+    auto GetExists(bool temp) -> bool override;
+    auto Delete(bool temp) -> bool override;
+
+  private:
+    static const uint64_t PREALLOCATE_MIN_LEN = 64 * 1024;
+
+    int read_fd_ = -1;
+    int write_fd_ = -1;
+    int pending_fd_ = -1; // closed anonymous temp awaiting CommitTemp; closing it would discard the inode
+    int64_t read_pos_ = 0;
+    int64_t write_pos_ = 0;
+    bool write_failed_ = false;
+    bool anonymous_temp_ = false;
+    Durability durability_;
+    uint32_t generations_;
+
+    const std::string FILE_PATH;
+    const std::string TMP_FILE_PATH;
+    const std::string SNAPSHOT_FILE_PATH; // copy of the store taken ahead of a commit without RENAME_EXCHANGE
+    // The replaced store until it becomes the first backup, only ever renamed here once the new store is published
+    const std::string OLD_FILE_PATH;
+    const std::string DIR_PATH;
+
+    auto OpenAnonymousTemp() -> int;
+    auto LinkAnonymousTemp(const std::string &path) -> int;
+    auto ReplaceStore() -> int;
+    auto RetireStore(const std::string &path) -> int;
+    void RetireLeftovers();
+    void ShiftGenerations();
+    auto SnapshotStore(const std::string &path) -> int;
+    void DiscardTemp();
+    auto HasAnonymousTemp() const -> bool;
+
+    auto DeleteFile(const std::string &path) -> bool;
+    auto SyncDir() -> int;
+};
+
+#endif // POSIXFILEIO_HPP
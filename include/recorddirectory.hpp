@@ -0,0 +1,77 @@
+#ifndef RECORDDIRECTORY_HPP
+#define RECORDDIRECTORY_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Maps persistent record ids to card names and to the location of each sealed record in the store's record region.
+// Entries stay sorted by id since ids are only ever handed out in increasing order.
+class RecordDirectory {
+  public:
+    static constexpr uint8_t FORMAT_VERSION = 5;
+    static constexpr uint64_t NOT_STORED = UINT64_MAX; // offset of a record that has not been written yet
+    static constexpr size_t FINGERPRINT_LEN = 16;
+
+    using Fingerprint = std::array<unsigned char, FINGERPRINT_LEN>;
+
+    struct Location {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    // Searchable attributes of a card, kept in the encrypted directory so indexes are built without opening records
+    struct Metadata {
+        Fingerprint fingerprint; // keyed hash of the card number; all zero for a card without one
+        uint16_t expiry;         // packed expiry key, see CreditCard::GetExpiryKey; 0 for a card without one
+        uint8_t network;         // CreditCard::CardNetwork
+        uint64_t last_used;      // Store's use counter when the card was last opened; 0 if it never was
+        // At most 255 tags of at most 255 bytes each; CreditCard keeps well within both
+        std::vector<std::string> tags;
+    };
+
+    struct Entry {
+        uint32_t id;
+        Location location;
+        std::string name;
+        Metadata metadata;
+    };
+
+    auto Add(const std::string &name, const Metadata &metadata = {}) -> uint32_t;
+    auto Remove(uint32_t id) -> bool;
+    auto SetMetadata(uint32_t id, const Metadata &metadata) -> bool;
+    auto SetLocation(uint32_t id, const Location &location) -> bool;
+    void Clear();
+
+    auto Find(uint32_t id) const -> const Entry *;
+    auto Entries() const -> const std::vector<Entry> &;
+    auto Size() const -> size_t;
+    // Format version the directory was parsed from; entries parsed from an older version have empty metadata
+    auto Version() const -> uint8_t;
+
+    // locations[i] replaces the location of the i-th entry, for a directory describing a rewritten record region
+    void SetLocations(const std::vector<Location> &locations);
+
+    auto SerializedSize() const -> uint64_t;
+    void Serialize(unsigned char *buf, const std::vector<Location> &locations) const;
+    // Rejects malformed input and any entry that does not fit in a record region of records_len bytes
+    auto Parse(const unsigned char *buf, uint64_t len, uint64_t records_len) -> int;
+
+  private:
+    // version, next id, entry count
+    static const uint64_t PREAMBLE_LEN = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+    // id, offset, length, fingerprint (since version 2), expiry (since version 3), network and tag count (since
+    // version 4), last used (since version 5), name length; the name follows, then each tag as a one byte length and
+    // its bytes
+    static const uint64_t V1_ENTRY_FIXED_LEN =
+        sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t);
+
+    uint8_t version_ = FORMAT_VERSION;
+    uint32_t next_id_ = 0;
+    std::vector<Entry> entries_;
+
+    static auto EntryFixedLen(uint8_t version) -> uint64_t;
+};
+
+#endif // RECORDDIRECTORY_HPP
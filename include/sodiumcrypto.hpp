@@ -1,29 +1,70 @@
 #ifndef SODIUMCRYPTO_HPP
 #define SODIUMCRYPTO_HPP
 
+#include "argon2id.hpp"
 #include "icrypto.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <sodium.h>
 
-class SodiumCrypto : public ICrypto {
+class SodiumCrypto final : public ICrypto {
   public:
+    static constexpr bool FIXED_KEY_SIZES = true;
+    static constexpr uint64_t MAX_HASH_LEN = crypto_pwhash_STRBYTES;
+    static constexpr uint64_t MAX_SALT_LEN = crypto_pwhash_SALTBYTES;
+    static constexpr uint64_t MAX_ENCRYPTION_KEY_LEN = crypto_secretstream_xchacha20poly1305_KEYBYTES;
+    static constexpr uint64_t MAX_ENCRYPTION_HEADER_LEN =
+        std::max<uint64_t>(crypto_secretstream_xchacha20poly1305_HEADERBYTES, crypto_aead_aes256gcm_NPUBBYTES);
+    static constexpr uint32_t MAX_KDF_LANES = 16;
+
     auto InitCrypto() -> int override;
 
+    static auto PreferredCipherSuite() -> uint8_t;
+    auto GetCipherSuite() const -> uint8_t override;
+    auto SetCipherSuite(uint8_t cipher_suite) -> int override;
+
     auto EncryptionAddedBytes() const -> uint64_t override;
     auto EncryptionHeaderLen() const -> uint64_t override;
+    auto EncryptionInPlaceOffset() const -> uint64_t override;
     auto EncryptionKeyLen() const -> uint64_t override;
+    auto RecordAddedBytes() const -> uint64_t override;
     auto HashLen() const -> uint64_t override;
     auto SaltLen() const -> uint64_t override;
 
     auto DeriveEncryptionKey(unsigned char *key, size_t key_len, const unsigned char *password,
                              const unsigned char *salt) -> int override;
+    auto DeriveEncryptionKeyWithLimits(unsigned char *key, size_t key_len, const unsigned char *password,
+                                       const unsigned char *salt, uint64_t ops_limit, uint64_t mem_limit)
+        -> int override;
+    auto KdfOpsLimit() const -> uint64_t override;
+    auto KdfMemLimit() const -> uint64_t override;
+    static auto PreferredKdfLanes() -> uint32_t;
+    auto KdfLanes() const -> uint32_t override;
+    auto SetKdfLanes(uint32_t lanes) -> int override;
 
     auto EncryptBuf(unsigned char *out_data, unsigned char *header, const unsigned char *buf, uintmax_t buf_len,
                     const unsigned char *key) -> int override;
 
+    auto EncryptBufInPlace(unsigned char *buf, unsigned char *header, uintmax_t buf_len, const unsigned char *key)
+        -> int override;
+    auto DecryptBufInPlace(unsigned char *encrypted_buf, uint64_t *out_len, unsigned char *header, uintmax_t buf_len,
+                           const unsigned char *key) -> int override;
+
+    auto EncryptRecord(unsigned char *out_record, const unsigned char *buf, uintmax_t buf_len, const unsigned char *ad,
+                       uint64_t ad_len, const unsigned char *key) -> int override;
+    auto DecryptRecord(unsigned char *out_data, uint64_t *out_len, const unsigned char *record, uintmax_t record_len,
+                       const unsigned char *ad, uint64_t ad_len, const unsigned char *key) -> int override;
+
+    auto DeriveSubkey(unsigned char *subkey, uint64_t subkey_id, const unsigned char *key) -> int override;
+    auto KeyedHash(unsigned char *out, size_t out_len, const unsigned char *in, uint64_t in_len,
+                   const unsigned char *key) -> int override;
+
     auto HashPassword(unsigned char *hash, const unsigned char *password) -> int override;
 
     void GenerateSalt(unsigned char *salt) override;
+    void GenerateKey(unsigned char *key) override;
 
     auto DecryptBuf(unsigned char *out_data, uint64_t *out_len, unsigned char *header, unsigned char *encrypted_buf,
                     uintmax_t buf_len, const unsigned char *key) -> int override;
@@ -31,17 +72,52 @@ class SodiumCrypto : public ICrypto {
     auto VerifyPasswordHash(const unsigned char *hash, const unsigned char *password) -> int override;
 
     void Memzero(void *ptr, size_t len) override;
+    auto SecureAlloc(size_t len) -> void * override;
+    void SecureFree(void *ptr) override;
 
   private:
     static const uint64_t ENCRYPTION_ADDED_BYTES = crypto_secretstream_xchacha20poly1305_ABYTES;
     static const uint64_t ENCRYPTION_HEADER_LEN = crypto_secretstream_xchacha20poly1305_HEADERBYTES;
     static const uint64_t ENCRYPTION_KEY_LEN = crypto_secretstream_xchacha20poly1305_KEYBYTES;
+    static const uint64_t ENCRYPTION_IN_PLACE_OFFSET = 1; // secretstream prefixes the ciphertext with the encrypted tag
+    static const uint64_t AES_ENCRYPTION_ADDED_BYTES = crypto_aead_aes256gcm_ABYTES;
+    static const uint64_t AES_ENCRYPTION_HEADER_LEN = crypto_aead_aes256gcm_NPUBBYTES;
+    static const uint64_t AES_ENCRYPTION_IN_PLACE_OFFSET = 0;
+    static const uint64_t RECORD_NONCE_LEN = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    static const uint64_t RECORD_ADDED_BYTES = RECORD_NONCE_LEN + crypto_aead_xchacha20poly1305_ietf_ABYTES;
+    static const uint64_t AES_RECORD_ADDED_BYTES = AES_ENCRYPTION_HEADER_LEN + AES_ENCRYPTION_ADDED_BYTES;
+    static_assert(crypto_aead_xchacha20poly1305_ietf_KEYBYTES == ENCRYPTION_KEY_LEN,
+                  "record and stream ciphers must share a key length");
+    static_assert(crypto_aead_aes256gcm_KEYBYTES == ENCRYPTION_KEY_LEN, "cipher suites must share a key length");
+    static_assert(crypto_kdf_KEYBYTES == ENCRYPTION_KEY_LEN && crypto_generichash_KEYBYTES == ENCRYPTION_KEY_LEN,
+                  "subkeys are derived from and sized like the encryption key");
+    static constexpr char SUBKEY_CONTEXT[crypto_kdf_CONTEXTBYTES + 1] = "WCsubkey";
     static const uint64_t HASH_LEN = crypto_pwhash_STRBYTES;
     static const uint64_t SALT_LEN = crypto_pwhash_SALTBYTES;
 
     static const uint64_t HASH_ALG = crypto_pwhash_ALG_ARGON2ID13;
     static const uint64_t OPS_LIMIT = crypto_pwhash_OPSLIMIT_MODERATE;
     static const uint64_t MEM_LIMIT = crypto_pwhash_MEMLIMIT_MODERATE;
+    static constexpr uint32_t PREFERRED_MAX_KDF_LANES = 4;
+
+    uint8_t cipher_suite_ = CIPHER_XCHACHA20POLY1305;
+    uint32_t kdf_lanes_ = 1;
+    std::unique_ptr<Argon2id> argon2id_; // started by the first derivation with more than one lane, then kept
+    std::mutex argon2id_mutex_;
+
+    static auto EncryptBufXChaCha20(unsigned char *out_data, unsigned char *header, const unsigned char *buf,
+                                    uintmax_t buf_len, const unsigned char *key) -> int;
+    static auto EncryptBufAes256Gcm(unsigned char *out_data, unsigned char *header, const unsigned char *buf,
+                                    uintmax_t buf_len, const unsigned char *key) -> int;
+    static auto DecryptBufXChaCha20(unsigned char *out_data, uint64_t *out_len, unsigned char *header,
+                                    unsigned char *encrypted_buf, uintmax_t buf_len, const unsigned char *key) -> int;
+    static auto DecryptBufAes256Gcm(unsigned char *out_data, uint64_t *out_len, unsigned char *header,
+                                    unsigned char *encrypted_buf, uintmax_t buf_len, const unsigned char *key) -> int;
 };
 
+static_assert(SodiumCrypto::MAX_HASH_LEN <= ICrypto::MAX_HASH_LEN &&
+              SodiumCrypto::MAX_SALT_LEN <= ICrypto::MAX_SALT_LEN &&
+              SodiumCrypto::MAX_ENCRYPTION_KEY_LEN <= ICrypto::MAX_ENCRYPTION_KEY_LEN &&
+              SodiumCrypto::MAX_ENCRYPTION_HEADER_LEN <= ICrypto::MAX_ENCRYPTION_HEADER_LEN);
+
 #endif // SODIUMCRYPTO_HPP
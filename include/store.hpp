@@ -1,19 +1,35 @@
 #ifndef STORE_HPP
 #define STORE_HPP
 
+#include "cardindex.hpp"
+#include "cardorders.hpp"
 #include "creditcard.hpp"
 #include "icrypto.hpp"
 #include "ifileio.hpp"
+#include "ikeycache.hpp"
+#include "posixfileio.hpp"
+#include "recorddirectory.hpp"
+#include "sodiumcrypto.hpp"
+#include "threadpool.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <string>
-#include <unordered_set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
-class Store {
-    friend class StoreTest;
-
+// Statuses and names shared by every BasicStore instantiation
+class StoreBase {
   public:
     static const inline std::string STORE_FILE_NAME = "WalletCache.store";
 
@@ -21,6 +37,7 @@ class Store {
         LOAD_STORE_VALID = 0,
         LOAD_STORE_OPEN_ERR,
         LOAD_STORE_HEADER_READ_ERR,
+        LOAD_STORE_CIPHER_SUITE_ERR,
         LOAD_STORE_PWD_VERIFY_ERR,
         LOAD_STORE_KEY_DERIVATION_ERR,
         LOAD_STORE_DATA_READ_ERR,
@@ -32,44 +49,383 @@ class Store {
         SAVE_STORE_HEADER_ERR,
         SAVE_STORE_WRITE_DATA_ERR,
         SAVE_STORE_COMMIT_TEMP_ERR,
+        SAVE_STORE_REOPEN_ERR, // committed, but the saved store could not be opened again for reading
+    };
+    enum AddCardStatus {
+        ADD_CARD_VALID = 0,
+        ADD_CARD_DUPLICATE, // a card with the same number is already in the store
+    };
+    enum ChangePasswordStatus {
+        CHANGE_PASSWORD_VALID = 0,
+        CHANGE_PASSWORD_VERIFY_ERR,
+        CHANGE_PASSWORD_KEY_ERR,
+        CHANGE_PASSWORD_WRITE_ERR,
+        CHANGE_PASSWORD_REOPEN_ERR, // the new header is committed, but the store could not be opened again for reading
+    };
+    enum RotateKeyStatus {
+        ROTATE_KEY_VALID = 0,
+        ROTATE_KEY_VERIFY_ERR,
+        ROTATE_KEY_BUSY_ERR, // the previous rotation is still running
+        ROTATE_KEY_SLOTS_ERR, // the extra key slots hold the current key; remove them first
+        ROTATE_KEY_KEY_ERR,
+        ROTATE_KEY_WRITE_ERR,
+        ROTATE_KEY_REOPEN_ERR, // committed, but the store could not be opened again for reading
     };
+    enum KeySlotStatus {
+        KEY_SLOT_VALID = 0,
+        KEY_SLOT_VERIFY_ERR,
+        KEY_SLOT_UNWRAPPED_ERR, // the store has no wrapped data key to add slots for; change the password first
+        KEY_SLOT_FULL_ERR,
+        KEY_SLOT_NOT_FOUND_ERR,
+        KEY_SLOT_KEY_ERR,
+        KEY_SLOT_WRITE_ERR,
+        KEY_SLOT_REOPEN_ERR, // the new header is committed, but the store could not be opened again for reading
+    };
+};
+
+// The crypto and file layers are policies bound at compile time. Given final classes, every call into them is direct
+// and, for a crypto policy with FIXED_KEY_SIZES, the hash, salt and key sizes are constants. Store instantiates it over
+// the virtual ICrypto and IFileIO interfaces, which any implementation (including the test mocks) can stand in for.
+template <typename CryptoPolicy, typename FileIOPolicy> class BasicStore : public StoreBase {
+    friend class StoreTest;
 
-    explicit Store(std::shared_ptr<ICrypto> crypto, std::unique_ptr<IFileIO> fileio);
-    ~Store();
+  public:
+    explicit BasicStore(std::shared_ptr<CryptoPolicy> crypto, std::unique_ptr<FileIOPolicy> fileio);
+    ~BasicStore();
 
     auto InitNewStore(unsigned char *password) -> int;
-    auto LoadStore(unsigned char *password) -> LoadStoreStatus;
+    // With extra key slots in the header every slot is tried at once on the unlock pool, and the trials not yet
+    // started are skipped once one slot opens
+    auto LoadStore(unsigned char *password, uint32_t generation = 0) -> LoadStoreStatus;
+    // Unlocks with the data key an earlier unlock left in the key cache, so no password is asked for and no KDF runs.
+    // LOAD_STORE_PWD_VERIFY_ERR when there is no cache, no entry for the store, or the entry is out of date.
+    auto LoadCachedStore(uint32_t generation = 0) -> LoadStoreStatus;
+    // Every unlock, password change and key rotation from now on leaves the data key in key_cache for
+    // timeout_seconds, named by the store's salt
+    void SetKeyCache(std::shared_ptr<IKeyCache> key_cache, uint32_t timeout_seconds);
+    // Waits for saves started by SaveStoreAsync, then writes any changes made since
     auto SaveStore() -> SaveStoreStatus;
+    // Saves on the save thread from a snapshot of the directory and the unsaved cards, so cards can still be added,
+    // deleted and read while it runs. A request while a save runs is coalesced with any others made before that save
+    // ends into one more save, of the latest state. The store reads from what was saved once the save thread is idle
+    // and the store is next saved, or FinishSaves is called; changes made since the snapshot stay unsaved.
+    auto SaveStoreAsync() -> std::shared_future<SaveStoreStatus>;
+    // Writes a save still waiting out its autosave window at once, waits for the saves started by SaveStoreAsync and
+    // switches over to the last one committed. The status is the last save's, SAVE_STORE_VALID if there was none, or
+    // SAVE_STORE_REOPEN_ERR if the committed store could not be opened for reading.
+    auto FinishSaves() -> SaveStoreStatus;
+    // From now on every AddCard, DeleteCard and MarkUsed schedules a background save window_ms later. Each change
+    // within the window pushes it back, but no further than max_unsaved_ms after the first change it saves, so a burst
+    // of changes is written once. A window of 0 turns autosave off.
+    void SetAutosave(uint32_t window_ms, uint32_t max_unsaved_ms);
+    // The clock the autosave window and max_unsaved_ms are measured on, steady_clock's unless set. A waiting save
+    // checks it again each time the time it had left has passed.
+    void SetAutosaveClock(std::function<std::chrono::steady_clock::time_point()> clock);
+    // The background save that will write the latest changes; not valid if none was started since the last
+    // FinishSaves
+    auto ScheduledSave() -> std::shared_future<SaveStoreStatus>;
+    // Records are sealed under a random data key that the header keeps wrapped under a key derived from the password,
+    // so a new password only means a new header; the directory and records are carried over as they are. Unsaved
+    // changes are saved along with it.
+    auto ChangePassword(unsigned char *password, unsigned char *new_password) -> ChangePasswordStatus;
+    // Slot 0 is the password the store was created or last changed with; ChangePassword only replaces that one. Each
+    // extra slot wraps the same data key under its own password, salt and KDF limits, up to MAX_KEY_SLOTS in all.
+    // password may open any slot.
+    auto AddKeySlot(unsigned char *password, unsigned char *new_password) -> KeySlotStatus;
+    auto RemoveKeySlot(unsigned char *password, size_t slot) -> KeySlotStatus;
+    auto KeySlotCount() const -> size_t;
+    // Re-seals every record under a new random data key on a background thread and commits the result. The record
+    // region is streamed through one buffer of ROTATION_CHUNK_LEN, or of the longest record if that is longer, and
+    // only one record's plaintext is held at a time.
+    // Unsaved changes are saved first. Only slot 0 can be wrapped again, so a store with extra key slots is refused
+    // until they are removed. Cards can still be read while it runs, through the file layer's ReadAt from two threads
+    // at once, and added, deleted and marked used in memory; saving them waits for FinishKeyRotation, as do password
+    // and key slot changes.
+    auto RotateDataKey(unsigned char *password) -> RotateKeyStatus;
+    auto KeyRotationStarted() const -> bool;
+    auto KeyRotationDone() const -> bool;
+    // Records re-sealed so far and in total
+    auto KeyRotationProgress() const -> std::pair<uint64_t, uint64_t>;
+    // Waits for the rotation to end and, once it committed, moves the store over to the new key. Card changes made
+    // while it ran are then autosaved if autosave is on. Without a rotation started there is nothing to do.
+    auto FinishKeyRotation() -> RotateKeyStatus;
 
-    void AddCard(const CreditCard &card);
+    auto AddCard(const CreditCard &card) -> AddCardStatus;
     void DeleteCard(uint32_t card_id);
 
     auto StoreExists(bool is_tmp) -> bool;
     auto DeleteStore(bool is_tmp) -> int;
 
     auto CardsDisplayList() const -> std::vector<std::pair<uint32_t, std::string>>;
-    auto GetCardById(uint32_t card_id) const -> const CreditCard &;
+    auto CardsDisplayList(const std::vector<uint32_t> &card_ids) const -> std::vector<std::pair<uint32_t, std::string>>;
+    auto CardsDisplayList(CardOrders::Order order) const -> std::vector<std::pair<uint32_t, std::string>>;
+    // Cards saved to disk are read and decrypted on demand, one record at a time
+    auto GetCardById(uint32_t card_id, CreditCard *card) -> int;
+    // Moves the card to the front of the last used order; saved with the directory
+    void MarkUsed(uint32_t card_id);
+
+    // Index lookups that never open a record. Names match case-insensitively; numbers match by keyed fingerprint.
+    auto FindByName(const std::string &name) const -> std::vector<uint32_t>;
+    auto FindByNamePrefix(const std::string &prefix) const -> std::vector<uint32_t>;
+    auto FindByNumber(const std::string &card_number) -> std::vector<uint32_t>;
+    // Expiry lookups take packed keys (see CreditCard::PackExpiry) and return ids in expiry order. A card stays valid
+    // through its expiry month, so it has expired once current_expiry is past its key.
+    auto FindByExpiry(uint16_t first, uint16_t last) const -> std::vector<uint32_t>;
+    auto FindExpired(uint16_t current_expiry) const -> std::vector<uint32_t>;
+    auto CardsByExpiry() const -> std::vector<uint32_t>;
+    // Ids in ascending order, for CardsDisplayList
+    auto FilterCards(const CardFilter &filter) const -> std::vector<uint32_t>;
 
   private:
-    std::shared_ptr<ICrypto> crypto_;
-    std::unique_ptr<IFileIO> fileio_;
-    std::vector<struct CreditCard> cards_;
-    std::unordered_set<int> deleted_;
+    static const uint32_t SEGMENT_RECORDS = 256; // records are grouped by id into segments of this many ids
+    static constexpr unsigned int MAX_SEGMENT_THREADS = 8;
+    static const uint64_t FINGERPRINT_SUBKEY_ID = 1;
+    static const uint64_t ROTATION_CHUNK_LEN = 64 * 1024;
+    // Every header starts with the magic, the format version and the cipher suite byte. Stores from before the magic
+    // start with their password hash, which never begins with it.
+    static constexpr std::array<unsigned char, 4> HEADER_MAGIC = {'W', 'C', 'S', 'T'};
+    static const uint8_t HEADER_VERSION = 1;
+    static const size_t HEADER_PREFIX_LEN = HEADER_MAGIC.size() + 2;
+    // Set in the header's cipher suite byte when a wrapped data key follows the directory length. Its tag authenticates
+    // the password, so such a header has no password hash. Stores written before data keys lack it and use the
+    // password key itself as their data key until the password is changed.
+    static const uint8_t HEADER_WRAPPED_KEY = 0x80;
+    // Set along with HEADER_WRAPPED_KEY when the extra key slots follow the wrapped key
+    static const uint8_t HEADER_KEY_SLOTS = 0x40;
+    // Set when the password KDF's lane count follows the wrapped key as one byte; without it the KDF has one lane
+    static const uint8_t HEADER_KDF_LANES = 0x20;
+    static const size_t MAX_KEY_SLOTS = 8;
+    // Each trial holds a full Argon2 memory block, so only a few run at once
+    static constexpr unsigned int MAX_UNLOCK_THREADS = 4;
+    static const inline std::string KEY_CACHE_PREFIX = "walletcache:";
 
-    std::unique_ptr<unsigned char[]> hashed_password_;
+    // An extra key slot: the data key wrapped as WrapKey does, under a key derived with the slot's own limits
+    struct KeySlot {
+        uint64_t ops_limit;
+        uint64_t mem_limit;
+        std::vector<unsigned char> salt;
+        std::vector<unsigned char> wrapped_key;
+    };
+
+    // A run of bytes for the new record region, either copied from the current store or taken from the sealed buffer
+    struct RecordRun {
+        bool stored;
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    // A new record to seal into the sealed buffer at offset
+    struct SealJob {
+        uint32_t id;
+        size_t text;
+        uint64_t offset;
+    };
+
+    // A data key rotation, shared with its thread. The thread works from its own copy of the directory and only reads
+    // the keys and header fields, which nothing changes until FinishKeyRotation, and hands back its results once done
+    // is set.
+    struct KeyRotation {
+        std::thread thread;
+        std::atomic<uint64_t> rotated = 0;
+        uint64_t total = 0;
+        std::atomic<bool> done = false;
+        int status = 0;
+        std::unique_ptr<unsigned char[]> key;
+        std::unique_ptr<unsigned char[]> fingerprint_key;
+        std::unique_ptr<unsigned char[]> wrapped_key;
+        RecordDirectory directory; // the directory as rotation started, with fingerprints under the new key
+        std::vector<RecordDirectory::Location> locations;
+        uint64_t directory_len = 0;
+    };
+
+    // The changes a background save writes out, copied from the store when the save was requested. Stored records are
+    // not copied: the save copies them from the store open for reading, which stays open until the save is applied.
+    struct SaveSnapshot {
+        RecordDirectory directory;
+        std::unordered_map<uint32_t, CreditCard> new_cards;
+        std::unordered_map<uint32_t, uint64_t> dirty_segments;
+        uint64_t edits = 0;
+    };
+
+    // What a committed save wrote, for the store to switch its reads over to
+    struct SavedStore {
+        std::vector<uint32_t> ids; // the saved entries, in directory order
+        std::vector<RecordDirectory::Location> locations;
+        uint64_t directory_len = 0;
+        uint64_t records_len = 0;
+        uint64_t edits = 0; // the store's edit count when the saved state was taken
+    };
+
+    // Saves requested with SaveStoreAsync or by autosave, run one after another on their thread. The fields under
+    // mutex are shared with the thread; the rest belong to the caller.
+    struct BackgroundSave {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake; // signalled when next_due moves
+        bool running = false;
+        std::unique_ptr<SaveSnapshot> next; // waiting to be due, replaced by every newer request
+        std::promise<SaveStoreStatus> next_done;
+        std::chrono::steady_clock::time_point next_due;
+        std::chrono::steady_clock::time_point next_deadline; // next_due is never moved past it
+        std::unique_ptr<SavedStore> saved; // the last save committed, not applied yet
+        SaveStoreStatus status = SAVE_STORE_VALID;
+        std::shared_future<SaveStoreStatus> latest; // the save of the latest snapshot
+        uint64_t latest_edits = 0;
+    };
+
+    // Stack buffers are sized by the policy's bounds, which for a policy with fixed sizes are the exact sizes
+    using HashBuf = std::array<unsigned char, CryptoPolicy::MAX_HASH_LEN>;
+    using SaltBuf = std::array<unsigned char, CryptoPolicy::MAX_SALT_LEN>;
+    using KeyBuf = std::array<unsigned char, CryptoPolicy::MAX_ENCRYPTION_KEY_LEN>;
+    using EncryptionHeaderBuf = std::array<unsigned char, CryptoPolicy::MAX_ENCRYPTION_HEADER_LEN>;
+
+    // The encrypted directory of a store being loaded, read on its own thread while the key is derived. The thread
+    // only uses the read handle, which nothing else touches until it is joined.
+    struct DirectoryPrefetch {
+        std::thread thread;
+        uintmax_t store_size = 0;
+        LoadStoreStatus status = LOAD_STORE_DATA_READ_ERR;
+        EncryptionHeaderBuf header;
+        std::vector<unsigned char> data; // the directory after its encryption header
+    };
+
+    using HeaderPrefix = std::array<unsigned char, HEADER_PREFIX_LEN>;
+
+    // The header of a store being loaded, up to the directory
+    struct StoreHeader {
+        bool legacy = false; // written before the header magic; nothing else was read
+        HashBuf hash;
+        SaltBuf salt;
+        uint64_t directory_len = 0;
+        std::unique_ptr<unsigned char[]> wrapped_key;
+        uint8_t kdf_lanes = 1;
+        std::vector<KeySlot> key_slots;
+    };
+
+    std::shared_ptr<CryptoPolicy> crypto_;
+    std::unique_ptr<FileIOPolicy> fileio_;
+    RecordDirectory directory_;
+    CardIndex index_;
+    CardOrders orders_;
+    uint64_t use_counter_ = 0; // highest last used value in the directory
+    std::unordered_map<uint32_t, CreditCard> new_cards_; // added since the last save, so not sealed on disk yet
+    // Segments with records added or deleted since the last save, each with the edit count of its last change
+    std::unordered_map<uint32_t, uint64_t> dirty_segments_;
+    uint64_t edits_ = 0; // counts changes to the cards, so a save knows which of them it wrote
+    uint64_t directory_offset_ = 0; // header length of the store open for reading
+    uint64_t records_offset_ = 0;   // record region of the store open for reading
+    uint64_t records_len_ = 0;
+    // Started by the first save with more than one dirty segment to seal, or load with more than one segment to open
+    std::unique_ptr<ThreadPool> segment_pool_;
+    std::unique_ptr<ThreadPool> unlock_pool_; // started by the first load of a store with extra key slots
+    std::unique_ptr<KeyRotation> rotation_;
+    std::unique_ptr<BackgroundSave> save_;
+    uint32_t autosave_window_ms_ = 0;
+    uint32_t autosave_max_unsaved_ms_ = 0;
+    std::function<std::chrono::steady_clock::time_point()> autosave_clock_ = std::chrono::steady_clock::now;
+    std::shared_ptr<IKeyCache> key_cache_;
+    uint32_t key_cache_timeout_ = 0;
+
+    std::unique_ptr<unsigned char[]> hashed_password_; // only for a store without a wrapped data key
     std::unique_ptr<unsigned char[]> salt_;
+    std::unique_ptr<unsigned char[]> wrapped_key_; // null for a store without a wrapped data key
+    uint8_t kdf_lanes_ = 1;                        // lanes of the key slot 0 derivation
+    std::vector<KeySlot> key_slots_;               // slots past slot 0
     std::unique_ptr<unsigned char[]> encryption_key_;
+    std::unique_ptr<unsigned char[]> fingerprint_key_;
+
+    bool dirty_ = false;
 
-    bool dirty_;
+    auto ReadHeader(unsigned char *hash, unsigned char *salt, uint8_t *cipher_suite, uint64_t *directory_len,
+                    bool *legacy) -> int;
+    auto ReadStoreHeader(uint32_t generation, StoreHeader *header) -> LoadStoreStatus;
+    auto LoadLegacyStore(unsigned char *password) -> LoadStoreStatus;
+    auto ReadLegacyText(uint64_t offset, uint64_t len, const unsigned char *key, std::vector<unsigned char> *text)
+        -> LoadStoreStatus;
+    void PrefetchDirectory(uint64_t directory_len, DirectoryPrefetch *prefetch);
+    auto OpenStore(StoreHeader *header, unsigned char *encryption_key, DirectoryPrefetch *prefetch, uint32_t generation)
+        -> LoadStoreStatus;
+    auto KeyCacheName(const unsigned char *salt) const -> std::string;
+    void CacheKey();
+    auto WrapKey(unsigned char *wrapped_key, const unsigned char *key, const unsigned char *password,
+                 const unsigned char *salt) -> int;
+    auto UnwrapKey(unsigned char *key, const unsigned char *hash, const unsigned char *wrapped_key,
+                   const unsigned char *password, const unsigned char *salt) -> LoadStoreStatus;
+    auto WrapKeySlot(KeySlot *slot, const unsigned char *key, const unsigned char *password) -> int;
+    auto UnwrapKeySlot(unsigned char *key, const KeySlot &slot, const unsigned char *password) -> int;
+    auto ReadKeySlots(std::vector<KeySlot> *slots) -> int;
+    auto TryKeySlots(unsigned char *key, const unsigned char *hash, const unsigned char *salt,
+                     const unsigned char *wrapped_key, const std::vector<KeySlot> &slots, const unsigned char *password)
+        -> LoadStoreStatus;
+    auto OpensKeySlot(const unsigned char *password) -> bool;
+    auto VerifyPassword(const unsigned char *password) -> bool;
+    auto CommitHeader() -> SaveStoreStatus;
+    // AddCard without the autosave it schedules
+    auto InsertCard(const CreditCard &card) -> AddCardStatus;
+    auto ReadRecord(const RecordDirectory::Entry &entry, CreditCard *card) -> int;
+    auto ParseRecord(std::vector<unsigned char> *text, CreditCard *card) -> int;
+    auto RebuildMetadata() -> int;
+    auto CardMetadata(const CreditCard &card) -> RecordDirectory::Metadata;
+    auto NumberFingerprint(const std::string &card_number, const unsigned char *fingerprint_key)
+        -> RecordDirectory::Fingerprint;
+    auto DecryptRecordText(const RecordDirectory::Entry &entry, std::vector<unsigned char> *text) -> int;
+    auto WriteHeader(const unsigned char *hash, const unsigned char *salt, const unsigned char *wrapped_key,
+                     uint32_t kdf_lanes, std::span<const KeySlot> key_slots, uint64_t directory_len) -> int;
+    auto WriteData(const unsigned char *hash, const unsigned char *salt, const unsigned char *wrapped_key,
+                   uint32_t kdf_lanes, std::span<const KeySlot> key_slots, const unsigned char *key,
+                   unsigned char *data, uintmax_t data_size, std::span<const RecordRun> runs, unsigned char *sealed)
+        -> int;
+    auto RewriteHeader() -> SaveStoreStatus;
+    auto ReopenRead() -> int;
+    auto RequestSave(bool autosave) -> std::shared_future<SaveStoreStatus>;
+    void RequestAutosave();
+    void ScheduleNextSave(std::chrono::steady_clock::time_point now, bool autosave);
+    auto TakeSnapshot() -> std::unique_ptr<SaveSnapshot>;
+    void RunSaves();
+    auto WriteStore(const RecordDirectory &directory, const std::unordered_map<uint32_t, CreditCard> &new_cards,
+                    const std::unordered_map<uint32_t, uint64_t> &dirty_segments, SavedStore *saved)
+        -> SaveStoreStatus;
+    auto ApplySave(const SavedStore &saved) -> SaveStoreStatus;
+    auto PlanRecords(const RecordDirectory &directory, const std::unordered_map<uint32_t, CreditCard> &new_cards,
+                     const std::unordered_map<uint32_t, uint64_t> &dirty_segments,
+                     std::vector<RecordDirectory::Location> *locations, std::vector<unsigned char> *sealed,
+                     std::vector<RecordRun> *runs) -> int;
+    // FinishKeyRotation without the autosave it requests
+    auto EndKeyRotation() -> RotateKeyStatus;
+    auto RotateRecords(KeyRotation *rotation) -> int;
+    auto ResealRecord(const RecordDirectory::Entry &entry, unsigned char *record, unsigned char *text,
+                      KeyRotation *rotation) -> int;
+    auto SealSegments(const std::vector<std::vector<SealJob>> &seal_jobs, const std::vector<std::string> &texts,
+                      unsigned char *sealed) -> int;
+    auto SegmentPool() -> ThreadPool &;
 
-    auto ReadHeader(unsigned char *hash, unsigned char *salt) -> int;
-    auto ReadData(unsigned char *decrypted_data, uintmax_t data_size, uint64_t *decrypted_size_actual) -> int;
-    auto WriteHeader(const unsigned char *hash, const unsigned char *salt) -> int;
-    auto WriteData(unsigned char *data, uintmax_t data_size) -> int;
+    auto HashLen() const -> uint64_t;
+    auto SaltLen() const -> uint64_t;
+    auto KeyLen() const -> uint64_t;
+    auto WrappedKeyLen() const -> uint64_t;
+    auto KeySlotLen() const -> uint64_t;
+    // A count byte, then each slot's ops limit and memory limit (u64 LE), salt and wrapped key; empty without slots
+    auto SerializeKeySlots(std::span<const KeySlot> key_slots) const -> std::vector<unsigned char>;
 
-    auto GetCardsSize() -> uintmax_t;
-    auto CardsFormatted(unsigned char *buf) -> uintmax_t;
-    void LoadCards(unsigned char *data);
+    static const size_t HEADER_SEGMENTS = 7;
+    // The header the store open for reading was written with, or one WriteHeader would write with these fields
+    auto HeaderLen() const -> uint64_t;
+    auto HeaderLen(const unsigned char *hash, const unsigned char *wrapped_key, uint32_t kdf_lanes,
+                   std::span<const KeySlot> key_slots) const -> uint64_t;
+    // The magic and version, with the cipher suite byte flagging which of the optional fields follow
+    auto MakeHeaderPrefix(const unsigned char *wrapped_key, std::span<const KeySlot> key_slots,
+                          uint32_t kdf_lanes) const -> HeaderPrefix;
+    // The wrapped key and lane count segments are empty when their pointers are null, and the key slots segment is
+    // empty when key_slots is
+    auto HeaderSegments(unsigned char *prefix, unsigned char *hash, unsigned char *salt, unsigned char *directory_len,
+                        unsigned char *wrapped_key, uint8_t *kdf_lanes, std::span<unsigned char> key_slots) const
+        -> std::array<iovec, HEADER_SEGMENTS>;
 };
 
+using Store = BasicStore<ICrypto, IFileIO>;
+using SodiumStore = BasicStore<SodiumCrypto, PosixFileIO>;
+
+extern template class BasicStore<ICrypto, IFileIO>;
+extern template class BasicStore<SodiumCrypto, PosixFileIO>;
+
 #endif // STORE_HPP
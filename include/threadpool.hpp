@@ -0,0 +1,39 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads draining a FIFO of tasks. Tasks must not throw.
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+    void Submit(std::function<void()> task);
+    // Blocks until every task submitted so far has finished
+    void Wait();
+
+    auto Size() const -> size_t;
+
+  private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable idle_;
+    size_t running_ = 0;
+    bool stopping_ = false;
+
+    void WorkerLoop();
+};
+
+#endif // THREADPOOL_HPP
@@ -21,6 +21,12 @@ struct UIStrings {
     static const inline std::string PROFILE_MENU_LIST = "[1]: LIST\n";
     static const inline std::string PROFILE_MENU_ADD = "[2]: ADD\n";
     static const inline std::string PROFILE_MENU_DELETE = "[3]: DELETE\n";
+    static const inline std::string PROFILE_MENU_EXPIRING = "[4]: EXPIRED & EXPIRING SOON\n";
+    static const inline std::string PROFILE_MENU_FILTER = "[5]: FILTER BY TAG\n";
+    static const inline std::string PROFILE_MENU_CHANGE_PASSWORD = "[6]: CHANGE MASTER PASSWORD\n";
+    static const inline std::string PROFILE_MENU_ROTATE_KEY = "[7]: ROTATE DATA KEY\n";
+    static const inline std::string PROFILE_MENU_ADD_KEY_SLOT = "[8]: ADD KEY SLOT\n";
+    static const inline std::string PROFILE_MENU_REMOVE_KEY_SLOT = "[9]: REMOVE KEY SLOT\n";
 
     static const inline std::string HASHING = "\nHashing...\n";
 
@@ -31,8 +37,13 @@ struct UIStrings {
         "Optional: enter a name for the card using only letters, numbers, and "
         "spaces (or 0 to cancel):\n";
     static const inline std::string CARD_NUMBER_PROMPT = "Enter card number (or 0 to cancel):\n";
+    static const inline std::string CARD_TAGS_PROMPT =
+        "Optional: enter tags for the card separated by spaces, using only letters and numbers (or 0 to cancel):\n";
     static const inline std::string CARD_YEAR_PROMPT = "Enter card expiration year [Ex: 2025] (or 0 to cancel):\n";
 
+    static const inline std::string FILTER_TAGS_PROMPT =
+        "Enter tags separated by spaces to list cards carrying all of them; prefix a tag with - to exclude it:\n";
+
     static const inline std::string PASSWORD_PROMPT = "Enter the profile master password:\n";
 
     static const inline std::string CONFIRMATION_CANCEL = "[0] CANCEL\n";
@@ -41,6 +52,14 @@ struct UIStrings {
     static const inline std::string REQUEST_VALID_INPUT = "Please input a number corresponding to available options.\n";
 
     static const inline std::string LIST_CARDS_RETURN = "[0] RETURN\n";
+    static const inline std::string LIST_CARDS_NEXT_ORDER_KEY = "s";
+    static const inline std::string LIST_CARDS_NEXT_ORDER = "[s] SORTED BY: ";
+
+    static const inline std::string ORDER_CREATED_LABEL = "DATE ADDED";
+    static const inline std::string ORDER_NAME_LABEL = "NAME";
+    static const inline std::string ORDER_NETWORK_LABEL = "NETWORK";
+    static const inline std::string ORDER_EXPIRY_LABEL = "EXPIRY";
+    static const inline std::string ORDER_LAST_USED_LABEL = "LAST USED";
 
     static const inline std::string CARD_INFO_RETURN = "[0] RETURN\n";
     static const inline std::string CARD_INFO_DELETE = "[1] DELETE CARD\n";
@@ -54,18 +73,26 @@ struct UIStrings {
     static const inline std::string CARD_CVV_LABEL = "CVV: ";
     static const inline std::string CARD_MONTH_LABEL = "Expiration Month: ";
     static const inline std::string CARD_YEAR_LABEL = "Expiration Year: ";
+    static const inline std::string CARD_TAGS_LABEL = "Tags: ";
 
     static const inline std::string HIDDEN_FIELD = "•••••";
 
     static const inline std::string DELETE_CARD_MESSAGE = "Select a card to delete:\n";
     static const inline std::string DELETE_CARD_RETURN = "[0] RETURN\n";
     static const inline std::string DELETE_CARD_CONFIRM_SELECTION = "Are you sure you wnat to delete this card?\n";
+
+    static const inline std::string REMOVE_KEY_SLOT_MESSAGE = "Select a key slot to remove:\n";
+    static const inline std::string REMOVE_KEY_SLOT_RETURN = "[0] RETURN\n";
+    static const inline std::string KEY_SLOT_LABEL = "KEY SLOT ";
 };
 
 class UI {
     friend class UITest;
 
   public:
+    static constexpr int CARD_LIST_RETURN = -1;
+    static constexpr int CARD_LIST_NEXT_ORDER = -2;
+
     enum StartMenuOption {
         OPT_START_EXIT = 0,
         OPT_START_NEW_PROFILE,
@@ -76,6 +103,12 @@ class UI {
         OPT_PROFILE_LIST,
         OPT_PROFILE_ADD,
         OPT_PROFILE_DEL,
+        OPT_PROFILE_EXPIRING,
+        OPT_PROFILE_FILTER,
+        OPT_PROFILE_CHANGE_PASSWORD,
+        OPT_PROFILE_ROTATE_KEY,
+        OPT_PROFILE_ADD_KEY_SLOT,
+        OPT_PROFILE_REMOVE_KEY_SLOT,
     };
     enum CardInfoMenuOption {
         OPT_CARD_RETURN = 0,
@@ -87,10 +120,15 @@ class UI {
     auto StartMenu(const std::string &status_msg, bool profile_exists) const -> StartMenuOption;
     void CreateProfileMenu(const std::string &status_msg, std::string &password, std::string &confirm_password) const;
     auto ProfileMenu(const std::string &status_msg) const -> ProfileMenuOption;
-    auto CardListMenu(const std::vector<std::pair<uint32_t, std::string>> &cards_list) const -> int;
+    // Returns the selected card id, CARD_LIST_RETURN, or CARD_LIST_NEXT_ORDER if an order label was shown and the user
+    // asked for the next order
+    auto CardListMenu(const std::vector<std::pair<uint32_t, std::string>> &cards_list,
+                      const std::string &order_label = "") const -> int;
     auto CardInfoMenu(const std::vector<std::pair<std::string, std::string>> &card_fields, uint32_t *selected_field,
                       bool fields_visible) const -> CardInfoMenuOption;
     auto CardDeleteMenu(const std::vector<std::pair<uint32_t, std::string>> &cards_list) const -> int;
+    // Lists the removable slots 1 to slot_count - 1; returns the selected slot, or 0 to return
+    auto KeySlotRemoveMenu(size_t slot_count) const -> int;
 
     void DisplayHashing() const;
 
@@ -98,14 +136,19 @@ class UI {
     void PromptCardMonth(const std::string &status_msg, std::string &month) const;
     void PromptCardName(const std::string &status_msg, std::string &card_name) const;
     void PromptCardNumber(const std::string &status_msg, std::string &card_number) const;
+    void PromptCardTags(const std::string &status_msg, std::string &tags) const;
     void PromptCardYear(const std::string &status_msg, std::string &year) const;
+    void PromptFilterTags(std::string &tags) const;
     void PromptLogin(std::string &password) const;
     auto PromptConfirmation(const std::string &msg) const -> bool;
 
   private:
+    static const int KEY_SELECTED = INT32_MIN;
+
     void ListCards(const std::vector<std::pair<uint32_t, std::string>> &cards_list,
                    std::unordered_map<int, uint32_t> &choice_mapping, int starting_option) const;
     auto GetSelection(int lower, int upper) const -> int;
+    auto GetSelectionOrKey(int lower, int upper, const std::string &key) const -> int;
     inline auto PromptInput() const -> std::string;
     inline auto PromptInputMasked() const -> std::string;
 };
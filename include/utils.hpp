@@ -1,6 +1,7 @@
 #ifndef UTILS_HPP
 #define UTILS_HPP
 
+#include <cstdint>
 #include <string>
 
 auto CheckFileExists(const std::string &path) -> bool;
@@ -13,5 +14,15 @@ auto GetHomePath() -> std::string;
 
 auto GetFilePath(const std::string &dir, const std::string &file_name) -> std::string;
 
+auto GetGenerationPath(const std::string &file_path, uint32_t generation) -> std::string;
+
 void CopyToClipboard(const std::string &str);
+
+// Fixed-width little-endian encoding for on-disk integers
+void StoreLE16(unsigned char *buf, uint16_t value);
+void StoreLE32(unsigned char *buf, uint32_t value);
+void StoreLE64(unsigned char *buf, uint64_t value);
+auto LoadLE16(const unsigned char *buf) -> uint16_t;
+auto LoadLE32(const unsigned char *buf) -> uint32_t;
+auto LoadLE64(const unsigned char *buf) -> uint64_t;
 #endif // UTILS_HPP
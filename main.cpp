@@ -1,15 +1,29 @@
 #include "creditcard.hpp"
-#include "fstreamfileio.hpp"
+#include "keyringkeycache.hpp"
+#include "posixfileio.hpp"
 #include "sodiumcrypto.hpp"
 #include "store.hpp"
 #include "ui.hpp"
 #include "utils.hpp"
 #include "verification.hpp"
 
+#include <chrono>
 #include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <future>
 #include <iostream>
 
+const uint32_t BACKUP_GENERATIONS = 3;
+const uint16_t EXPIRY_WARNING_MONTHS = 3;
+// Seconds the data key stays in the kernel keyring after an unlock, so logging in again within them skips the
+// password; unset or 0 keeps it out of the keyring
+const char *const KEY_CACHE_SECONDS_ENV = "WALLETCACHE_KEY_CACHE_SECONDS";
+// Card changes are saved in the background once none has been made for the window, and are never left unsaved for
+// longer than the maximum
+const uint32_t AUTOSAVE_WINDOW_MS = 2000;
+const uint32_t AUTOSAVE_MAX_UNSAVED_MS = 15000;
+
 auto GetStorePath() -> std::string {
     std::string homepath = GetHomePath();
     if (homepath.empty()) {
@@ -62,8 +76,8 @@ void HandlePasswordSetup(const UI &ui, unsigned char *password) {
     input_confirm.clear();
 }
 
-auto HandleNewProfile(Store &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto, bool profile_exists)
-    -> int {
+auto HandleNewProfile(SodiumStore &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto,
+                      bool profile_exists) -> int {
     if (profile_exists) {
         store.DeleteStore(false);
     }
@@ -72,23 +86,188 @@ auto HandleNewProfile(Store &store, const UI &ui, const std::shared_ptr<SodiumCr
     HandlePasswordSetup(ui, password);
     ui.DisplayHashing();
 
+    crypto->SetCipherSuite(SodiumCrypto::PreferredCipherSuite());
+    crypto->SetKdfLanes(SodiumCrypto::PreferredKdfLanes());
+
     int res = store.InitNewStore(password);
     crypto->Memzero(password, MAX_PASSWORD_LENGTH + 1);
     return res;
 }
 
-auto HandleLogin(Store &store, const UI &ui) -> Store::LoadStoreStatus {
+auto HandleLogin(SodiumStore &store, const UI &ui, uint32_t generation) -> Store::LoadStoreStatus {
+    if (store.LoadCachedStore(generation) == Store::LOAD_STORE_VALID) {
+        return Store::LOAD_STORE_VALID;
+    }
+
+    std::string input_password;
+    ui.PromptLogin(input_password);
+
+    unsigned char password[MAX_PASSWORD_LENGTH + 1];
+    memcpy(password, input_password.c_str(), input_password.size());
+    password[input_password.size()] = 0;
+    return store.LoadStore(password, generation);
+}
+
+// The current password is asked for again before a new one is set
+auto HandlePasswordChange(SodiumStore &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto)
+    -> Store::ChangePasswordStatus {
+    std::string input_password;
+    ui.PromptLogin(input_password);
+    if (input_password.size() > MAX_PASSWORD_LENGTH) {
+        return Store::CHANGE_PASSWORD_VERIFY_ERR;
+    }
+
+    unsigned char password[MAX_PASSWORD_LENGTH + 1];
+    memcpy(password, input_password.c_str(), input_password.size());
+    password[input_password.size()] = 0;
+    input_password.clear();
+
+    unsigned char new_password[MAX_PASSWORD_LENGTH + 1];
+    HandlePasswordSetup(ui, new_password);
+    ui.DisplayHashing();
+
+    Store::ChangePasswordStatus status = store.ChangePassword(password, new_password);
+    crypto->Memzero(password, MAX_PASSWORD_LENGTH + 1);
+    crypto->Memzero(new_password, MAX_PASSWORD_LENGTH + 1);
+    return status;
+}
+
+// The current password wraps the new data key; the records are re-sealed in the background
+auto HandleKeyRotation(SodiumStore &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto)
+    -> Store::RotateKeyStatus {
+    if (store.KeySlotCount() > 1) {
+        return Store::ROTATE_KEY_SLOTS_ERR;
+    }
+
+    std::string input_password;
+    ui.PromptLogin(input_password);
+    if (input_password.size() > MAX_PASSWORD_LENGTH) {
+        return Store::ROTATE_KEY_VERIFY_ERR;
+    }
+
+    unsigned char password[MAX_PASSWORD_LENGTH + 1];
+    memcpy(password, input_password.c_str(), input_password.size());
+    password[input_password.size()] = 0;
+    input_password.clear();
+    ui.DisplayHashing();
+
+    Store::RotateKeyStatus status = store.RotateDataKey(password);
+    crypto->Memzero(password, MAX_PASSWORD_LENGTH + 1);
+    return status;
+}
+
+// A new password for an extra key slot, set up once any slot's password is given
+auto HandleAddKeySlot(SodiumStore &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto)
+    -> Store::KeySlotStatus {
+    std::string input_password;
+    ui.PromptLogin(input_password);
+    if (input_password.size() > MAX_PASSWORD_LENGTH) {
+        return Store::KEY_SLOT_VERIFY_ERR;
+    }
+
+    unsigned char password[MAX_PASSWORD_LENGTH + 1];
+    memcpy(password, input_password.c_str(), input_password.size());
+    password[input_password.size()] = 0;
+    input_password.clear();
+
+    unsigned char new_password[MAX_PASSWORD_LENGTH + 1];
+    HandlePasswordSetup(ui, new_password);
+    ui.DisplayHashing();
+
+    Store::KeySlotStatus status = store.AddKeySlot(password, new_password);
+    crypto->Memzero(password, MAX_PASSWORD_LENGTH + 1);
+    crypto->Memzero(new_password, MAX_PASSWORD_LENGTH + 1);
+    return status;
+}
+
+auto HandleRemoveKeySlot(SodiumStore &store, const UI &ui, const std::shared_ptr<SodiumCrypto> &crypto)
+    -> Store::KeySlotStatus {
+    if (store.KeySlotCount() <= 1) {
+        return Store::KEY_SLOT_NOT_FOUND_ERR;
+    }
+    int slot = ui.KeySlotRemoveMenu(store.KeySlotCount());
+    if (slot == 0) {
+        return Store::KEY_SLOT_VALID;
+    }
+
     std::string input_password;
     ui.PromptLogin(input_password);
+    if (input_password.size() > MAX_PASSWORD_LENGTH) {
+        return Store::KEY_SLOT_VERIFY_ERR;
+    }
 
     unsigned char password[MAX_PASSWORD_LENGTH + 1];
     memcpy(password, input_password.c_str(), input_password.size());
     password[input_password.size()] = 0;
-    return store.LoadStore(password);
+    input_password.clear();
+    ui.DisplayHashing();
+
+    Store::KeySlotStatus status = store.RemoveKeySlot(password, static_cast<size_t>(slot));
+    crypto->Memzero(password, MAX_PASSWORD_LENGTH + 1);
+    return status;
 }
 
-auto HandleCardInfo(Store &store, const UI &ui, uint32_t card_id) -> int {
-    const CreditCard &card = store.GetCardById(card_id);
+auto KeySlotStatusMessage(Store::KeySlotStatus status, const std::string &done_msg) -> std::string {
+    switch (status) {
+    case Store::KEY_SLOT_VALID:
+        return done_msg;
+    case Store::KEY_SLOT_VERIFY_ERR:
+        return "ERR: Incorrect master password.\n";
+    case Store::KEY_SLOT_UNWRAPPED_ERR:
+        return "ERR: Change the master password once before adding key slots.\n";
+    case Store::KEY_SLOT_FULL_ERR:
+        return "ERR: Every key slot is in use.\n";
+    case Store::KEY_SLOT_NOT_FOUND_ERR:
+        return "ERR: There are no extra key slots to remove.\n";
+    case Store::KEY_SLOT_KEY_ERR:
+    case Store::KEY_SLOT_WRITE_ERR:
+        return "ERR: Failed to update the key slots.\n";
+    case Store::KEY_SLOT_REOPEN_ERR:
+        return "ERR: Key slots updated, but the data file could not be reopened. Restart to read cards.\n";
+    }
+    return "";
+}
+
+// Progress while a rotation runs, and its outcome once it has ended; card changes made meanwhile are saved then
+auto KeyRotationStatus(SodiumStore &store, std::shared_future<Store::SaveStoreStatus> *pending_save) -> std::string {
+    if (!store.KeyRotationStarted()) {
+        return "";
+    }
+    if (!store.KeyRotationDone()) {
+        auto [rotated, total] = store.KeyRotationProgress();
+        return "Rotating data key: " + std::to_string(rotated) + "/" + std::to_string(total) + " cards\n";
+    }
+    Store::RotateKeyStatus status = store.FinishKeyRotation();
+    *pending_save = store.ScheduledSave();
+    switch (status) {
+    case Store::ROTATE_KEY_VALID:
+        return "Data key rotated.\n";
+    case Store::ROTATE_KEY_REOPEN_ERR:
+        return "ERR: Data key rotated, but the data file could not be reopened. Restart to read cards.\n";
+    default:
+        return "ERR: Failed to rotate the data key.\n";
+    }
+}
+
+// The outcome of a background save once it has finished; saves that succeed stay quiet
+auto BackgroundSaveStatus(std::shared_future<Store::SaveStoreStatus> *save) -> std::string {
+    if (!save->valid() || save->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return "";
+    }
+    Store::SaveStoreStatus status = save->get();
+    *save = {};
+    if (status == Store::SAVE_STORE_REOPEN_ERR) {
+        return "ERR: Cards saved, but the data file could not be reopened. Restart to read cards.\n";
+    }
+    return status == Store::SAVE_STORE_VALID ? "" : "ERR: Failed to save cards in the background.\n";
+}
+
+auto HandleCardInfo(SodiumStore &store, const UI &ui, uint32_t card_id) -> int {
+    CreditCard card;
+    if (store.GetCardById(card_id, &card) != 0) {
+        return -1;
+    }
+    store.MarkUsed(card_id);
 
     CreditCardViewModel card_view;
     std::vector<std::pair<std::string, std::string>> fields = card_view.GetDisplayFields(card);
@@ -113,11 +292,86 @@ auto HandleCardInfo(Store &store, const UI &ui, uint32_t card_id) -> int {
     }
 }
 
-auto HandleCardsList(Store &store, const UI &ui) -> int {
+auto OrderLabel(CardOrders::Order order) -> std::string {
+    switch (order) {
+    case CardOrders::ORDER_NAME:
+        return UIStrings::ORDER_NAME_LABEL;
+    case CardOrders::ORDER_NETWORK:
+        return UIStrings::ORDER_NETWORK_LABEL;
+    case CardOrders::ORDER_EXPIRY:
+        return UIStrings::ORDER_EXPIRY_LABEL;
+    case CardOrders::ORDER_LAST_USED:
+        return UIStrings::ORDER_LAST_USED_LABEL;
+    default:
+        return UIStrings::ORDER_CREATED_LABEL;
+    }
+}
+
+// The order stays selected between visits to the list
+auto HandleCardsList(SodiumStore &store, const UI &ui, CardOrders::Order &order) -> int {
     while (true) {
-        std::vector<std::pair<uint32_t, std::string>> cards_list = store.CardsDisplayList();
+        std::vector<std::pair<uint32_t, std::string>> cards_list = store.CardsDisplayList(order);
+        int selection = static_cast<int>(ui.CardListMenu(cards_list, OrderLabel(order)));
+        if (selection == UI::CARD_LIST_NEXT_ORDER) {
+            order = static_cast<CardOrders::Order>((order + 1) % CardOrders::ORDER_COUNT);
+            continue;
+        }
+        if (selection == UI::CARD_LIST_RETURN) {
+            break;
+        }
+
+        HandleCardInfo(store, ui, selection);
+    }
+    return 0;
+}
+
+auto CurrentExpiryKey() -> uint16_t {
+    std::chrono::year_month_day today{std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now())};
+    return CreditCard::PackExpiry(static_cast<int>(static_cast<unsigned>(today.month())),
+                                  static_cast<int>(today.year()));
+}
+
+// Lists expired cards, then cards expiring within the warning window, each in expiry order
+auto HandleExpiringCards(SodiumStore &store, const UI &ui) -> int {
+    while (true) {
+        uint16_t current = CurrentExpiryKey();
+        std::vector<std::pair<uint32_t, std::string>> cards_list =
+            store.CardsDisplayList(store.FindExpired(current));
+        for (auto &card : cards_list) {
+            card.second += " (EXPIRED)";
+        }
+        std::vector<std::pair<uint32_t, std::string>> expiring =
+            store.CardsDisplayList(store.FindByExpiry(current, current + EXPIRY_WARNING_MONTHS - 1));
+        cards_list.insert(cards_list.end(), expiring.begin(), expiring.end());
+
         int selection = static_cast<int>(ui.CardListMenu(cards_list));
-        if (selection == -1) {
+        if (selection == UI::CARD_LIST_RETURN) {
+            break;
+        }
+
+        HandleCardInfo(store, ui, selection);
+    }
+    return 0;
+}
+
+// Every tag entered must be on a listed card, and none prefixed with '-' may be
+auto HandleCardsFilter(SodiumStore &store, const UI &ui) -> int {
+    std::string input;
+    ui.PromptFilterTags(input);
+
+    CardFilter filter;
+    for (const std::string &tag : CreditCard::SplitTags(input)) {
+        if (tag.size() > 1 && tag[0] == '-') {
+            filter.none_tags.push_back(tag.substr(1));
+        } else {
+            filter.all_tags.push_back(tag);
+        }
+    }
+
+    while (true) {
+        std::vector<std::pair<uint32_t, std::string>> cards_list = store.CardsDisplayList(store.FilterCards(filter));
+        int selection = static_cast<int>(ui.CardListMenu(cards_list));
+        if (selection == UI::CARD_LIST_RETURN) {
             break;
         }
 
@@ -126,7 +380,7 @@ auto HandleCardsList(Store &store, const UI &ui) -> int {
     return 0;
 }
 
-auto HandleCardAdd(Store &store, const UI &ui) -> int {
+auto HandleCardAdd(SodiumStore &store, const UI &ui) -> int {
     CreditCard card;
 
     std::string card_name;
@@ -143,6 +397,22 @@ auto HandleCardAdd(Store &store, const UI &ui) -> int {
         }
     }
 
+    std::string card_tags;
+    error_msg = "";
+    while (true) {
+        ui.PromptCardTags(error_msg, card_tags);
+        if (card_tags == "0") {
+            return 1;
+        }
+        if (card.SetTags(CreditCard::SplitTags(card_tags)) != 0) {
+            error_msg = "ERR: Tags should contain only letters and numbers, at most " +
+                        std::to_string(CreditCard::MAX_TAGS) + " tags of " + std::to_string(CreditCard::MAX_TAG_LEN) +
+                        " characters each!\n";
+        } else {
+            break;
+        }
+    }
+
     std::string card_number;
     error_msg = "";
     while (true) {
@@ -196,11 +466,10 @@ auto HandleCardAdd(Store &store, const UI &ui) -> int {
         }
     }
 
-    store.AddCard(card);
-    return 0;
+    return store.AddCard(card) == Store::ADD_CARD_VALID ? 0 : -1;
 }
 
-auto HandleCardDelete(Store &store, const UI &ui) -> int {
+auto HandleCardDelete(SodiumStore &store, const UI &ui) -> int {
     while (true) {
         std::vector<std::pair<uint32_t, std::string>> cards_list = store.CardsDisplayList();
         int selection = ui.CardDeleteMenu(cards_list);
@@ -213,7 +482,7 @@ auto HandleCardDelete(Store &store, const UI &ui) -> int {
     return 0;
 }
 
-void HandleSaveStore(Store &store) {
+void HandleSaveStore(SodiumStore &store) {
     std::string status_msg;
 
     switch (store.SaveStore()) {
@@ -231,12 +500,15 @@ void HandleSaveStore(Store &store) {
     case Store::SAVE_STORE_COMMIT_TEMP_ERR:
         status_msg = "Failed to commit new data!";
         break;
+    case Store::SAVE_STORE_REOPEN_ERR:
+        status_msg = "Cards saved, but failed to reopen the data file!";
+        break;
     }
 
     std::cout << status_msg << std::endl;
 }
 
-auto HandleLogin(Store &store, UI &ui, std::shared_ptr<SodiumCrypto> &sodium_crypto) -> int {
+auto HandleLogin(SodiumStore &store, UI &ui, std::shared_ptr<SodiumCrypto> &sodium_crypto, uint32_t generation) -> int {
     std::string status_msg;
     while (true) {
         bool profile_exists = store.StoreExists(false);
@@ -257,7 +529,7 @@ auto HandleLogin(Store &store, UI &ui, std::shared_ptr<SodiumCrypto> &sodium_cry
             }
             break;
         case UI::OPT_START_LOGIN:
-            switch (HandleLogin(store, ui)) {
+            switch (HandleLogin(store, ui, generation)) {
             case Store::LOAD_STORE_VALID:
                 return 0;
                 break;
@@ -267,6 +539,9 @@ auto HandleLogin(Store &store, UI &ui, std::shared_ptr<SodiumCrypto> &sodium_cry
             case Store::LOAD_STORE_HEADER_READ_ERR:
                 status_msg = "ERR: Login failed. Unable to read data file.\n";
                 break;
+            case Store::LOAD_STORE_CIPHER_SUITE_ERR:
+                status_msg = "ERR: Login failed. Data file cipher is not supported on this machine.\n";
+                break;
             case Store::LOAD_STORE_PWD_VERIFY_ERR:
                 status_msg = "ERR: Login failed. Please ensure password is correct.\n";
                 break;
@@ -285,10 +560,45 @@ auto HandleLogin(Store &store, UI &ui, std::shared_ptr<SodiumCrypto> &sodium_cry
     }
 }
 
+auto KeyCacheSeconds() -> uint32_t {
+    const char *value = getenv(KEY_CACHE_SECONDS_ENV);
+    if (value == nullptr || *value == 0) {
+        return 0;
+    }
+    char *end = nullptr;
+    unsigned long parsed = strtoul(value, &end, 10);
+    return *end == 0 && parsed <= UINT32_MAX ? static_cast<uint32_t>(parsed) : 0;
+}
+
+// Accepts no arguments, or "restore --generation N" to log into backup N and make it the live store
+auto ParseRestoreGeneration(int argc, char *argv[], uint32_t *generation) -> int {
+    *generation = 0;
+    if (argc == 1) {
+        return 0;
+    }
+    if (argc != 4 || strcmp(argv[1], "restore") != 0 || strcmp(argv[2], "--generation") != 0) {
+        return -1;
+    }
+
+    char *end = nullptr;
+    unsigned long parsed = strtoul(argv[3], &end, 10);
+    if (*argv[3] == 0 || *end != 0 || parsed < 1 || parsed > BACKUP_GENERATIONS) {
+        return -1;
+    }
+    *generation = static_cast<uint32_t>(parsed);
+    return 0;
+}
+
 volatile sig_atomic_t int_received = 0;
 void SigintHandler(int signum) { int_received = 1; }
 
-auto main() -> int {
+auto main(int argc, char *argv[]) -> int {
+    uint32_t generation = 0;
+    if (ParseRestoreGeneration(argc, argv, &generation) != 0) {
+        std::cerr << "Usage: " << argv[0] << " [restore --generation <1-" << BACKUP_GENERATIONS << ">]\n";
+        return -1;
+    }
+
     std::string store_path = GetStorePath();
     if (store_path.empty()) {
         std::cerr << "Failed to determine path for data file.\n";
@@ -297,17 +607,24 @@ auto main() -> int {
 
     UI ui = UI();
     auto sodium_crypto = std::make_shared<SodiumCrypto>();
-    auto fstream_fileio = std::make_unique<FStreamFileIO>(store_path);
-    Store store(sodium_crypto, std::move(fstream_fileio));
+    auto posix_fileio = std::make_unique<PosixFileIO>(store_path, PosixFileIO::DURABILITY_FULL, BACKUP_GENERATIONS);
+    SodiumStore store(sodium_crypto, std::move(posix_fileio));
+    if (uint32_t key_cache_seconds = KeyCacheSeconds(); key_cache_seconds != 0) {
+        store.SetKeyCache(std::make_shared<KeyringKeyCache>(), key_cache_seconds);
+    }
 
     if (sodium_crypto->InitCrypto() == -1) {
         std::cerr << "Failed to init crypto.\n";
         return -1;
     }
 
-    if (HandleLogin(store, ui, sodium_crypto) != 0) {
+    if (HandleLogin(store, ui, sodium_crypto, generation) != 0) {
         return 0;
     }
+    if (generation != 0) {
+        HandleSaveStore(store); // the current store becomes backup 1, so the restore can itself be undone
+    }
+    store.SetAutosave(AUTOSAVE_WINDOW_MS, AUTOSAVE_MAX_UNSAVED_MS);
 
     struct sigaction sa;
     sa.sa_handler = SigintHandler;
@@ -319,27 +636,96 @@ auto main() -> int {
     }
 
     std::string status_msg;
+    CardOrders::Order list_order = CardOrders::ORDER_CREATED;
+    std::shared_future<Store::SaveStoreStatus> pending_save; // card edits are saved in the background, exit waits
     while (true) {
         if (int_received != 0) {
             HandleSaveStore(store);
             return 0;
         }
 
+        status_msg += KeyRotationStatus(store, &pending_save);
+        status_msg += BackgroundSaveStatus(&pending_save);
         UI::ProfileMenuOption selection = ui.ProfileMenu(status_msg);
+        status_msg.clear();
+
+        // Cards can be read, added and deleted during a rotation, but header changes would wait for it to end
+        bool rotating = store.KeyRotationStarted() && !store.KeyRotationDone();
+        if (rotating && (selection == UI::OPT_PROFILE_CHANGE_PASSWORD || selection == UI::OPT_PROFILE_ROTATE_KEY ||
+                         selection == UI::OPT_PROFILE_ADD_KEY_SLOT || selection == UI::OPT_PROFILE_REMOVE_KEY_SLOT)) {
+            status_msg = "ERR: Wait for the data key rotation to finish.\n";
+            continue;
+        }
+
         switch (selection) {
         case UI::OPT_PROFILE_EXIT:
             HandleSaveStore(store);
             return 0;
         case UI::OPT_PROFILE_LIST:
-            HandleCardsList(store, ui);
+            HandleCardsList(store, ui, list_order);
             break;
         case UI::OPT_PROFILE_ADD:
-            if (HandleCardAdd(store, ui) != 0) {
-                continue;
+            if (HandleCardAdd(store, ui) == -1) {
+                status_msg = "ERR: A card with this number is already saved.\n";
             }
+            pending_save = store.ScheduledSave();
             break;
         case UI::OPT_PROFILE_DEL:
             HandleCardDelete(store, ui);
+            pending_save = store.ScheduledSave();
+            break;
+        case UI::OPT_PROFILE_EXPIRING:
+            HandleExpiringCards(store, ui);
+            break;
+        case UI::OPT_PROFILE_FILTER:
+            HandleCardsFilter(store, ui);
+            break;
+        case UI::OPT_PROFILE_CHANGE_PASSWORD:
+            switch (HandlePasswordChange(store, ui, sodium_crypto)) {
+            case Store::CHANGE_PASSWORD_VALID:
+                status_msg = "Master password changed.\n";
+                break;
+            case Store::CHANGE_PASSWORD_VERIFY_ERR:
+                status_msg = "ERR: Incorrect master password.\n";
+                break;
+            case Store::CHANGE_PASSWORD_KEY_ERR:
+            case Store::CHANGE_PASSWORD_WRITE_ERR:
+                status_msg = "ERR: Failed to change the master password.\n";
+                break;
+            case Store::CHANGE_PASSWORD_REOPEN_ERR:
+                status_msg = "ERR: Master password changed, but the data file could not be reopened. Restart to read "
+                             "cards.\n";
+                break;
+            }
+            break;
+        case UI::OPT_PROFILE_ROTATE_KEY:
+            switch (HandleKeyRotation(store, ui, sodium_crypto)) {
+            case Store::ROTATE_KEY_VALID:
+                status_msg = "Data key rotation started.\n";
+                break;
+            case Store::ROTATE_KEY_VERIFY_ERR:
+                status_msg = "ERR: Incorrect master password.\n";
+                break;
+            case Store::ROTATE_KEY_BUSY_ERR:
+                status_msg = "ERR: Wait for the data key rotation to finish.\n";
+                break;
+            case Store::ROTATE_KEY_SLOTS_ERR:
+                status_msg = "ERR: Remove the extra key slots before rotating the data key.\n";
+                break;
+            case Store::ROTATE_KEY_KEY_ERR:
+            case Store::ROTATE_KEY_WRITE_ERR:
+                status_msg = "ERR: Failed to rotate the data key.\n";
+                break;
+            case Store::ROTATE_KEY_REOPEN_ERR:
+                status_msg = "ERR: Cards saved, but the data file could not be reopened. Restart to read cards.\n";
+                break;
+            }
+            break;
+        case UI::OPT_PROFILE_ADD_KEY_SLOT:
+            status_msg = KeySlotStatusMessage(HandleAddKeySlot(store, ui, sodium_crypto), "Key slot added.\n");
+            break;
+        case UI::OPT_PROFILE_REMOVE_KEY_SLOT:
+            status_msg = KeySlotStatusMessage(HandleRemoveKeySlot(store, ui, sodium_crypto), "");
             break;
         }
     }
@@ -0,0 +1,408 @@
+#include "argon2id.hpp"
+#include "kdfarena.hpp"
+#include "utils.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <new>
+#include <sodium.h>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const uint32_t VERSION = 0x13;
+const uint32_t TYPE = 2;
+const uint32_t SYNC_POINTS = 4; // slices per pass; lanes only synchronize between slices
+const size_t BLOCK_LEN = 1024;
+const size_t BLOCK_WORDS = BLOCK_LEN / sizeof(uint64_t);
+const size_t PREHASH_LEN = 64;
+const size_t BLAKE2B_OUT_LEN = 64;
+
+struct Block {
+    uint64_t v[BLOCK_WORDS];
+};
+
+// The shape of one derivation's memory, shared by the lanes filling it
+struct Instance {
+    Block *memory;
+    uint32_t passes;
+    uint32_t lanes;
+    uint32_t lane_length;
+    uint32_t segment_length;
+    uint32_t memory_blocks;
+};
+
+// H' of the RFC: BLAKE2b stretched to out_len bytes by chaining 64-byte digests and keeping half of each
+void HashLong(unsigned char *out, size_t out_len, const unsigned char *in, size_t in_len) {
+    std::vector<unsigned char> buf(sizeof(uint32_t) + in_len);
+    StoreLE32(buf.data(), static_cast<uint32_t>(out_len));
+    std::memcpy(buf.data() + sizeof(uint32_t), in, in_len);
+    if (out_len <= BLAKE2B_OUT_LEN) {
+        crypto_generichash(out, out_len, buf.data(), buf.size(), nullptr, 0);
+        sodium_memzero(buf.data(), buf.size());
+        return;
+    }
+
+    std::array<unsigned char, BLAKE2B_OUT_LEN> digest;
+    std::array<unsigned char, BLAKE2B_OUT_LEN> next;
+    crypto_generichash(digest.data(), digest.size(), buf.data(), buf.size(), nullptr, 0);
+    sodium_memzero(buf.data(), buf.size());
+    std::memcpy(out, digest.data(), BLAKE2B_OUT_LEN / 2);
+    out += BLAKE2B_OUT_LEN / 2;
+    size_t remaining = out_len - BLAKE2B_OUT_LEN / 2;
+    while (remaining > BLAKE2B_OUT_LEN) {
+        crypto_generichash(next.data(), next.size(), digest.data(), digest.size(), nullptr, 0);
+        digest = next;
+        std::memcpy(out, digest.data(), BLAKE2B_OUT_LEN / 2);
+        out += BLAKE2B_OUT_LEN / 2;
+        remaining -= BLAKE2B_OUT_LEN / 2;
+    }
+    crypto_generichash(out, remaining, digest.data(), digest.size(), nullptr, 0);
+    sodium_memzero(digest.data(), digest.size());
+    sodium_memzero(next.data(), next.size());
+}
+
+#if defined(__SSE2__)
+
+// Two 64-bit lanes per register, so each call runs two of the four column or diagonal mixes of a round at once
+auto BlaMka(__m128i x, __m128i y) -> __m128i {
+    const __m128i z = _mm_mul_epu32(x, y);
+    return _mm_add_epi64(_mm_add_epi64(x, y), _mm_add_epi64(z, z));
+}
+
+template <int BITS> auto Rotr(__m128i x) -> __m128i {
+    if constexpr (BITS == 32) {
+        return _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1));
+    } else if constexpr (BITS == 63) {
+        return _mm_xor_si128(_mm_srli_epi64(x, 63), _mm_add_epi64(x, x));
+    } else {
+        return _mm_xor_si128(_mm_srli_epi64(x, BITS), _mm_slli_epi64(x, 64 - BITS));
+    }
+}
+
+void Mix(__m128i &a, __m128i &b, __m128i &c, __m128i &d) {
+    a = BlaMka(a, b);
+    d = Rotr<32>(_mm_xor_si128(d, a));
+    c = BlaMka(c, d);
+    b = Rotr<24>(_mm_xor_si128(b, c));
+    a = BlaMka(a, b);
+    d = Rotr<16>(_mm_xor_si128(d, a));
+    c = BlaMka(c, d);
+    b = Rotr<63>(_mm_xor_si128(b, c));
+}
+
+// The BLAKE2b round without message words over 16 words held as a0 = (w0, w1), a1 = (w2, w3), b0 = (w4, w5) and so
+// on; the diagonal step rotates the b, c and d rows across register pairs and back
+void Permute(__m128i &a0, __m128i &a1, __m128i &b0, __m128i &b1, __m128i &c0, __m128i &c1, __m128i &d0,
+             __m128i &d1) {
+    Mix(a0, b0, c0, d0);
+    Mix(a1, b1, c1, d1);
+
+    __m128i t0 = d0;
+    __m128i t1 = b0;
+    std::swap(c0, c1);
+    d0 = _mm_unpackhi_epi64(d1, _mm_unpacklo_epi64(t0, t0));
+    d1 = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(d1, d1));
+    b0 = _mm_unpackhi_epi64(b0, _mm_unpacklo_epi64(b1, b1));
+    b1 = _mm_unpackhi_epi64(b1, _mm_unpacklo_epi64(t1, t1));
+
+    Mix(a0, b0, c0, d0);
+    Mix(a1, b1, c1, d1);
+
+    std::swap(c0, c1);
+    t0 = b0;
+    t1 = d0;
+    b0 = _mm_unpackhi_epi64(b1, _mm_unpacklo_epi64(b0, b0));
+    b1 = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(b1, b1));
+    d0 = _mm_unpackhi_epi64(d0, _mm_unpacklo_epi64(d1, d1));
+    d1 = _mm_unpackhi_epi64(d1, _mm_unpacklo_epi64(t1, t1));
+}
+
+// The compression function G; from the second pass on, version 1.3 XORs the result into the block it overwrites.
+// Row i of the 8x8 matrix of 16-byte registers is r[8i..8i+7] and column i is r[i], r[8 + i], ..., r[56 + i].
+void FillBlock(const Block &prev, const Block &ref, Block *next, bool with_xor) {
+    const size_t regs = BLOCK_WORDS / 2;
+    __m128i r[regs];
+    __m128i tmp[regs];
+    for (size_t i = 0; i < regs; ++i) {
+        r[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(prev.v + 2 * i)),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i *>(ref.v + 2 * i)));
+        tmp[i] = with_xor ? _mm_xor_si128(r[i], _mm_loadu_si128(reinterpret_cast<const __m128i *>(next->v + 2 * i)))
+                          : r[i];
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        Permute(r[8 * i], r[8 * i + 1], r[8 * i + 2], r[8 * i + 3], r[8 * i + 4], r[8 * i + 5], r[8 * i + 6],
+                r[8 * i + 7]);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        Permute(r[i], r[8 + i], r[16 + i], r[24 + i], r[32 + i], r[40 + i], r[48 + i], r[56 + i]);
+    }
+    for (size_t i = 0; i < regs; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(next->v + 2 * i), _mm_xor_si128(tmp[i], r[i]));
+    }
+}
+
+#else
+
+auto BlaMka(uint64_t x, uint64_t y) -> uint64_t { return x + y + 2 * (x & 0xffffffff) * (y & 0xffffffff); }
+
+void Mix(uint64_t &a, uint64_t &b, uint64_t &c, uint64_t &d) {
+    a = BlaMka(a, b);
+    d = std::rotr(d ^ a, 32);
+    c = BlaMka(c, d);
+    b = std::rotr(b ^ c, 24);
+    a = BlaMka(a, b);
+    d = std::rotr(d ^ a, 16);
+    c = BlaMka(c, d);
+    b = std::rotr(b ^ c, 63);
+}
+
+// The BLAKE2b round without message words over 16 words of the block: word j sits at base + (j / 2) * STEP + j % 2,
+// so a STEP of 2 takes a row of the 8x8 matrix of 16-byte registers and a STEP of 16 takes a column
+template <size_t STEP> void Permute(uint64_t *block, size_t base) {
+    uint64_t w[16];
+    for (size_t j = 0; j < 16; ++j) {
+        w[j] = block[base + (j / 2) * STEP + j % 2];
+    }
+    Mix(w[0], w[4], w[8], w[12]);
+    Mix(w[1], w[5], w[9], w[13]);
+    Mix(w[2], w[6], w[10], w[14]);
+    Mix(w[3], w[7], w[11], w[15]);
+    Mix(w[0], w[5], w[10], w[15]);
+    Mix(w[1], w[6], w[11], w[12]);
+    Mix(w[2], w[7], w[8], w[13]);
+    Mix(w[3], w[4], w[9], w[14]);
+    for (size_t j = 0; j < 16; ++j) {
+        block[base + (j / 2) * STEP + j % 2] = w[j];
+    }
+}
+
+// The compression function G; from the second pass on, version 1.3 XORs the result into the block it overwrites
+void FillBlock(const Block &prev, const Block &ref, Block *next, bool with_xor) {
+    Block r;
+    Block tmp;
+    for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+        r.v[i] = prev.v[i] ^ ref.v[i];
+        tmp.v[i] = with_xor ? r.v[i] ^ next->v[i] : r.v[i];
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        Permute<2>(r.v, 16 * i);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        Permute<16>(r.v, 2 * i);
+    }
+    for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+        next->v[i] = tmp.v[i] ^ r.v[i];
+    }
+}
+
+#endif
+
+// The next block of data-independent pseudo-random words, generated by G twice over a counter block
+void NextAddresses(Block *address_block, Block *input_block) {
+    static const Block ZERO_BLOCK = {};
+    input_block->v[6]++;
+    FillBlock(ZERO_BLOCK, *input_block, address_block, false);
+    FillBlock(ZERO_BLOCK, *address_block, address_block, false);
+}
+
+// Maps the low 32 bits of a pseudo-random word onto the blocks a reference may be taken from: every finished block of
+// the reference lane except those of the current slice in other lanes, and except the block just before this one
+auto ReferenceIndex(const Instance &instance, uint32_t pass, uint32_t slice, uint32_t index, uint32_t pseudo_rand,
+                    bool same_lane) -> uint32_t {
+    uint32_t area_size = 0;
+    if (pass == 0) {
+        if (slice == 0) {
+            area_size = index - 1;
+        } else if (same_lane) {
+            area_size = slice * instance.segment_length + index - 1;
+        } else {
+            area_size = slice * instance.segment_length - (index == 0 ? 1 : 0);
+        }
+    } else if (same_lane) {
+        area_size = instance.lane_length - instance.segment_length + index - 1;
+    } else {
+        area_size = instance.lane_length - instance.segment_length - (index == 0 ? 1 : 0);
+    }
+
+    uint64_t relative = pseudo_rand;
+    relative = (relative * relative) >> 32;
+    relative = area_size - 1 - ((area_size * relative) >> 32);
+    uint32_t start = 0;
+    if (pass != 0 && slice != SYNC_POINTS - 1) {
+        start = (slice + 1) * instance.segment_length;
+    }
+    return static_cast<uint32_t>((start + relative) % instance.lane_length);
+}
+
+// Argon2id takes its references independently of the data for the first half of the first pass and from the
+// previous block after that
+void FillSegment(const Instance &instance, uint32_t pass, uint32_t lane, uint32_t slice) {
+    bool data_independent = pass == 0 && slice < SYNC_POINTS / 2;
+    Block address_block = {};
+    Block input_block = {};
+    if (data_independent) {
+        input_block.v[0] = pass;
+        input_block.v[1] = lane;
+        input_block.v[2] = slice;
+        input_block.v[3] = instance.memory_blocks;
+        input_block.v[4] = instance.passes;
+        input_block.v[5] = TYPE;
+    }
+
+    uint32_t start_index = 0;
+    if (pass == 0 && slice == 0) {
+        start_index = 2; // the first two blocks of each lane come from the initial hash
+        if (data_independent) {
+            NextAddresses(&address_block, &input_block);
+        }
+    }
+
+    uint64_t lane_start = static_cast<uint64_t>(lane) * instance.lane_length;
+    uint32_t offset = slice * instance.segment_length + start_index;
+    for (uint32_t i = start_index; i < instance.segment_length; ++i, ++offset) {
+        uint32_t prev_offset = offset == 0 ? instance.lane_length - 1 : offset - 1;
+
+        uint64_t pseudo_rand = 0;
+        if (data_independent) {
+            if (i % BLOCK_WORDS == 0) {
+                NextAddresses(&address_block, &input_block);
+            }
+            pseudo_rand = address_block.v[i % BLOCK_WORDS];
+        } else {
+            pseudo_rand = instance.memory[lane_start + prev_offset].v[0];
+        }
+
+        uint32_t ref_lane = static_cast<uint32_t>((pseudo_rand >> 32) % instance.lanes);
+        if (pass == 0 && slice == 0) {
+            ref_lane = lane;
+        }
+        uint32_t ref_index = ReferenceIndex(instance, pass, slice, i, static_cast<uint32_t>(pseudo_rand),
+                                            ref_lane == lane);
+        const Block &ref = instance.memory[static_cast<uint64_t>(ref_lane) * instance.lane_length + ref_index];
+        FillBlock(instance.memory[lane_start + prev_offset], ref, &instance.memory[lane_start + offset], pass != 0);
+    }
+    sodium_memzero(&address_block, sizeof(address_block));
+}
+
+// H0 of the RFC over the parameters and inputs, each length-prefixed
+void InitialHash(unsigned char *prehash, size_t out_len, std::span<const unsigned char> password,
+                 std::span<const unsigned char> salt, std::span<const unsigned char> secret,
+                 std::span<const unsigned char> ad, uint32_t t_cost, uint32_t m_cost, uint32_t lanes) {
+    std::vector<unsigned char> buf(10 * sizeof(uint32_t) + password.size() + salt.size() + secret.size() + ad.size());
+    unsigned char *pos = buf.data();
+    for (uint32_t value : {lanes, static_cast<uint32_t>(out_len), m_cost, t_cost, VERSION, TYPE}) {
+        StoreLE32(pos, value);
+        pos += sizeof(uint32_t);
+    }
+    for (std::span<const unsigned char> input : {password, salt, secret, ad}) {
+        StoreLE32(pos, static_cast<uint32_t>(input.size()));
+        pos += sizeof(uint32_t);
+        if (!input.empty()) {
+            std::memcpy(pos, input.data(), input.size());
+            pos += input.size();
+        }
+    }
+    crypto_generichash(prehash, PREHASH_LEN, buf.data(), buf.size(), nullptr, 0);
+    sodium_memzero(buf.data(), buf.size());
+}
+
+void LoadBlock(Block *block, const unsigned char *bytes) {
+    for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+        block->v[i] = LoadLE64(bytes + i * sizeof(uint64_t));
+    }
+}
+
+} // namespace
+
+Argon2id::Argon2id(size_t threads, bool reuse_memory) {
+    if (threads > 1) {
+        this->pool_ = std::make_unique<ThreadPool>(threads);
+    }
+    if (reuse_memory) {
+        this->arena_ = std::make_unique<KdfArena>();
+    }
+}
+
+auto Argon2id::Hash(std::span<unsigned char> out, std::span<const unsigned char> password,
+                    std::span<const unsigned char> salt, uint32_t t_cost, uint32_t m_cost, uint32_t lanes,
+                    std::span<const unsigned char> secret, std::span<const unsigned char> ad) -> int {
+    if (out.size() < MIN_OUT_LEN || out.size() > UINT32_MAX || salt.size() < MIN_SALT_LEN || t_cost == 0 ||
+        lanes == 0 || lanes > MAX_LANES || m_cost < 8 * lanes) {
+        return -1;
+    }
+
+    Instance instance = {};
+    instance.passes = t_cost;
+    instance.lanes = lanes;
+    instance.segment_length = m_cost / (SYNC_POINTS * lanes);
+    instance.lane_length = instance.segment_length * SYNC_POINTS;
+    instance.memory_blocks = instance.lane_length * lanes;
+    std::unique_ptr<Block[]> owned_memory;
+    Block *memory = nullptr;
+    if (this->arena_ != nullptr) {
+        memory = static_cast<Block *>(this->arena_->Acquire(instance.memory_blocks * sizeof(Block)));
+    } else {
+        owned_memory.reset(new (std::nothrow) Block[instance.memory_blocks]);
+        memory = owned_memory.get();
+    }
+    if (memory == nullptr) {
+        return -1;
+    }
+    instance.memory = memory;
+
+    std::array<unsigned char, PREHASH_LEN + 2 * sizeof(uint32_t)> seed;
+    std::array<unsigned char, BLOCK_LEN> block_bytes;
+    InitialHash(seed.data(), out.size(), password, salt, secret, ad, t_cost, m_cost, lanes);
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+        for (uint32_t i = 0; i < 2; ++i) {
+            StoreLE32(seed.data() + PREHASH_LEN, i);
+            StoreLE32(seed.data() + PREHASH_LEN + sizeof(uint32_t), lane);
+            HashLong(block_bytes.data(), BLOCK_LEN, seed.data(), seed.size());
+            LoadBlock(&memory[static_cast<uint64_t>(lane) * instance.lane_length + i], block_bytes.data());
+        }
+    }
+    sodium_memzero(seed.data(), seed.size());
+
+    for (uint32_t pass = 0; pass < t_cost; ++pass) {
+        for (uint32_t slice = 0; slice < SYNC_POINTS; ++slice) {
+            if (this->pool_ == nullptr || lanes == 1) {
+                for (uint32_t lane = 0; lane < lanes; ++lane) {
+                    FillSegment(instance, pass, lane, slice);
+                }
+                continue;
+            }
+            for (uint32_t lane = 0; lane < lanes; ++lane) {
+                this->pool_->Submit([&instance, pass, lane, slice] { FillSegment(instance, pass, lane, slice); });
+            }
+            this->pool_->Wait();
+        }
+    }
+
+    Block final_block = memory[instance.lane_length - 1];
+    for (uint32_t lane = 1; lane < lanes; ++lane) {
+        const Block &last = memory[static_cast<uint64_t>(lane) * instance.lane_length + instance.lane_length - 1];
+        for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+            final_block.v[i] ^= last.v[i];
+        }
+    }
+    for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+        StoreLE64(block_bytes.data() + i * sizeof(uint64_t), final_block.v[i]);
+    }
+    HashLong(out.data(), out.size(), block_bytes.data(), block_bytes.size());
+
+    sodium_memzero(block_bytes.data(), block_bytes.size());
+    sodium_memzero(&final_block, sizeof(final_block));
+    if (this->arena_ != nullptr) {
+        this->arena_->Release();
+    } else {
+        sodium_memzero(memory, instance.memory_blocks * sizeof(Block));
+    }
+    return 0;
+}
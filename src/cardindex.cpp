@@ -0,0 +1,168 @@
+#include "cardindex.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Ids are only ever handed out in increasing order, so appending keeps each list sorted
+void RemoveId(std::vector<uint32_t> &ids, uint32_t id) {
+    auto it = std::lower_bound(ids.begin(), ids.end(), id);
+    if (it != ids.end() && *it == id) {
+        ids.erase(it);
+    }
+}
+
+} // namespace
+
+void CardIndex::Insert(const RecordDirectory::Entry &entry) {
+    std::string name = NormalizeName(entry.name);
+    this->by_name_[name].push_back(entry.id);
+    this->name_order_.emplace(std::move(name), entry.id);
+
+    if (entry.metadata.fingerprint != RecordDirectory::Fingerprint{}) {
+        this->by_fingerprint_[entry.metadata.fingerprint].push_back(entry.id);
+    }
+    if (entry.metadata.expiry != 0) {
+        this->by_expiry_.emplace(entry.metadata.expiry, entry.id);
+    }
+
+    this->all_ids_.Add(entry.id);
+    this->by_network_[entry.metadata.network].Add(entry.id);
+    for (const std::string &tag : entry.metadata.tags) {
+        this->by_tag_[NormalizeName(tag)].Add(entry.id);
+    }
+}
+
+void CardIndex::Remove(const RecordDirectory::Entry &entry) {
+    std::string name = NormalizeName(entry.name);
+    auto ids = this->by_name_.find(name);
+    if (ids != this->by_name_.end()) {
+        RemoveId(ids->second, entry.id);
+        if (ids->second.empty()) {
+            this->by_name_.erase(ids);
+        }
+    }
+    this->name_order_.erase({name, entry.id});
+
+    auto fingerprint_ids = this->by_fingerprint_.find(entry.metadata.fingerprint);
+    if (fingerprint_ids != this->by_fingerprint_.end()) {
+        RemoveId(fingerprint_ids->second, entry.id);
+        if (fingerprint_ids->second.empty()) {
+            this->by_fingerprint_.erase(fingerprint_ids);
+        }
+    }
+    this->by_expiry_.erase({entry.metadata.expiry, entry.id});
+
+    this->all_ids_.Remove(entry.id);
+    auto network_ids = this->by_network_.find(entry.metadata.network);
+    if (network_ids != this->by_network_.end()) {
+        network_ids->second.Remove(entry.id);
+        if (network_ids->second.Empty()) {
+            this->by_network_.erase(network_ids);
+        }
+    }
+    for (const std::string &tag : entry.metadata.tags) {
+        auto tag_ids = this->by_tag_.find(NormalizeName(tag));
+        if (tag_ids != this->by_tag_.end()) {
+            tag_ids->second.Remove(entry.id);
+            if (tag_ids->second.Empty()) {
+                this->by_tag_.erase(tag_ids);
+            }
+        }
+    }
+}
+
+void CardIndex::Clear() {
+    this->by_name_.clear();
+    this->name_order_.clear();
+    this->by_fingerprint_.clear();
+    this->by_expiry_.clear();
+    this->all_ids_ = {};
+    this->by_tag_.clear();
+    this->by_network_.clear();
+}
+
+auto CardIndex::FindByName(const std::string &name) const -> std::vector<uint32_t> {
+    auto ids = this->by_name_.find(NormalizeName(name));
+    return ids != this->by_name_.end() ? ids->second : std::vector<uint32_t>{};
+}
+
+auto CardIndex::FindByNamePrefix(const std::string &prefix) const -> std::vector<uint32_t> {
+    std::string normalized = NormalizeName(prefix);
+    std::vector<uint32_t> result;
+    for (auto it = this->name_order_.lower_bound({normalized, 0});
+         it != this->name_order_.end() && it->first.starts_with(normalized); ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+auto CardIndex::FindByFingerprint(const RecordDirectory::Fingerprint &fingerprint) const -> std::vector<uint32_t> {
+    auto ids = this->by_fingerprint_.find(fingerprint);
+    return ids != this->by_fingerprint_.end() ? ids->second : std::vector<uint32_t>{};
+}
+
+auto CardIndex::ContainsFingerprint(const RecordDirectory::Fingerprint &fingerprint) const -> bool {
+    return this->by_fingerprint_.contains(fingerprint);
+}
+
+auto CardIndex::FindByExpiry(uint16_t first, uint16_t last) const -> std::vector<uint32_t> {
+    std::vector<uint32_t> result;
+    for (auto it = this->by_expiry_.lower_bound({std::max<uint16_t>(first, 1), 0});
+         it != this->by_expiry_.end() && it->first <= last; ++it) {
+        result.push_back(it->second);
+    }
+    return result;
+}
+
+auto CardIndex::ExpiryOrder() const -> std::vector<uint32_t> {
+    std::vector<uint32_t> result;
+    result.reserve(this->by_expiry_.size());
+    for (const auto &[expiry, id] : this->by_expiry_) {
+        result.push_back(id);
+    }
+    return result;
+}
+
+auto CardIndex::Filter(const CardFilter &filter) const -> std::vector<uint32_t> {
+    IdBitmap result = this->all_ids_;
+    for (const std::string &tag : filter.all_tags) {
+        result = result.And(Lookup(this->by_tag_, NormalizeName(tag)));
+    }
+    if (!filter.any_tags.empty()) {
+        IdBitmap any;
+        for (const std::string &tag : filter.any_tags) {
+            any = any.Or(Lookup(this->by_tag_, NormalizeName(tag)));
+        }
+        result = result.And(any);
+    }
+    if (!filter.networks.empty()) {
+        IdBitmap any;
+        for (CreditCard::CardNetwork network : filter.networks) {
+            auto ids = this->by_network_.find(static_cast<uint8_t>(network));
+            if (ids != this->by_network_.end()) {
+                any = any.Or(ids->second);
+            }
+        }
+        result = result.And(any);
+    }
+    for (const std::string &tag : filter.none_tags) {
+        result = result.AndNot(Lookup(this->by_tag_, NormalizeName(tag)));
+    }
+    return result.ToVector();
+}
+
+auto CardIndex::NormalizeName(const std::string &name) -> std::string {
+    std::string normalized = name;
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return normalized;
+}
+
+auto CardIndex::Lookup(const std::unordered_map<std::string, IdBitmap> &bitmaps, const std::string &key)
+    -> const IdBitmap & {
+    static const IdBitmap EMPTY;
+    auto ids = bitmaps.find(key);
+    return ids != bitmaps.end() ? ids->second : EMPTY;
+}
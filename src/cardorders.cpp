@@ -0,0 +1,61 @@
+#include "cardorders.hpp"
+#include "cardindex.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+void CardOrders::Insert(const RecordDirectory::Entry &entry) {
+    for (int order = 0; order < ORDER_COUNT; ++order) {
+        SortKey key = MakeKey(static_cast<Order>(order), entry);
+        auto pos = std::lower_bound(this->keys_[order].begin(), this->keys_[order].end(), key);
+        auto offset = pos - this->keys_[order].begin();
+        this->keys_[order].insert(pos, std::move(key));
+        this->ids_[order].insert(this->ids_[order].begin() + offset, entry.id);
+    }
+}
+
+void CardOrders::Remove(const RecordDirectory::Entry &entry) {
+    for (int order = 0; order < ORDER_COUNT; ++order) {
+        SortKey key = MakeKey(static_cast<Order>(order), entry);
+        auto pos = std::lower_bound(this->keys_[order].begin(), this->keys_[order].end(), key);
+        if (pos == this->keys_[order].end() || pos->id != entry.id) {
+            continue;
+        }
+        auto offset = pos - this->keys_[order].begin();
+        this->keys_[order].erase(pos);
+        this->ids_[order].erase(this->ids_[order].begin() + offset);
+    }
+}
+
+void CardOrders::Clear() {
+    for (int order = 0; order < ORDER_COUNT; ++order) {
+        this->keys_[order].clear();
+        this->ids_[order].clear();
+    }
+}
+
+auto CardOrders::Ids(Order order) const -> const std::vector<uint32_t> & { return this->ids_[order]; }
+
+auto CardOrders::SortKey::operator<(const SortKey &other) const -> bool {
+    return std::tie(this->primary, this->name, this->id) < std::tie(other.primary, other.name, other.id);
+}
+
+auto CardOrders::MakeKey(Order order, const RecordDirectory::Entry &entry) -> SortKey {
+    const RecordDirectory::Metadata &metadata = entry.metadata;
+    switch (order) {
+    case ORDER_NAME:
+        return {.primary = 0, .name = CardIndex::NormalizeName(entry.name), .id = entry.id};
+    case ORDER_NETWORK:
+        return {.primary = metadata.network, .name = CardIndex::NormalizeName(entry.name), .id = entry.id};
+    case ORDER_EXPIRY:
+        return {.primary = metadata.expiry != 0 ? metadata.expiry : UINT64_MAX,
+                .name = CardIndex::NormalizeName(entry.name),
+                .id = entry.id};
+    case ORDER_LAST_USED:
+        return {.primary = UINT64_MAX - metadata.last_used,
+                .name = CardIndex::NormalizeName(entry.name),
+                .id = entry.id};
+    default:
+        return {.primary = 0, .name = {}, .id = entry.id};
+    }
+}
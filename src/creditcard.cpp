@@ -1,7 +1,10 @@
 #include "creditcard.hpp"
 #include "verification.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
+#include <sstream>
 
 auto CreditCard::SetName(const std::string &name) -> int {
     if (!name.empty() && !ValidateInputAlnumOnly(name)) {
@@ -57,6 +60,28 @@ auto CreditCard::SetYear(const std::string &year) -> int {
     return 0;
 }
 
+auto CreditCard::SetTags(const std::vector<std::string> &tags) -> int {
+    std::vector<std::string> normalized;
+    for (const std::string &tag : tags) {
+        if (tag.empty() || tag.size() > MAX_TAG_LEN ||
+            !std::all_of(tag.begin(), tag.end(), [](unsigned char c) { return std::isalnum(c) != 0; })) {
+            return -1;
+        }
+        std::string lower = tag;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        normalized.push_back(std::move(lower));
+    }
+    std::sort(normalized.begin(), normalized.end());
+    normalized.erase(std::unique(normalized.begin(), normalized.end()), normalized.end());
+    if (normalized.size() > MAX_TAGS) {
+        return -1;
+    }
+
+    this->tags_ = std::move(normalized);
+    return 0;
+}
+
 auto CreditCard::GetName() const -> std::string {
     if (!this->name_.empty()) {
         return this->name_;
@@ -68,8 +93,29 @@ auto CreditCard::GetName() const -> std::string {
     return "";
 }
 
+auto CreditCard::GetCardNumber() const -> std::string { return this->card_number_; }
+
+auto CreditCard::GetNetwork() const -> CardNetwork { return this->network_; }
+
+auto CreditCard::GetTags() const -> const std::vector<std::string> & { return this->tags_; }
+
+auto CreditCard::GetExpiryKey() const -> uint16_t {
+    if (this->month_.empty() || this->year_.empty()) {
+        return 0;
+    }
+    return PackExpiry(std::stoi(this->month_), std::stoi(this->year_));
+}
+
+auto CreditCard::PackExpiry(int month, int year) -> uint16_t { return static_cast<uint16_t>(year * 12 + month); }
+
+// Tags follow the year as one space-separated field, left out entirely for an untagged card
 auto CreditCard::FormatText() const -> std::string {
-    return this->name_ + "," + this->card_number_ + "," + this->cvv_ + "," + this->month_ + "," + this->year_ + ";";
+    std::string text =
+        this->name_ + "," + this->card_number_ + "," + this->cvv_ + "," + this->month_ + "," + this->year_;
+    if (!this->tags_.empty()) {
+        text += "," + JoinTags(this->tags_);
+    }
+    return text + ";";
 }
 
 void CreditCard::InitFromText(char *text) {
@@ -90,6 +136,30 @@ void CreditCard::InitFromText(char *text) {
 
     field = strtok_r(nullptr, ",", &rest);
     this->SetYear(std::string(field));
+
+    field = strtok_r(nullptr, ",", &rest);
+    this->tags_.clear();
+    if (field != nullptr) {
+        this->SetTags(SplitTags(field));
+    }
+}
+
+auto CreditCard::JoinTags(const std::vector<std::string> &tags) -> std::string {
+    std::string joined;
+    for (const std::string &tag : tags) {
+        joined += (joined.empty() ? "" : " ") + tag;
+    }
+    return joined;
+}
+
+auto CreditCard::SplitTags(const std::string &text) -> std::vector<std::string> {
+    std::vector<std::string> tags;
+    std::istringstream stream(text);
+    std::string tag;
+    while (stream >> tag) {
+        tags.push_back(tag);
+    }
+    return tags;
 }
 
 void CreditCard::DetermineNetwork() {
@@ -137,5 +207,8 @@ auto CreditCardViewModel::GetDisplayFields(const CreditCard &card) const
     fields.emplace_back(UIStrings::CARD_CVV_LABEL, card.cvv_);
     fields.emplace_back(UIStrings::CARD_MONTH_LABEL, card.month_);
     fields.emplace_back(UIStrings::CARD_YEAR_LABEL, card.year_);
+    if (!card.tags_.empty()) {
+        fields.emplace_back(UIStrings::CARD_TAGS_LABEL, CreditCard::JoinTags(card.tags_));
+    }
     return fields;
 }
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <array>
 #include <filesystem>
 
 #include "fstreamfileio.hpp"
@@ -13,6 +15,54 @@ auto FStreamFileIO::WriteTemp(const char *buf, int64_t stream_size) -> bool {
     return !!this->out_stream_.write(buf, stream_size); // Note: '!!' so that true indicates NO error
 }
 
+// iostreams have no access to readv/writev, so segments go through the stream buffer one after another. The small
+// header segments stay buffered and are flushed together with the body rather than by a tellp between writes.
+auto FStreamFileIO::ReadV(std::span<const iovec> segments) -> bool {
+    for (const iovec &segment : segments) {
+        if (!this->in_stream_.read(static_cast<char *>(segment.iov_base), static_cast<int64_t>(segment.iov_len))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto FStreamFileIO::WriteTempV(std::span<const iovec> segments) -> bool {
+    for (const iovec &segment : segments) {
+        if (!this->out_stream_.write(static_cast<const char *>(segment.iov_base),
+                                     static_cast<int64_t>(segment.iov_len))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto FStreamFileIO::ReadAt(char *buf, int64_t len, uint64_t offset) -> bool {
+    std::lock_guard<std::mutex> lock(this->read_at_mutex_);
+    std::streampos position = this->in_stream_.tellg();
+    this->in_stream_.clear();
+    bool read = this->in_stream_.seekg(static_cast<std::streamoff>(offset)) && this->in_stream_.read(buf, len);
+    this->in_stream_.clear();
+    this->in_stream_.seekg(position);
+    return read;
+}
+
+auto FStreamFileIO::CopyToTemp(uint64_t offset, uint64_t len) -> bool {
+    std::array<char, 64 * 1024> buf{};
+    while (len > 0) {
+        auto chunk = static_cast<int64_t>(std::min<uint64_t>(len, buf.size()));
+        if (!this->ReadAt(buf.data(), chunk, offset) || !this->out_stream_.write(buf.data(), chunk)) {
+            return false;
+        }
+        offset += chunk;
+        len -= chunk;
+    }
+    return true;
+}
+
+auto FStreamFileIO::SeekWriteTemp(uint64_t offset) -> bool {
+    return !!this->out_stream_.seekp(static_cast<std::streamoff>(offset));
+}
+
 auto FStreamFileIO::CommitTemp() -> int {
     if (!this->GetExists(false)) {
         if (rename(this->TMP_FILE_PATH.c_str(), this->FILE_PATH.c_str()) != 0) {
@@ -41,9 +91,10 @@ auto FStreamFileIO::CommitTemp() -> int {
     return 0;
 }
 
-auto FStreamFileIO::OpenRead() -> int {
+auto FStreamFileIO::OpenRead(uint32_t generation) -> int {
+    this->read_path_ = GetGenerationPath(this->FILE_PATH, generation);
     try {
-        this->in_stream_.open(this->FILE_PATH, std::ios::binary);
+        this->in_stream_.open(this->read_path_, std::ios::binary);
     } catch (...) {
         return -1;
     }
@@ -77,6 +128,14 @@ auto FStreamFileIO::GetSize(bool temp) -> uintmax_t {
     }
 }
 
+auto FStreamFileIO::GetSizeRead() -> uintmax_t {
+    try {
+        return std::filesystem::file_size(this->read_path_);
+    } catch (...) {
+        return 0;
+    }
+}
+
 auto FStreamFileIO::GetExists(bool temp) -> bool {
     return temp ? CheckFileExists(this->TMP_FILE_PATH) : CheckFileExists(this->FILE_PATH);
 }
@@ -0,0 +1,288 @@
+#include "idbitmap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace {
+
+auto HighBits(uint32_t id) -> uint16_t { return static_cast<uint16_t>(id >> 16); }
+
+auto LowBits(uint32_t id) -> uint16_t { return static_cast<uint16_t>(id & 0xffff); }
+
+auto BitIsSet(const std::vector<uint64_t> &bitset, uint16_t low) -> bool {
+    return ((bitset[low / 64] >> (low % 64)) & 1) != 0;
+}
+
+} // namespace
+
+void IdBitmap::Add(uint32_t id) {
+    uint16_t key = HighBits(id);
+    auto it = std::lower_bound(this->containers_.begin(), this->containers_.end(), key,
+                               [](const Container &container, uint16_t k) { return container.key < k; });
+    if (it == this->containers_.end() || it->key != key) {
+        it = this->containers_.insert(it, Container{.key = key, .cardinality = 0, .array = {}, .bitset = {}});
+    }
+
+    uint16_t low = LowBits(id);
+    if (it->IsBitset()) {
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if ((it->bitset[low / 64] & bit) == 0) {
+            it->bitset[low / 64] |= bit;
+            it->cardinality++;
+        }
+        return;
+    }
+
+    auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+    if (pos != it->array.end() && *pos == low) {
+        return;
+    }
+    it->array.insert(pos, low);
+    it->cardinality++;
+    if (it->cardinality > ARRAY_MAX) {
+        it->ToBitset();
+    }
+}
+
+void IdBitmap::Remove(uint32_t id) {
+    uint16_t key = HighBits(id);
+    auto it = std::lower_bound(this->containers_.begin(), this->containers_.end(), key,
+                               [](const Container &container, uint16_t k) { return container.key < k; });
+    if (it == this->containers_.end() || it->key != key) {
+        return;
+    }
+
+    uint16_t low = LowBits(id);
+    if (it->IsBitset()) {
+        uint64_t bit = uint64_t{1} << (low % 64);
+        if ((it->bitset[low / 64] & bit) != 0) {
+            it->bitset[low / 64] &= ~bit;
+            it->cardinality--;
+        }
+    } else {
+        auto pos = std::lower_bound(it->array.begin(), it->array.end(), low);
+        if (pos != it->array.end() && *pos == low) {
+            it->array.erase(pos);
+            it->cardinality--;
+        }
+    }
+    if (!it->Normalize()) {
+        this->containers_.erase(it);
+    }
+}
+
+auto IdBitmap::Contains(uint32_t id) const -> bool {
+    const Container *container = this->Find(HighBits(id));
+    return container != nullptr && container->Contains(LowBits(id));
+}
+
+auto IdBitmap::Cardinality() const -> uint64_t {
+    uint64_t cardinality = 0;
+    for (const Container &container : this->containers_) {
+        cardinality += container.cardinality;
+    }
+    return cardinality;
+}
+
+auto IdBitmap::Empty() const -> bool { return this->containers_.empty(); }
+
+auto IdBitmap::ToVector() const -> std::vector<uint32_t> {
+    std::vector<uint32_t> ids;
+    ids.reserve(this->Cardinality());
+    for (const Container &container : this->containers_) {
+        uint32_t high = static_cast<uint32_t>(container.key) << 16;
+        if (!container.IsBitset()) {
+            for (uint16_t low : container.array) {
+                ids.push_back(high | low);
+            }
+            continue;
+        }
+        for (uint32_t word = 0; word < BITSET_WORDS; ++word) {
+            for (uint64_t bits = container.bitset[word]; bits != 0; bits &= bits - 1) {
+                ids.push_back(high | (word * 64 + std::countr_zero(bits)));
+            }
+        }
+    }
+    return ids;
+}
+
+auto IdBitmap::And(const IdBitmap &other) const -> IdBitmap {
+    IdBitmap result;
+    auto a = this->containers_.begin();
+    auto b = other.containers_.begin();
+    while (a != this->containers_.end() && b != other.containers_.end()) {
+        if (a->key < b->key) {
+            ++a;
+        } else if (b->key < a->key) {
+            ++b;
+        } else {
+            Container container = AndContainers(*a, *b);
+            if (container.Normalize()) {
+                result.containers_.push_back(std::move(container));
+            }
+            ++a;
+            ++b;
+        }
+    }
+    return result;
+}
+
+auto IdBitmap::Or(const IdBitmap &other) const -> IdBitmap {
+    IdBitmap result;
+    auto a = this->containers_.begin();
+    auto b = other.containers_.begin();
+    while (a != this->containers_.end() || b != other.containers_.end()) {
+        if (b == other.containers_.end() || (a != this->containers_.end() && a->key < b->key)) {
+            result.containers_.push_back(*a++);
+        } else if (a == this->containers_.end() || b->key < a->key) {
+            result.containers_.push_back(*b++);
+        } else {
+            Container container = OrContainers(*a, *b);
+            container.Normalize();
+            result.containers_.push_back(std::move(container));
+            ++a;
+            ++b;
+        }
+    }
+    return result;
+}
+
+auto IdBitmap::AndNot(const IdBitmap &other) const -> IdBitmap {
+    IdBitmap result;
+    auto b = other.containers_.begin();
+    for (const Container &a : this->containers_) {
+        while (b != other.containers_.end() && b->key < a.key) {
+            ++b;
+        }
+        if (b == other.containers_.end() || b->key != a.key) {
+            result.containers_.push_back(a);
+            continue;
+        }
+        Container container = AndNotContainers(a, *b);
+        if (container.Normalize()) {
+            result.containers_.push_back(std::move(container));
+        }
+    }
+    return result;
+}
+
+auto IdBitmap::Container::Contains(uint16_t low) const -> bool {
+    if (this->IsBitset()) {
+        return BitIsSet(this->bitset, low);
+    }
+    return std::binary_search(this->array.begin(), this->array.end(), low);
+}
+
+void IdBitmap::Container::ToBitset() {
+    this->bitset.assign(BITSET_WORDS, 0);
+    for (uint16_t low : this->array) {
+        this->bitset[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    this->array = {};
+}
+
+void IdBitmap::Container::ToArray() {
+    this->array.clear();
+    this->array.reserve(this->cardinality);
+    for (uint32_t word = 0; word < BITSET_WORDS; ++word) {
+        for (uint64_t bits = this->bitset[word]; bits != 0; bits &= bits - 1) {
+            this->array.push_back(static_cast<uint16_t>(word * 64 + std::countr_zero(bits)));
+        }
+    }
+    this->bitset = {};
+}
+
+auto IdBitmap::Container::Normalize() -> bool {
+    if (this->IsBitset() && this->cardinality <= ARRAY_MAX) {
+        this->ToArray();
+    } else if (!this->IsBitset() && this->cardinality > ARRAY_MAX) {
+        this->ToBitset();
+    }
+    return this->cardinality != 0;
+}
+
+auto IdBitmap::Find(uint16_t key) const -> const Container * {
+    auto it = std::lower_bound(this->containers_.begin(), this->containers_.end(), key,
+                               [](const Container &container, uint16_t k) { return container.key < k; });
+    return it != this->containers_.end() && it->key == key ? &*it : nullptr;
+}
+
+auto IdBitmap::AndContainers(const Container &a, const Container &b) -> Container {
+    Container result = {.key = a.key, .cardinality = 0, .array = {}, .bitset = {}};
+    if (a.IsBitset() && b.IsBitset()) {
+        result.bitset.resize(BITSET_WORDS);
+        for (uint32_t word = 0; word < BITSET_WORDS; ++word) {
+            result.bitset[word] = a.bitset[word] & b.bitset[word];
+            result.cardinality += std::popcount(result.bitset[word]);
+        }
+    } else if (a.IsBitset() || b.IsBitset()) {
+        const Container &sparse = a.IsBitset() ? b : a;
+        const Container &dense = a.IsBitset() ? a : b;
+        std::copy_if(sparse.array.begin(), sparse.array.end(), std::back_inserter(result.array),
+                     [&dense](uint16_t low) { return BitIsSet(dense.bitset, low); });
+        result.cardinality = result.array.size();
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+        result.cardinality = result.array.size();
+    }
+    return result;
+}
+
+auto IdBitmap::OrContainers(const Container &a, const Container &b) -> Container {
+    Container result = {.key = a.key, .cardinality = 0, .array = {}, .bitset = {}};
+    if (!a.IsBitset() && !b.IsBitset()) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(result.array));
+        result.cardinality = result.array.size();
+        return result;
+    }
+
+    const Container &dense = a.IsBitset() ? a : b;
+    const Container &other = a.IsBitset() ? b : a;
+    result.bitset = dense.bitset;
+    if (other.IsBitset()) {
+        for (uint32_t word = 0; word < BITSET_WORDS; ++word) {
+            result.bitset[word] |= other.bitset[word];
+        }
+    } else {
+        for (uint16_t low : other.array) {
+            result.bitset[low / 64] |= uint64_t{1} << (low % 64);
+        }
+    }
+    for (uint64_t word : result.bitset) {
+        result.cardinality += std::popcount(word);
+    }
+    return result;
+}
+
+auto IdBitmap::AndNotContainers(const Container &a, const Container &b) -> Container {
+    Container result = {.key = a.key, .cardinality = 0, .array = {}, .bitset = {}};
+    if (!a.IsBitset()) {
+        if (b.IsBitset()) {
+            std::copy_if(a.array.begin(), a.array.end(), std::back_inserter(result.array),
+                         [&b](uint16_t low) { return !BitIsSet(b.bitset, low); });
+        } else {
+            std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                std::back_inserter(result.array));
+        }
+        result.cardinality = result.array.size();
+        return result;
+    }
+
+    result.bitset = a.bitset;
+    if (b.IsBitset()) {
+        for (uint32_t word = 0; word < BITSET_WORDS; ++word) {
+            result.bitset[word] &= ~b.bitset[word];
+        }
+    } else {
+        for (uint16_t low : b.array) {
+            result.bitset[low / 64] &= ~(uint64_t{1} << (low % 64));
+        }
+    }
+    for (uint64_t word : result.bitset) {
+        result.cardinality += std::popcount(word);
+    }
+    return result;
+}
@@ -0,0 +1,99 @@
+#include "kdfarena.hpp"
+
+#include <cstdint>
+#include <sodium.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+#ifdef MAP_POPULATE
+const int POPULATE_FLAG = MAP_POPULATE;
+#else
+const int POPULATE_FLAG = 0;
+#endif
+
+// Writes a byte per page where the kernel cannot populate the mapping itself
+void TouchPages(unsigned char *base, size_t len) {
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(base, len, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    auto page_len = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < len; offset += page_len) {
+        static_cast<volatile unsigned char *>(base)[offset] = 0;
+    }
+}
+
+} // namespace
+
+KdfArena::~KdfArena() { this->Unmap(); }
+
+// Reserved huge pages are tried first but are rarely configured. Otherwise the mapping is over-allocated by a huge page
+// so it can be trimmed to a huge page boundary, which transparent huge pages need, and advised before it is faulted
+// in; MAP_POPULATE would fault it in as small pages before the advice could apply.
+auto KdfArena::Acquire(size_t len) -> void * {
+    if (len <= this->capacity_) {
+        this->used_ = len;
+        return this->base_;
+    }
+    this->Unmap();
+
+    size_t capacity = (len + HUGE_PAGE_LEN - 1) / HUGE_PAGE_LEN * HUGE_PAGE_LEN;
+    void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | POPULATE_FLAG,
+                -1, 0);
+    this->huge_tlb_ = base != MAP_FAILED;
+#endif
+    if (base == MAP_FAILED) {
+        void *mapping =
+            mmap(nullptr, capacity + HUGE_PAGE_LEN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            return nullptr;
+        }
+        auto start = reinterpret_cast<uintptr_t>(mapping);
+        uintptr_t aligned = (start + HUGE_PAGE_LEN - 1) / HUGE_PAGE_LEN * HUGE_PAGE_LEN;
+        if (aligned > start) {
+            munmap(mapping, aligned - start);
+        }
+        munmap(reinterpret_cast<void *>(aligned + capacity), start + HUGE_PAGE_LEN - aligned);
+        base = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(base, capacity, MADV_HUGEPAGE);
+#endif
+        TouchPages(static_cast<unsigned char *>(base), capacity);
+    }
+#ifdef MADV_DONTDUMP
+    madvise(base, capacity, MADV_DONTDUMP); // keeps derivation state out of core dumps
+#endif
+
+    this->base_ = base;
+    this->capacity_ = capacity;
+    this->used_ = len;
+    return this->base_;
+}
+
+void KdfArena::Release() {
+    if (this->base_ != nullptr) {
+        sodium_memzero(this->base_, this->used_);
+    }
+    this->used_ = 0;
+}
+
+auto KdfArena::Capacity() const -> size_t { return this->capacity_; }
+
+auto KdfArena::HugeTlb() const -> bool { return this->huge_tlb_; }
+
+void KdfArena::Unmap() {
+    if (this->base_ == nullptr) {
+        return;
+    }
+    sodium_memzero(this->base_, this->used_);
+    munmap(this->base_, this->capacity_);
+    this->base_ = nullptr;
+    this->capacity_ = 0;
+    this->used_ = 0;
+    this->huge_tlb_ = false;
+}
@@ -0,0 +1,71 @@
+#include "keyringkeycache.hpp"
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/keyctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace {
+
+const char *const KEY_TYPE = "user";
+
+// Permission bits as keyctl_setperm(3) defines them; the kernel's uapi headers leave them out
+const uint32_t KEY_POS_VIEW = 0x01000000;
+const uint32_t KEY_POS_READ = 0x02000000;
+const uint32_t KEY_POS_SEARCH = 0x08000000;
+
+// Only a possessor of the key may find, read and invalidate it. Other processes of the same user get nothing, and no
+// one may update it, change its timeout or link it elsewhere.
+const uint32_t KEY_PERMISSIONS = KEY_POS_VIEW | KEY_POS_READ | KEY_POS_SEARCH;
+
+auto FindKey(const std::string &name) -> long {
+    return syscall(SYS_keyctl, KEYCTL_SEARCH, KEY_SPEC_USER_SESSION_KEYRING, KEY_TYPE, name.c_str(), 0);
+}
+
+} // namespace
+
+// A key that cannot be written is not updated in place, so an existing entry is invalidated and a new key added. The
+// timeout is set before the permissions, which take away the right to set it; a key that cannot be given both is
+// invalidated rather than left behind without them.
+auto KeyringKeyCache::Put(const std::string &name, const unsigned char *data, size_t len, uint32_t timeout_seconds)
+    -> int {
+    this->Remove(name);
+    long key = syscall(SYS_add_key, KEY_TYPE, name.c_str(), data, len, KEY_SPEC_USER_SESSION_KEYRING);
+    if (key < 0) {
+        return -1;
+    }
+    if (syscall(SYS_keyctl, KEYCTL_SET_TIMEOUT, key, timeout_seconds) != 0 ||
+        syscall(SYS_keyctl, KEYCTL_SETPERM, key, KEY_PERMISSIONS) != 0) {
+        syscall(SYS_keyctl, KEYCTL_INVALIDATE, key);
+        return -1;
+    }
+    return 0;
+}
+
+auto KeyringKeyCache::Get(const std::string &name, unsigned char *data, size_t len) -> int64_t {
+    long key = FindKey(name);
+    if (key < 0) {
+        return -1;
+    }
+    // KEYCTL_READ returns the full length of the payload, copying only as much of it as fits
+    long read = syscall(SYS_keyctl, KEYCTL_READ, key, data, len);
+    return read < 0 || static_cast<size_t>(read) > len ? -1 : read;
+}
+
+void KeyringKeyCache::Remove(const std::string &name) {
+    long key = FindKey(name);
+    if (key >= 0) {
+        syscall(SYS_keyctl, KEYCTL_INVALIDATE, key);
+    }
+}
+#else
+auto KeyringKeyCache::Put(const std::string &, const unsigned char *, size_t, uint32_t) -> int { return -1; }
+
+auto KeyringKeyCache::Get(const std::string &, unsigned char *, size_t) -> int64_t { return -1; }
+
+void KeyringKeyCache::Remove(const std::string &) {}
+#endif
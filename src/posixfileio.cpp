@@ -0,0 +1,467 @@
+#include "posixfileio.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+namespace {
+
+// Moves every byte described by segments with preadv/pwritev starting at *pos, resuming after short transfers and
+// EINTR. Advances *pos by the bytes moved.
+auto TransferAll(int fd, std::span<const iovec> segments, int64_t *pos, bool write) -> bool {
+    std::vector<iovec> remaining(segments.begin(), segments.end());
+    size_t first = 0;
+    while (first < remaining.size()) {
+        if (remaining[first].iov_len == 0) {
+            ++first;
+            continue;
+        }
+
+        int count = static_cast<int>(std::min<size_t>(remaining.size() - first, IOV_MAX));
+        ssize_t transferred = write ? pwritev(fd, &remaining[first], count, *pos)
+                                    : preadv(fd, &remaining[first], count, *pos);
+        if (transferred < 0 && errno == EINTR) {
+            continue;
+        }
+        if (transferred <= 0) {
+            return false; // error, or end of file while reading
+        }
+        *pos += transferred;
+
+        auto left = static_cast<size_t>(transferred);
+        while (left > 0) {
+            iovec &segment = remaining[first];
+            if (left >= segment.iov_len) {
+                left -= segment.iov_len;
+                ++first;
+            } else {
+                segment.iov_base = static_cast<char *>(segment.iov_base) + left;
+                segment.iov_len -= left;
+                left = 0;
+            }
+        }
+    }
+    return true;
+}
+
+auto ParentDir(const std::string &file_path) -> std::string {
+    std::string dir = std::filesystem::path(file_path).parent_path().string();
+    return dir.empty() ? "." : dir;
+}
+
+// Copies up to len bytes and stops early only at end of file. copy_file_range stays in the kernel and shares extents
+// where the filesystem can; the pread/pwrite loop picks up wherever it stops, for kernels and filesystem pairs that
+// reject it. Returns the number of bytes copied, or -1.
+auto CopyRange(int src_fd, int64_t src_offset, int dst_fd, int64_t dst_offset, uint64_t len) -> int64_t {
+    uint64_t copied = 0;
+#ifdef __linux__
+    while (copied < len) {
+        off_t src_pos = src_offset + static_cast<int64_t>(copied);
+        off_t dst_pos = dst_offset + static_cast<int64_t>(copied);
+        ssize_t transferred =
+            copy_file_range(src_fd, &src_pos, dst_fd, &dst_pos, std::min<uint64_t>(len - copied, 1 << 30), 0);
+        if (transferred == 0) {
+            return static_cast<int64_t>(copied);
+        }
+        if (transferred < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        copied += transferred;
+    }
+#endif
+
+    std::array<char, 64 * 1024> buf{};
+    while (copied < len) {
+        ssize_t transferred = pread(src_fd, buf.data(), std::min<uint64_t>(buf.size(), len - copied),
+                                    src_offset + static_cast<int64_t>(copied));
+        if (transferred < 0 && errno == EINTR) {
+            continue;
+        }
+        if (transferred <= 0) {
+            return transferred == 0 ? static_cast<int64_t>(copied) : -1;
+        }
+        const iovec segment = {.iov_base = buf.data(), .iov_len = static_cast<size_t>(transferred)};
+        int64_t write_offset = dst_offset + static_cast<int64_t>(copied);
+        if (!TransferAll(dst_fd, {&segment, 1}, &write_offset, true)) {
+            return -1;
+        }
+        copied += transferred;
+    }
+    return static_cast<int64_t>(copied);
+}
+
+auto ExchangePaths(const std::string &a, const std::string &b) -> int {
+#ifdef RENAME_EXCHANGE
+    return renameat2(AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(), RENAME_EXCHANGE);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+} // namespace
+
+PosixFileIO::PosixFileIO(const std::string &file_path, Durability durability, uint32_t generations)
+    : durability_(durability), generations_(generations), FILE_PATH(file_path), TMP_FILE_PATH(file_path + ".tmp"),
+      SNAPSHOT_FILE_PATH(file_path + ".snap"), OLD_FILE_PATH(file_path + ".old"), DIR_PATH(ParentDir(file_path)) {}
+
+PosixFileIO::~PosixFileIO() {
+    this->CloseRead();
+    this->DiscardTemp();
+}
+
+auto PosixFileIO::Read(char *buf, int64_t stream_size) -> bool {
+    const iovec segment = {.iov_base = buf, .iov_len = static_cast<size_t>(stream_size)};
+    return this->ReadV({&segment, 1});
+}
+
+auto PosixFileIO::WriteTemp(const char *buf, int64_t stream_size) -> bool {
+    const iovec segment = {.iov_base = const_cast<char *>(buf), .iov_len = static_cast<size_t>(stream_size)};
+    return this->WriteTempV({&segment, 1});
+}
+
+auto PosixFileIO::ReadV(std::span<const iovec> segments) -> bool {
+    return TransferAll(this->read_fd_, segments, &this->read_pos_, false);
+}
+
+auto PosixFileIO::ReadAt(char *buf, int64_t len, uint64_t offset) -> bool {
+    const iovec segment = {.iov_base = buf, .iov_len = static_cast<size_t>(len)};
+    auto pos = static_cast<int64_t>(offset);
+    return TransferAll(this->read_fd_, {&segment, 1}, &pos, false);
+}
+
+// Unchanged ranges of the current store go to the temp file without passing through user space
+auto PosixFileIO::CopyToTemp(uint64_t offset, uint64_t len) -> bool {
+    int64_t copied = CopyRange(this->read_fd_, static_cast<int64_t>(offset), this->write_fd_, this->write_pos_, len);
+    if (copied < 0 || static_cast<uint64_t>(copied) != len) {
+        this->write_failed_ = true;
+        return false;
+    }
+    this->write_pos_ += copied;
+    return true;
+}
+
+auto PosixFileIO::SeekWriteTemp(uint64_t offset) -> bool {
+    if (this->write_fd_ < 0) {
+        return false;
+    }
+    this->write_pos_ = static_cast<int64_t>(offset);
+    return true;
+}
+
+auto PosixFileIO::WriteTempV(std::span<const iovec> segments) -> bool {
+#ifdef __linux__
+    // Reserve the extents up front so a large file is laid out in one piece; small writes fit in a block or two and
+    // only pay for the extra call. Unsupported filesystems just skip this.
+    uint64_t total_len = 0;
+    for (const iovec &segment : segments) {
+        total_len += segment.iov_len;
+    }
+    if (this->write_fd_ >= 0 && total_len >= PREALLOCATE_MIN_LEN) {
+        fallocate(this->write_fd_, FALLOC_FL_KEEP_SIZE, this->write_pos_, static_cast<off_t>(total_len));
+    }
+#endif
+
+    if (!TransferAll(this->write_fd_, segments, &this->write_pos_, true)) {
+        this->write_failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+// The new store is published with a single link or rename, so there is no point at which FILE_PATH is missing
+auto PosixFileIO::CommitTemp() -> int {
+    if (this->write_failed_) {
+        this->Delete(true);
+        return -1;
+    }
+
+    bool store_exists = this->GetExists(false);
+    if (this->anonymous_temp_) {
+        int link_status = this->LinkAnonymousTemp(store_exists ? this->TMP_FILE_PATH : this->FILE_PATH);
+        this->DiscardTemp();
+        if (link_status != 0) {
+            return -1;
+        }
+    } else if (!store_exists) {
+        if (rename(this->TMP_FILE_PATH.c_str(), this->FILE_PATH.c_str()) != 0) {
+            this->Delete(true);
+            return -1;
+        }
+    }
+
+    if (store_exists && this->ReplaceStore() != 0) {
+        return -1;
+    }
+    return this->SyncDir();
+}
+
+// Moves the named temp file over the store, then retires the replaced store to the first backup generation. The
+// backups are only shifted once the new store is published, and the commit succeeds as soon as it is; a replaced store
+// that cannot be retired stays at OLD_FILE_PATH until the next OpenWriteTemp retires it.
+auto PosixFileIO::ReplaceStore() -> int {
+    if (this->generations_ == 0) {
+        if (rename(this->TMP_FILE_PATH.c_str(), this->FILE_PATH.c_str()) != 0) {
+            this->Delete(true);
+            return -1;
+        }
+        return 0;
+    }
+
+    // Swap new and old in one step; the old inode then only needs a new name, so no data is copied at all
+    if (ExchangePaths(this->TMP_FILE_PATH, this->FILE_PATH) == 0) {
+        if (rename(this->TMP_FILE_PATH.c_str(), this->OLD_FILE_PATH.c_str()) == 0) {
+            this->RetireStore(this->OLD_FILE_PATH);
+        }
+        return 0;
+    }
+
+    // Without RENAME_EXCHANGE, snapshot the old store before it is replaced
+    if (this->SnapshotStore(this->SNAPSHOT_FILE_PATH) != 0) {
+        this->Delete(true);
+        return -1;
+    }
+    if (rename(this->TMP_FILE_PATH.c_str(), this->FILE_PATH.c_str()) != 0) {
+        unlink(this->SNAPSHOT_FILE_PATH.c_str());
+        this->Delete(true);
+        return -1;
+    }
+    if (rename(this->SNAPSHOT_FILE_PATH.c_str(), this->OLD_FILE_PATH.c_str()) == 0) {
+        this->RetireStore(this->OLD_FILE_PATH);
+    }
+    return 0;
+}
+
+// Makes the replaced store at path the first backup generation, or drops it if no backups are kept
+auto PosixFileIO::RetireStore(const std::string &path) -> int {
+    if (this->generations_ == 0) {
+        return unlink(path.c_str()) == 0 ? 0 : -1;
+    }
+    this->ShiftGenerations();
+    return rename(path.c_str(), GetGenerationPath(this->FILE_PATH, 1).c_str()) == 0 ? 0 : -1;
+}
+
+// A commit interrupted after the new store was published, or one that could not shift the backups, leaves the store it
+// replaced at OLD_FILE_PATH. It is the newest backup, not scratch, so it is retired. The temp and snapshot paths may
+// hold a partial write or a store that was never published, so whatever is left there is deleted.
+void PosixFileIO::RetireLeftovers() {
+    unlink(this->TMP_FILE_PATH.c_str());
+    unlink(this->SNAPSHOT_FILE_PATH.c_str());
+    if (this->GetExists(false) && CheckFileExists(this->OLD_FILE_PATH)) {
+        this->RetireStore(this->OLD_FILE_PATH);
+    }
+}
+
+// Renames generation k to k + 1 from the oldest down; the oldest kept generation is overwritten
+void PosixFileIO::ShiftGenerations() {
+    for (uint32_t generation = this->generations_ - 1; generation >= 1; --generation) {
+        rename(GetGenerationPath(this->FILE_PATH, generation).c_str(),
+               GetGenerationPath(this->FILE_PATH, generation + 1).c_str());
+    }
+}
+
+// Reflink where the filesystem can share extents (Btrfs, XFS), else a hardlink, else a full copy. Commits never
+// write to the store inode in place, so a hardlinked snapshot cannot be changed by a later save.
+auto PosixFileIO::SnapshotStore(const std::string &path) -> int {
+    unlink(path.c_str());
+
+    int src_fd = open(this->FILE_PATH.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        return -1;
+    }
+    int dst_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (dst_fd < 0) {
+        close(src_fd);
+        return -1;
+    }
+
+    int status = -1;
+#ifdef FICLONE
+    status = ioctl(dst_fd, FICLONE, src_fd) == 0 ? 0 : -1;
+#endif
+    if (status != 0) {
+        close(dst_fd);
+        unlink(path.c_str());
+        if (link(this->FILE_PATH.c_str(), path.c_str()) == 0) {
+            close(src_fd);
+            return 0;
+        }
+
+        dst_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        status = dst_fd >= 0 && CopyRange(src_fd, 0, dst_fd, 0, INT64_MAX) >= 0 ? 0 : -1;
+    }
+
+    if (dst_fd >= 0 && close(dst_fd) != 0) {
+        status = -1;
+    }
+    close(src_fd);
+    if (status != 0) {
+        unlink(path.c_str());
+    }
+    return status;
+}
+
+auto PosixFileIO::OpenRead(uint32_t generation) -> int {
+    this->CloseRead();
+    this->read_fd_ = open(GetGenerationPath(this->FILE_PATH, generation).c_str(), O_RDONLY | O_CLOEXEC);
+    if (this->read_fd_ < 0) {
+        return -1;
+    }
+    this->read_pos_ = 0;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(this->read_fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return 0;
+}
+
+auto PosixFileIO::OpenWriteTemp() -> int {
+    this->DiscardTemp();
+    this->RetireLeftovers();
+    this->write_pos_ = 0;
+    this->write_failed_ = false;
+
+    if (this->OpenAnonymousTemp() == 0) {
+        return 0;
+    }
+
+    this->write_fd_ = open(this->TMP_FILE_PATH.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    return this->write_fd_ >= 0 ? 0 : -1;
+}
+
+// An O_TMPFILE inode has no name until CommitTemp links it, so a crash mid-save leaves nothing behind
+auto PosixFileIO::OpenAnonymousTemp() -> int {
+#ifdef O_TMPFILE
+    // Linking the inode goes through /proc/self/fd; without procfs the temp could never be published
+    static const bool proc_fd_available = access("/proc/self/fd", X_OK) == 0;
+    if (!proc_fd_available) {
+        return -1;
+    }
+
+    this->write_fd_ = open(this->DIR_PATH.c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (this->write_fd_ < 0) {
+        return -1; // filesystem without O_TMPFILE support
+    }
+    this->anonymous_temp_ = true;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+auto PosixFileIO::LinkAnonymousTemp(const std::string &path) -> int {
+    if (this->pending_fd_ < 0) {
+        return -1;
+    }
+
+    char proc_path[32];
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", this->pending_fd_);
+    return linkat(AT_FDCWD, proc_path, AT_FDCWD, path.c_str(), AT_SYMLINK_FOLLOW) == 0 ? 0 : -1;
+}
+
+void PosixFileIO::DiscardTemp() {
+    if (this->write_fd_ >= 0) {
+        close(this->write_fd_);
+        this->write_fd_ = -1;
+    }
+    if (this->pending_fd_ >= 0) {
+        close(this->pending_fd_);
+        this->pending_fd_ = -1;
+    }
+    this->anonymous_temp_ = false;
+}
+
+auto PosixFileIO::HasAnonymousTemp() const -> bool {
+    return this->anonymous_temp_ && (this->write_fd_ >= 0 || this->pending_fd_ >= 0);
+}
+
+void PosixFileIO::CloseRead() {
+    if (this->read_fd_ >= 0) {
+        close(this->read_fd_);
+        this->read_fd_ = -1;
+    }
+}
+
+// The temp file has to be on disk before CommitTemp renames it over the store, otherwise a crash can leave a
+// published but empty file. Failures are remembered so CommitTemp refuses to publish.
+void PosixFileIO::CloseWriteTemp() {
+    if (this->write_fd_ < 0) {
+        return;
+    }
+    if (this->durability_ != DURABILITY_NONE && fdatasync(this->write_fd_) != 0) {
+        this->write_failed_ = true;
+    }
+    if (this->anonymous_temp_) {
+        this->pending_fd_ = this->write_fd_;
+    } else if (close(this->write_fd_) != 0) {
+        this->write_failed_ = true;
+    }
+    this->write_fd_ = -1;
+}
+
+auto PosixFileIO::GetPositionRead() -> int64_t { return this->read_fd_ >= 0 ? this->read_pos_ : -1; }
+
+auto PosixFileIO::GetPositionWriteTemp() -> int64_t { return this->write_fd_ >= 0 ? this->write_pos_ : -1; }
+
+auto PosixFileIO::GetSize(bool temp) -> uintmax_t {
+    struct stat st {};
+    int status = 0;
+    if (temp && this->HasAnonymousTemp()) {
+        status = fstat(this->write_fd_ >= 0 ? this->write_fd_ : this->pending_fd_, &st);
+    } else {
+        status = stat(temp ? this->TMP_FILE_PATH.c_str() : this->FILE_PATH.c_str(), &st);
+    }
+    return status == 0 ? static_cast<uintmax_t>(st.st_size) : 0;
+}
+
+auto PosixFileIO::GetSizeRead() -> uintmax_t {
+    struct stat st {};
+    return fstat(this->read_fd_, &st) == 0 ? static_cast<uintmax_t>(st.st_size) : 0;
+}
+
+auto PosixFileIO::GetExists(bool temp) -> bool {
+    if (temp && this->HasAnonymousTemp()) {
+        return true;
+    }
+    return temp ? CheckFileExists(this->TMP_FILE_PATH) : CheckFileExists(this->FILE_PATH);
+}
+
+auto PosixFileIO::Delete(bool temp) -> bool {
+    if (temp && this->HasAnonymousTemp()) {
+        this->DiscardTemp();
+        return true;
+    }
+    return temp ? this->DeleteFile(this->TMP_FILE_PATH) : this->DeleteFile(this->FILE_PATH);
+}
+
+auto PosixFileIO::DeleteFile(const std::string &path) -> bool { return unlink(path.c_str()) == 0; }
+
+auto PosixFileIO::SyncDir() -> int {
+    if (this->durability_ != DURABILITY_FULL) {
+        return 0;
+    }
+
+    int dir_fd = open(this->DIR_PATH.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        return -1;
+    }
+    int status = fsync(dir_fd) == 0 ? 0 : -1;
+    close(dir_fd);
+    return status;
+}
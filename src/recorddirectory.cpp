@@ -0,0 +1,192 @@
+#include "recorddirectory.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+auto ById(const RecordDirectory::Entry &entry, uint32_t id) -> bool { return entry.id < id; }
+
+} // namespace
+
+// The directory only lists names, so one longer than its length field can hold is cut short; the record keeps it whole
+auto RecordDirectory::Add(const std::string &name, const Metadata &metadata) -> uint32_t {
+    uint32_t id = this->next_id_++;
+    this->entries_.push_back(
+        {.id = id, .location = {.offset = NOT_STORED, .length = 0}, .name = name, .metadata = metadata});
+    if (this->entries_.back().name.size() > UINT16_MAX) {
+        this->entries_.back().name.resize(UINT16_MAX);
+    }
+    return id;
+}
+
+auto RecordDirectory::Remove(uint32_t id) -> bool {
+    auto it = std::lower_bound(this->entries_.begin(), this->entries_.end(), id, ById);
+    if (it == this->entries_.end() || it->id != id) {
+        return false;
+    }
+    this->entries_.erase(it);
+    return true;
+}
+
+auto RecordDirectory::SetMetadata(uint32_t id, const Metadata &metadata) -> bool {
+    auto it = std::lower_bound(this->entries_.begin(), this->entries_.end(), id, ById);
+    if (it == this->entries_.end() || it->id != id) {
+        return false;
+    }
+    it->metadata = metadata;
+    return true;
+}
+
+auto RecordDirectory::SetLocation(uint32_t id, const Location &location) -> bool {
+    auto it = std::lower_bound(this->entries_.begin(), this->entries_.end(), id, ById);
+    if (it == this->entries_.end() || it->id != id) {
+        return false;
+    }
+    it->location = location;
+    return true;
+}
+
+void RecordDirectory::Clear() {
+    this->version_ = FORMAT_VERSION;
+    this->next_id_ = 0;
+    this->entries_.clear();
+}
+
+auto RecordDirectory::Find(uint32_t id) const -> const Entry * {
+    auto it = std::lower_bound(this->entries_.begin(), this->entries_.end(), id, ById);
+    if (it == this->entries_.end() || it->id != id) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+auto RecordDirectory::Entries() const -> const std::vector<Entry> & { return this->entries_; }
+
+auto RecordDirectory::Size() const -> size_t { return this->entries_.size(); }
+
+auto RecordDirectory::Version() const -> uint8_t { return this->version_; }
+
+void RecordDirectory::SetLocations(const std::vector<Location> &locations) {
+    for (size_t i = 0; i < this->entries_.size() && i < locations.size(); ++i) {
+        this->entries_[i].location = locations[i];
+    }
+}
+
+auto RecordDirectory::SerializedSize() const -> uint64_t {
+    uint64_t size = PREAMBLE_LEN;
+    for (const Entry &entry : this->entries_) {
+        size += EntryFixedLen(FORMAT_VERSION) + entry.name.size();
+        for (const std::string &tag : entry.metadata.tags) {
+            size += sizeof(uint8_t) + tag.size();
+        }
+    }
+    return size;
+}
+
+void RecordDirectory::Serialize(unsigned char *buf, const std::vector<Location> &locations) const {
+    buf[0] = FORMAT_VERSION;
+    StoreLE32(buf + 1, this->next_id_);
+    StoreLE32(buf + 5, static_cast<uint32_t>(this->entries_.size()));
+
+    uint64_t pos = PREAMBLE_LEN;
+    for (size_t i = 0; i < this->entries_.size(); ++i) {
+        const Entry &entry = this->entries_[i];
+        StoreLE32(buf + pos, entry.id);
+        StoreLE64(buf + pos + 4, locations[i].offset);
+        StoreLE32(buf + pos + 12, locations[i].length);
+        memcpy(buf + pos + 16, entry.metadata.fingerprint.data(), FINGERPRINT_LEN);
+        StoreLE16(buf + pos + 16 + FINGERPRINT_LEN, entry.metadata.expiry);
+        buf[pos + 18 + FINGERPRINT_LEN] = entry.metadata.network;
+        buf[pos + 19 + FINGERPRINT_LEN] = static_cast<uint8_t>(entry.metadata.tags.size());
+        StoreLE64(buf + pos + 20 + FINGERPRINT_LEN, entry.metadata.last_used);
+        StoreLE16(buf + pos + 28 + FINGERPRINT_LEN, static_cast<uint16_t>(entry.name.size()));
+        pos += EntryFixedLen(FORMAT_VERSION);
+        memcpy(buf + pos, entry.name.data(), entry.name.size());
+        pos += entry.name.size();
+        for (const std::string &tag : entry.metadata.tags) {
+            buf[pos] = static_cast<uint8_t>(tag.size());
+            memcpy(buf + pos + 1, tag.data(), tag.size());
+            pos += sizeof(uint8_t) + tag.size();
+        }
+    }
+}
+
+auto RecordDirectory::Parse(const unsigned char *buf, uint64_t len, uint64_t records_len) -> int {
+    if (len < PREAMBLE_LEN || buf[0] == 0 || buf[0] > FORMAT_VERSION) {
+        return -1;
+    }
+    uint8_t version = buf[0];
+    uint64_t entry_fixed_len = EntryFixedLen(version);
+    uint32_t next_id = LoadLE32(buf + 1);
+    uint32_t count = LoadLE32(buf + 5);
+    if (count > (len - PREAMBLE_LEN) / entry_fixed_len) {
+        return -1;
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(count);
+    uint64_t pos = PREAMBLE_LEN;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (len - pos < entry_fixed_len) {
+            return -1;
+        }
+        Entry entry = {.id = LoadLE32(buf + pos),
+                       .location = {.offset = LoadLE64(buf + pos + 4), .length = LoadLE32(buf + pos + 12)},
+                       .name = {},
+                       .metadata = {}};
+        uint64_t field = pos + 16;
+        if (version >= 2) {
+            memcpy(entry.metadata.fingerprint.data(), buf + field, FINGERPRINT_LEN);
+            field += FINGERPRINT_LEN;
+        }
+        if (version >= 3) {
+            entry.metadata.expiry = LoadLE16(buf + field);
+            field += sizeof(uint16_t);
+        }
+        uint8_t tag_count = 0;
+        if (version >= 4) {
+            entry.metadata.network = buf[field];
+            tag_count = buf[field + 1];
+            field += 2 * sizeof(uint8_t);
+        }
+        if (version >= 5) {
+            entry.metadata.last_used = LoadLE64(buf + field);
+            field += sizeof(uint64_t);
+        }
+        uint16_t name_len = LoadLE16(buf + field);
+        pos += entry_fixed_len;
+
+        bool ordered = entries.empty() || entries.back().id < entry.id;
+        bool in_region =
+            entry.location.offset <= records_len && entry.location.length <= records_len - entry.location.offset;
+        if (!ordered || entry.id >= next_id || !in_region || len - pos < name_len) {
+            return -1;
+        }
+        entry.name.assign(reinterpret_cast<const char *>(buf + pos), name_len);
+        pos += name_len;
+        for (uint8_t t = 0; t < tag_count; ++t) {
+            if (len - pos < sizeof(uint8_t) || len - pos - sizeof(uint8_t) < buf[pos]) {
+                return -1;
+            }
+            entry.metadata.tags.emplace_back(reinterpret_cast<const char *>(buf + pos + 1), buf[pos]);
+            pos += sizeof(uint8_t) + buf[pos];
+        }
+        entries.push_back(std::move(entry));
+    }
+    if (pos != len) {
+        return -1;
+    }
+
+    this->version_ = version;
+    this->next_id_ = next_id;
+    this->entries_ = std::move(entries);
+    return 0;
+}
+
+auto RecordDirectory::EntryFixedLen(uint8_t version) -> uint64_t {
+    return V1_ENTRY_FIXED_LEN + (version >= 2 ? FINGERPRINT_LEN : 0) + (version >= 3 ? sizeof(uint16_t) : 0) +
+           (version >= 4 ? 2 * sizeof(uint8_t) : 0) + (version >= 5 ? sizeof(uint64_t) : 0);
+}
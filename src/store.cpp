@@ -2,298 +2,1892 @@
 #include "icrypto.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
+#include <thread>
 #include <utility>
 
-Store::Store(std::shared_ptr<ICrypto> crypto, std::unique_ptr<IFileIO> fileio) {
+template <typename CryptoPolicy, typename FileIOPolicy>
+BasicStore<CryptoPolicy, FileIOPolicy>::BasicStore(std::shared_ptr<CryptoPolicy> crypto,
+                                                   std::unique_ptr<FileIOPolicy> fileio) {
     this->crypto_ = std::move(crypto);
     this->fileio_ = std::move(fileio);
 }
 
-Store::~Store() { this->cards_.clear(); }
+template <typename CryptoPolicy, typename FileIOPolicy>
+BasicStore<CryptoPolicy, FileIOPolicy>::~BasicStore() {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    this->new_cards_.clear();
+}
 
-auto Store::InitNewStore(unsigned char *password) -> int {
-    unsigned char hash[this->crypto_->HashLen()];
-    if (this->crypto_->HashPassword(hash, password) != 0) {
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::InitNewStore(unsigned char *password) -> int {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    SaltBuf salt;
+    KeyBuf encryption_key;
+    if (this->SaltLen() > salt.size() || this->KeyLen() > encryption_key.size()) {
         return -1;
     }
+    this->crypto_->GenerateSalt(salt.data());
 
-    unsigned char salt[this->crypto_->SaltLen()];
-    this->crypto_->GenerateSalt(salt);
-
-    if (this->fileio_->OpenWriteTemp() != 0) {
-        this->crypto_->Memzero(hash, this->crypto_->HashLen());
+    // The data key is random and never changes; only its wrapping depends on the password
+    this->crypto_->GenerateKey(encryption_key.data());
+    auto wrapped_key = std::make_unique<unsigned char[]>(this->WrappedKeyLen());
+    int wrap_status = this->WrapKey(wrapped_key.get(), encryption_key.data(), password, salt.data());
+    this->crypto_->Memzero(encryption_key.data(), this->KeyLen());
+    if (wrap_status != 0 || this->fileio_->OpenWriteTemp() != 0) {
         return -1;
     }
-    if (this->WriteHeader(hash, salt) != 0) {
-        this->crypto_->Memzero(hash, this->crypto_->HashLen());
+    if (this->WriteHeader(nullptr, salt.data(), wrapped_key.get(), this->crypto_->KdfLanes(), {}, 0) != 0) {
         this->fileio_->CloseWriteTemp();
         return -1;
     }
-    this->crypto_->Memzero(hash, this->crypto_->HashLen());
     this->fileio_->CloseWriteTemp();
 
     return this->fileio_->CommitTemp();
 }
 
-auto Store::LoadStore(unsigned char *password) -> Store::LoadStoreStatus {
-    unsigned char hash[this->crypto_->HashLen()];
-    unsigned char salt[this->crypto_->SaltLen()];
-    if (this->fileio_->OpenRead() != 0) {
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::LoadStore(unsigned char *password, uint32_t generation)
+    -> LoadStoreStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    StoreHeader header;
+    LoadStoreStatus status = this->ReadStoreHeader(generation, &header);
+    if (status != LOAD_STORE_VALID) {
+        return status;
+    }
+    if (header.legacy) {
+        return this->LoadLegacyStore(password);
+    }
+
+    // The directory is read while the key is derived and unwrapped, which only use the crypto policy
+    DirectoryPrefetch prefetch;
+    this->PrefetchDirectory(header.directory_len, &prefetch);
+
+    KeyBuf encryption_key;
+    if (this->KeyLen() > encryption_key.size()) {
+        status = LOAD_STORE_KEY_DERIVATION_ERR;
+    } else if (!header.key_slots.empty()) {
+        status = this->TryKeySlots(encryption_key.data(), header.hash.data(), header.salt.data(),
+                                   header.wrapped_key.get(), header.key_slots, password);
+    } else {
+        status = this->UnwrapKey(encryption_key.data(), header.hash.data(), header.wrapped_key.get(), password,
+                                 header.salt.data());
+    }
+    if (prefetch.thread.joinable()) {
+        prefetch.thread.join();
+    }
+    if (status != LOAD_STORE_VALID) {
+        this->fileio_->CloseRead();
+        return status;
+    }
+
+    status = this->OpenStore(&header, encryption_key.data(), &prefetch, generation);
+    if (status == LOAD_STORE_VALID) {
+        this->CacheKey();
+    }
+    return status;
+}
+
+// The cached entry holds the data key followed by the wrapped key it was cached with, which has to match the header's
+// for the entry to be used; a password change or key rotation since leaves it unused
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::LoadCachedStore(uint32_t generation) -> LoadStoreStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    if (this->key_cache_ == nullptr) {
+        return LOAD_STORE_PWD_VERIFY_ERR;
+    }
+    StoreHeader header;
+    LoadStoreStatus status = this->ReadStoreHeader(generation, &header);
+    if (status != LOAD_STORE_VALID) {
+        return status;
+    }
+    if (header.legacy) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_PWD_VERIFY_ERR;
+    }
+
+    DirectoryPrefetch prefetch;
+    this->PrefetchDirectory(header.directory_len, &prefetch);
+
+    KeyBuf encryption_key;
+    uint64_t wrapped_key_len = header.wrapped_key != nullptr ? this->WrappedKeyLen() : 0;
+    std::vector<unsigned char> entry(this->KeyLen() + wrapped_key_len);
+    bool cached = this->KeyLen() <= encryption_key.size() &&
+                  this->key_cache_->Get(this->KeyCacheName(header.salt.data()), entry.data(), entry.size()) ==
+                      static_cast<int64_t>(entry.size()) &&
+                  (wrapped_key_len == 0 ||
+                   std::memcmp(entry.data() + this->KeyLen(), header.wrapped_key.get(), wrapped_key_len) == 0);
+    if (cached) {
+        std::memcpy(encryption_key.data(), entry.data(), this->KeyLen());
+    }
+    this->crypto_->Memzero(entry.data(), entry.size());
+    if (prefetch.thread.joinable()) {
+        prefetch.thread.join();
+    }
+    if (!cached) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_PWD_VERIFY_ERR;
+    }
+    return this->OpenStore(&header, encryption_key.data(), &prefetch, generation);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::SetKeyCache(std::shared_ptr<IKeyCache> key_cache,
+                                                         uint32_t timeout_seconds) {
+    this->key_cache_ = std::move(key_cache);
+    this->key_cache_timeout_ = timeout_seconds;
+}
+
+// Opens the store for reading and reads the header up to the directory, leaving the read position at the directory.
+// A store from before the header magic is left open for LoadLegacyStore.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReadStoreHeader(uint32_t generation, StoreHeader *header)
+    -> LoadStoreStatus {
+    if (this->HashLen() > header->hash.size() || this->SaltLen() > header->salt.size()) {
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+    if (this->fileio_->OpenRead(generation) != 0) {
         return LOAD_STORE_OPEN_ERR;
     }
 
-    if (this->ReadHeader(hash, salt) != 0) {
+    uint8_t cipher_suite = 0;
+    if (this->ReadHeader(header->hash.data(), header->salt.data(), &cipher_suite, &header->directory_len,
+                         &header->legacy) != 0) {
         this->fileio_->CloseRead();
         return LOAD_STORE_HEADER_READ_ERR;
     }
+    if (header->legacy) {
+        return LOAD_STORE_VALID;
+    }
 
-    if (this->crypto_->VerifyPasswordHash(hash, password) != 0) {
+    bool key_wrapped = (cipher_suite & HEADER_WRAPPED_KEY) != 0;
+    bool has_key_slots = (cipher_suite & HEADER_KEY_SLOTS) != 0;
+    bool has_kdf_lanes = (cipher_suite & HEADER_KDF_LANES) != 0;
+    uint8_t suite_id = cipher_suite & ~(HEADER_WRAPPED_KEY | HEADER_KEY_SLOTS | HEADER_KDF_LANES);
+    if (this->crypto_->SetCipherSuite(suite_id) != 0) {
         this->fileio_->CloseRead();
-        return LOAD_STORE_PWD_VERIFY_ERR;
+        return LOAD_STORE_CIPHER_SUITE_ERR;
+    }
+    if (has_key_slots && !key_wrapped) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+
+    // The wrapped key's length depends on the cipher suite, so it is read once the suite is set
+    if (key_wrapped) {
+        header->wrapped_key = std::make_unique<unsigned char[]>(this->WrappedKeyLen());
+        if (!this->fileio_->Read(reinterpret_cast<char *>(header->wrapped_key.get()),
+                                 static_cast<int64_t>(this->WrappedKeyLen()))) {
+            this->fileio_->CloseRead();
+            return LOAD_STORE_HEADER_READ_ERR;
+        }
+    }
+    if (has_kdf_lanes && !this->fileio_->Read(reinterpret_cast<char *>(&header->kdf_lanes), sizeof(uint8_t))) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+    if (this->crypto_->SetKdfLanes(header->kdf_lanes) != 0) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+    if (has_key_slots && this->ReadKeySlots(&header->key_slots) != 0) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+    return LOAD_STORE_VALID;
+}
+
+// Starts reading the directory that follows the header on the prefetch thread. Nothing is read for an empty directory
+// or one that cannot fit in the file or hold its encryption overhead, which OpenStore then reports.
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::PrefetchDirectory(uint64_t directory_len, DirectoryPrefetch *prefetch) {
+    prefetch->store_size = this->fileio_->GetSizeRead();
+    if (directory_len == 0 || directory_len > prefetch->store_size) {
+        return;
     }
+    uint64_t header_len = this->crypto_->EncryptionHeaderLen();
+    if (header_len > prefetch->header.size() ||
+        directory_len < header_len + this->crypto_->EncryptionAddedBytes()) {
+        return;
+    }
+
+    prefetch->thread = std::thread([this, prefetch, directory_len, header_len] {
+        prefetch->data.resize(directory_len - header_len);
+        const std::array<iovec, 2> segments = {{
+            {.iov_base = prefetch->header.data(), .iov_len = header_len},
+            {.iov_base = prefetch->data.data(), .iov_len = prefetch->data.size()},
+        }};
+        prefetch->status = this->fileio_->ReadV(segments) ? LOAD_STORE_VALID : LOAD_STORE_DATA_DECRYPT_ERR;
+    });
+}
 
-    unsigned char encryption_key[this->crypto_->EncryptionKeyLen()];
-    if (this->crypto_->DeriveEncryptionKey(encryption_key, this->crypto_->EncryptionKeyLen(), password, salt) != 0) {
+// Takes over the header and the data key it was unlocked with, then decrypts the prefetched directory, whose thread
+// has been joined. The caller's copy of the key is wiped.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::OpenStore(StoreHeader *header, unsigned char *encryption_key,
+                                                       DirectoryPrefetch *prefetch, uint32_t generation)
+    -> LoadStoreStatus {
+    auto fingerprint_key = std::make_unique<unsigned char[]>(this->KeyLen());
+    if (this->crypto_->DeriveSubkey(fingerprint_key.get(), FINGERPRINT_SUBKEY_ID, encryption_key) != 0) {
+        this->crypto_->Memzero(encryption_key, this->KeyLen());
         this->fileio_->CloseRead();
         return LOAD_STORE_KEY_DERIVATION_ERR;
     }
+    uint64_t directory_len = header->directory_len;
+
+    this->hashed_password_.reset();
+    if (header->wrapped_key == nullptr) {
+        this->hashed_password_ = std::make_unique<unsigned char[]>(this->HashLen());
+        std::memcpy(this->hashed_password_.get(), header->hash.data(), this->HashLen());
+    }
+
+    this->salt_ = std::make_unique<unsigned char[]>(this->SaltLen());
+    std::memcpy(this->salt_.get(), header->salt.data(), this->SaltLen());
+    this->wrapped_key_ = std::move(header->wrapped_key);
+    this->kdf_lanes_ = header->kdf_lanes;
+    this->key_slots_ = std::move(header->key_slots);
 
-    this->hashed_password_ = std::make_unique<unsigned char[]>(this->crypto_->HashLen());
-    std::memcpy(this->hashed_password_.get(), hash, this->crypto_->HashLen());
+    this->encryption_key_ = std::make_unique<unsigned char[]>(this->KeyLen());
+    std::memcpy(this->encryption_key_.get(), encryption_key, this->KeyLen());
+    this->crypto_->Memzero(encryption_key, this->KeyLen());
+    this->fingerprint_key_ = std::move(fingerprint_key);
 
-    this->salt_ = std::make_unique<unsigned char[]>(this->crypto_->SaltLen());
-    std::memcpy(this->salt_.get(), salt, this->crypto_->SaltLen());
+    // A restored backup is only in memory until saved, which makes it the live store again
+    this->dirty_ = generation != 0;
 
-    this->encryption_key_ = std::make_unique<unsigned char[]>(this->crypto_->EncryptionKeyLen());
-    std::memcpy(this->encryption_key_.get(), encryption_key, this->crypto_->EncryptionKeyLen());
-    this->crypto_->Memzero(encryption_key, this->crypto_->EncryptionKeyLen());
+    this->directory_.Clear();
+    this->index_.Clear();
+    this->orders_.Clear();
+    this->use_counter_ = 0;
+    this->new_cards_.clear();
+    this->dirty_segments_.clear();
 
-    uintmax_t store_size = this->fileio_->GetSize(false);
-    if (store_size < this->crypto_->HashLen() + this->crypto_->SaltLen()) {
+    uintmax_t store_size = prefetch->store_size;
+    if (store_size < this->HeaderLen() || store_size - this->HeaderLen() < directory_len) {
         this->fileio_->CloseRead();
         return LOAD_STORE_DATA_READ_ERR;
     }
-    uintmax_t data_size = store_size - this->crypto_->HashLen() - this->crypto_->SaltLen();
-    if (data_size == 0) {
-        this->fileio_->CloseRead();
+    this->directory_offset_ = this->HeaderLen();
+    this->records_offset_ = this->directory_offset_ + directory_len;
+    this->records_len_ = store_size - this->records_offset_;
+    if (directory_len == 0) {
         return LOAD_STORE_VALID;
     }
+    if (prefetch->status != LOAD_STORE_VALID) {
+        this->fileio_->CloseRead();
+        return prefetch->status;
+    }
 
-    auto *decrypted_data = static_cast<unsigned char *>(malloc(data_size));
+    // Only the directory is decrypted here; the read handle stays open so GetCardById can fetch single records
+    std::vector<unsigned char> &data = prefetch->data;
     uint64_t decrypted_size_actual = 0;
-    int data_read_status = this->ReadData(decrypted_data, data_size, &decrypted_size_actual);
     LoadStoreStatus return_status = LOAD_STORE_DATA_DECRYPT_ERR;
-    if (data_read_status == 0) {
+    if (this->crypto_->DecryptBufInPlace(data.data(), &decrypted_size_actual, prefetch->header.data(), data.size(),
+                                         this->encryption_key_.get()) == 0) {
         return_status = LOAD_STORE_VALID;
-        decrypted_data[decrypted_size_actual] = 0;
-        this->LoadCards(decrypted_data);
+        if (this->directory_.Parse(data.data() + this->crypto_->EncryptionInPlaceOffset(), decrypted_size_actual,
+                                   this->records_len_) != 0) {
+            return_status = LOAD_STORE_DATA_READ_ERR;
+        }
     }
 
-    this->crypto_->Memzero(decrypted_data, data_size);
-    free(decrypted_data);
-    this->fileio_->CloseRead();
+    this->crypto_->Memzero(data.data(), data.size());
+    if (return_status == LOAD_STORE_VALID && this->directory_.Version() < RecordDirectory::FORMAT_VERSION &&
+        this->RebuildMetadata() != 0) {
+        return_status = LOAD_STORE_DATA_DECRYPT_ERR;
+    }
+    if (return_status != LOAD_STORE_VALID) {
+        this->directory_.Clear();
+        this->fileio_->CloseRead();
+        return return_status;
+    }
+
+    for (const RecordDirectory::Entry &entry : this->directory_.Entries()) {
+        this->index_.Insert(entry);
+        this->orders_.Insert(entry);
+        this->use_counter_ = std::max(this->use_counter_, entry.metadata.last_used);
+    }
     return return_status;
 }
 
-auto Store::SaveStore() -> Store::SaveStoreStatus {
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SaveStore() -> SaveStoreStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
     if (!this->dirty_) {
         return SAVE_STORE_VALID;
     }
 
-    if (this->fileio_->OpenWriteTemp() != 0) {
-        return SAVE_STORE_OPEN_ERR;
+    SavedStore saved;
+    SaveStoreStatus status = this->WriteStore(this->directory_, this->new_cards_, this->dirty_segments_, &saved);
+    if (status == SAVE_STORE_VALID) {
+        saved.edits = this->edits_;
+        status = this->ApplySave(saved);
     }
-    if (this->WriteHeader(this->hashed_password_.get(), this->salt_.get()) != 0) {
-        this->fileio_->CloseWriteTemp();
-        return SAVE_STORE_HEADER_ERR;
+    return status;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SaveStoreAsync() -> std::shared_future<SaveStoreStatus> {
+    return this->RequestSave(false);
+}
+
+// The store keeps reading from the file open when the saves started, which every save plans its copies from; only
+// now, with the thread idle, does it move over to the last file committed
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FinishSaves() -> SaveStoreStatus {
+    if (this->save_ == nullptr) {
+        return SAVE_STORE_VALID;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->save_->mutex);
+        this->save_->next_due = this->autosave_clock_();
+    }
+    this->save_->wake.notify_one();
+    this->save_->thread.join();
+    std::unique_ptr<BackgroundSave> save = std::move(this->save_);
+    if (save->saved != nullptr && this->ApplySave(*save->saved) != SAVE_STORE_VALID) {
+        return SAVE_STORE_REOPEN_ERR;
     }
+    return save->status;
+}
 
-    uintmax_t data_size = this->GetCardsSize();
-    if (data_size != 0) {
-        unsigned char data[data_size];
-        this->CardsFormatted(data);
-        if (this->WriteData(data, data_size) != 0) {
-            this->fileio_->CloseWriteTemp();
-            return SAVE_STORE_WRITE_DATA_ERR;
-        }
-        this->crypto_->Memzero(data, data_size);
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::SetAutosave(uint32_t window_ms, uint32_t max_unsaved_ms) {
+    this->autosave_window_ms_ = window_ms;
+    this->autosave_max_unsaved_ms_ = max_unsaved_ms;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::SetAutosaveClock(
+    std::function<std::chrono::steady_clock::time_point()> clock) {
+    this->FinishSaves();
+    this->autosave_clock_ = std::move(clock);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ScheduledSave() -> std::shared_future<SaveStoreStatus> {
+    if (this->save_ == nullptr) {
+        return {};
     }
-    this->fileio_->CloseWriteTemp();
+    std::lock_guard<std::mutex> lock(this->save_->mutex);
+    return this->save_->latest;
+}
 
-    if (this->fileio_->CommitTemp() != 0) {
-        return SAVE_STORE_COMMIT_TEMP_ERR;
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ChangePassword(unsigned char *password, unsigned char *new_password)
+    -> ChangePasswordStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    if (!this->VerifyPassword(password)) {
+        return CHANGE_PASSWORD_VERIFY_ERR;
     }
 
-    return SAVE_STORE_VALID;
+    // Once wrapped, the key is checked by its own tag, so a store without a wrapped key drops its password hash here
+    std::unique_ptr<unsigned char[]> hash;
+    auto salt = std::make_unique<unsigned char[]>(this->SaltLen());
+    this->crypto_->GenerateSalt(salt.get());
+    auto wrapped_key = std::make_unique<unsigned char[]>(this->WrappedKeyLen());
+    if (this->WrapKey(wrapped_key.get(), this->encryption_key_.get(), new_password, salt.get()) != 0) {
+        return CHANGE_PASSWORD_KEY_ERR;
+    }
+
+    // The old header fields are kept until the new header is committed, so a failed write changes nothing
+    std::swap(this->hashed_password_, hash);
+    std::swap(this->salt_, salt);
+    std::swap(this->wrapped_key_, wrapped_key);
+    SaveStoreStatus commit_status = this->CommitHeader();
+    if (commit_status != SAVE_STORE_VALID && commit_status != SAVE_STORE_REOPEN_ERR) {
+        std::swap(this->hashed_password_, hash);
+        std::swap(this->salt_, salt);
+        std::swap(this->wrapped_key_, wrapped_key);
+        return CHANGE_PASSWORD_WRITE_ERR;
+    }
+    if (this->key_cache_ != nullptr) {
+        this->key_cache_->Remove(this->KeyCacheName(salt.get()));
+        this->CacheKey();
+    }
+    return commit_status == SAVE_STORE_VALID ? CHANGE_PASSWORD_VALID : CHANGE_PASSWORD_REOPEN_ERR;
 }
 
-void Store::AddCard(const CreditCard &card) {
-    this->cards_.emplace_back(card);
-    this->dirty_ = true;
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::AddKeySlot(unsigned char *password, unsigned char *new_password)
+    -> KeySlotStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    if (!this->OpensKeySlot(password)) {
+        return KEY_SLOT_VERIFY_ERR;
+    }
+    if (this->wrapped_key_ == nullptr) {
+        return KEY_SLOT_UNWRAPPED_ERR;
+    }
+    if (this->key_slots_.size() + 1 >= MAX_KEY_SLOTS) {
+        return KEY_SLOT_FULL_ERR;
+    }
+
+    KeySlot slot;
+    if (this->WrapKeySlot(&slot, this->encryption_key_.get(), new_password) != 0) {
+        return KEY_SLOT_KEY_ERR;
+    }
+    this->key_slots_.push_back(std::move(slot));
+    SaveStoreStatus commit_status = this->CommitHeader();
+    if (commit_status != SAVE_STORE_VALID && commit_status != SAVE_STORE_REOPEN_ERR) {
+        this->key_slots_.pop_back();
+        return KEY_SLOT_WRITE_ERR;
+    }
+    return commit_status == SAVE_STORE_VALID ? KEY_SLOT_VALID : KEY_SLOT_REOPEN_ERR;
 }
 
-void Store::DeleteCard(uint32_t card_id) {
-    this->deleted_.insert(card_id);
-    this->dirty_ = true;
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RemoveKeySlot(unsigned char *password, size_t slot) -> KeySlotStatus {
+    this->FinishSaves();
+    this->EndKeyRotation();
+    if (!this->OpensKeySlot(password)) {
+        return KEY_SLOT_VERIFY_ERR;
+    }
+    if (slot == 0 || slot > this->key_slots_.size()) {
+        return KEY_SLOT_NOT_FOUND_ERR;
+    }
+
+    auto removed = this->key_slots_.begin() + static_cast<std::ptrdiff_t>(slot - 1);
+    KeySlot kept = std::move(*removed);
+    this->key_slots_.erase(removed);
+    SaveStoreStatus commit_status = this->CommitHeader();
+    if (commit_status != SAVE_STORE_VALID && commit_status != SAVE_STORE_REOPEN_ERR) {
+        this->key_slots_.insert(this->key_slots_.begin() + static_cast<std::ptrdiff_t>(slot - 1), std::move(kept));
+        return KEY_SLOT_WRITE_ERR;
+    }
+    return commit_status == SAVE_STORE_VALID ? KEY_SLOT_VALID : KEY_SLOT_REOPEN_ERR;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeySlotCount() const -> size_t {
+    return this->key_slots_.size() + 1;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RotateDataKey(unsigned char *password) -> RotateKeyStatus {
+    if (this->KeyRotationStarted() && !this->KeyRotationDone()) {
+        return ROTATE_KEY_BUSY_ERR;
+    }
+    this->FinishSaves();
+    this->EndKeyRotation();
+    if (this->KeySlotCount() > 1) {
+        return ROTATE_KEY_SLOTS_ERR;
+    }
+    if (!this->VerifyPassword(password)) {
+        return ROTATE_KEY_VERIFY_ERR;
+    }
+    SaveStoreStatus save_status = this->SaveStore();
+    if (save_status != SAVE_STORE_VALID) {
+        return save_status == SAVE_STORE_REOPEN_ERR ? ROTATE_KEY_REOPEN_ERR : ROTATE_KEY_WRITE_ERR;
+    }
+
+    auto rotation = std::make_unique<KeyRotation>();
+    rotation->key = std::make_unique<unsigned char[]>(this->KeyLen());
+    rotation->fingerprint_key = std::make_unique<unsigned char[]>(this->KeyLen());
+    rotation->wrapped_key = std::make_unique<unsigned char[]>(this->WrappedKeyLen());
+    this->crypto_->GenerateKey(rotation->key.get());
+    bool keyed =
+        this->WrapKey(rotation->wrapped_key.get(), rotation->key.get(), password, this->salt_.get()) == 0 &&
+        this->crypto_->DeriveSubkey(rotation->fingerprint_key.get(), FINGERPRINT_SUBKEY_ID, rotation->key.get()) == 0;
+    if (!keyed) {
+        this->crypto_->Memzero(rotation->key.get(), this->KeyLen());
+        return ROTATE_KEY_KEY_ERR;
+    }
+    rotation->directory = this->directory_;
+    rotation->total = this->directory_.Size();
+
+    KeyRotation *running = rotation.get();
+    this->rotation_ = std::move(rotation);
+    running->thread = std::thread([this, running] {
+        running->status = this->RotateRecords(running);
+        running->done = true;
+    });
+    return ROTATE_KEY_VALID;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeyRotationStarted() const -> bool {
+    return this->rotation_ != nullptr;
 }
 
-auto Store::StoreExists(bool is_tmp) -> bool { return this->fileio_->GetExists(is_tmp); }
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeyRotationDone() const -> bool {
+    return this->rotation_ != nullptr && this->rotation_->done;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeyRotationProgress() const -> std::pair<uint64_t, uint64_t> {
+    if (this->rotation_ == nullptr) {
+        return {0, 0};
+    }
+    return {this->rotation_->rotated, this->rotation_->total};
+}
 
-auto Store::DeleteStore(bool is_tmp) -> int { return this->fileio_->Delete(is_tmp) ? 0 : -1; }
+// Changes made while the rotation ran were kept from autosave, which would have needed the temp file the rotation
+// writes, so they are saved now
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FinishKeyRotation() -> RotateKeyStatus {
+    if (this->rotation_ == nullptr) {
+        return ROTATE_KEY_VALID;
+    }
+    RotateKeyStatus status = this->EndKeyRotation();
+    if (status != ROTATE_KEY_REOPEN_ERR) {
+        this->RequestAutosave();
+    }
+    return status;
+}
 
-auto Store::CardsDisplayList() const -> std::vector<std::pair<uint32_t, std::string>> {
-    std::vector<std::pair<uint32_t, std::string>> result(this->cards_.size() - this->deleted_.size());
+// The committed store already holds every record under the new key as the rotation started; what is left is to switch
+// the keys, the fingerprints and the locations over to it and read from it from now on. Cards deleted while it ran are
+// skipped and stay in their dirty segments, cards added meanwhile are still unsaved and only need their fingerprints
+// taken again, and marks of use are kept; the next save writes all of them.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::EndKeyRotation() -> RotateKeyStatus {
+    if (this->rotation_ == nullptr) {
+        return ROTATE_KEY_VALID;
+    }
+    this->rotation_->thread.join();
+    std::unique_ptr<KeyRotation> rotation = std::move(this->rotation_);
+    if (rotation->status != 0) {
+        this->crypto_->Memzero(rotation->key.get(), this->KeyLen());
+        this->crypto_->Memzero(rotation->fingerprint_key.get(), this->KeyLen());
+        return ROTATE_KEY_WRITE_ERR;
+    }
 
-    uint32_t insert_idx = 0;
-    auto size = static_cast<uint32_t>(this->cards_.size());
-    for (uint32_t i = 0; i < size; ++i) {
-        if (this->deleted_.contains(i)) {
+    const std::vector<RecordDirectory::Entry> &rotated = rotation->directory.Entries();
+    for (size_t i = 0; i < rotated.size(); ++i) {
+        const RecordDirectory::Entry *entry = this->directory_.Find(rotated[i].id);
+        if (entry == nullptr) {
             continue;
         }
+        RecordDirectory::Metadata metadata = entry->metadata;
+        metadata.fingerprint = rotated[i].metadata.fingerprint;
+        this->index_.Remove(*entry);
+        this->directory_.SetMetadata(entry->id, metadata);
+        this->directory_.SetLocation(entry->id, rotation->locations[i]);
+        this->index_.Insert(*entry);
+    }
+
+    this->crypto_->Memzero(this->encryption_key_.get(), this->KeyLen());
+    this->crypto_->Memzero(this->fingerprint_key_.get(), this->KeyLen());
+    this->encryption_key_ = std::move(rotation->key);
+    this->fingerprint_key_ = std::move(rotation->fingerprint_key);
+    this->wrapped_key_ = std::move(rotation->wrapped_key);
+    this->hashed_password_.reset();
+    for (const auto &[card_id, card] : this->new_cards_) {
+        const RecordDirectory::Entry *entry = this->directory_.Find(card_id);
+        RecordDirectory::Metadata metadata = entry->metadata;
+        metadata.fingerprint = this->CardMetadata(card).fingerprint;
+        this->index_.Remove(*entry);
+        this->directory_.SetMetadata(card_id, metadata);
+        this->index_.Insert(*entry);
+    }
+    this->directory_offset_ = this->HeaderLen();
+    this->records_offset_ = this->directory_offset_ + rotation->directory_len;
+    this->records_len_ =
+        rotation->locations.empty() ? 0 : rotation->locations.back().offset + rotation->locations.back().length;
+    this->CacheKey();
+    return this->ReopenRead() == 0 ? ROTATE_KEY_VALID : ROTATE_KEY_REOPEN_ERR;
+}
+
+// While a rotation is under way the save waits for FinishKeyRotation, as both would write the temp file
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::RequestAutosave() {
+    if (this->autosave_window_ms_ != 0 && this->rotation_ == nullptr) {
+        this->RequestSave(true);
+    }
+}
+
+// Duplicates are found through the fingerprint index, so no stored record has to be opened to compare numbers
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::AddCard(const CreditCard &card) -> AddCardStatus {
+    AddCardStatus status = this->InsertCard(card);
+    if (status == ADD_CARD_VALID) {
+        this->RequestAutosave();
+    }
+    return status;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::InsertCard(const CreditCard &card) -> AddCardStatus {
+    RecordDirectory::Metadata metadata = this->CardMetadata(card);
+    if (this->index_.ContainsFingerprint(metadata.fingerprint)) {
+        return ADD_CARD_DUPLICATE;
+    }
+
+    uint32_t card_id = this->directory_.Add(card.GetName(), metadata);
+    this->index_.Insert(*this->directory_.Find(card_id));
+    this->orders_.Insert(*this->directory_.Find(card_id));
+    this->new_cards_.emplace(card_id, card);
+    this->dirty_segments_[card_id / SEGMENT_RECORDS] = ++this->edits_;
+    this->dirty_ = true;
+    return ADD_CARD_VALID;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::DeleteCard(uint32_t card_id) {
+    const RecordDirectory::Entry *entry = this->directory_.Find(card_id);
+    if (entry != nullptr) {
+        this->index_.Remove(*entry);
+        this->orders_.Remove(*entry);
+        this->directory_.Remove(card_id);
+        this->new_cards_.erase(card_id);
+        this->dirty_segments_[card_id / SEGMENT_RECORDS] = ++this->edits_;
+        this->dirty_ = true;
+        this->RequestAutosave();
+    }
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::StoreExists(bool is_tmp) -> bool {
+    return this->fileio_->GetExists(is_tmp);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::DeleteStore(bool is_tmp) -> int {
+    return this->fileio_->Delete(is_tmp) ? 0 : -1;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CardsDisplayList() const -> std::vector<std::pair<uint32_t, std::string>> {
+    std::vector<std::pair<uint32_t, std::string>> result;
+    result.reserve(this->directory_.Size());
+    for (const RecordDirectory::Entry &entry : this->directory_.Entries()) {
+        result.emplace_back(entry.id, entry.name);
+    }
+    return result;
+}
 
-        const CreditCard &card_ptr = this->cards_[i];
-        result[insert_idx] = std::make_pair(i, card_ptr.GetName());
-        ++insert_idx;
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CardsDisplayList(const std::vector<uint32_t> &card_ids) const
+    -> std::vector<std::pair<uint32_t, std::string>> {
+    std::vector<std::pair<uint32_t, std::string>> result;
+    result.reserve(card_ids.size());
+    for (uint32_t card_id : card_ids) {
+        const RecordDirectory::Entry *entry = this->directory_.Find(card_id);
+        if (entry != nullptr) {
+            result.emplace_back(entry->id, entry->name);
+        }
     }
     return result;
 }
 
-auto Store::GetCardById(uint32_t card_id) const -> const CreditCard & {
-    const CreditCard &card = this->cards_[card_id];
-    return card;
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CardsDisplayList(CardOrders::Order order) const
+    -> std::vector<std::pair<uint32_t, std::string>> {
+    return this->CardsDisplayList(this->orders_.Ids(order));
 }
 
-auto Store::ReadHeader(unsigned char *hash, unsigned char *salt) -> int {
-    if (this->fileio_->GetPositionRead() != 0) {
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::GetCardById(uint32_t card_id, CreditCard *card) -> int {
+    auto new_card = this->new_cards_.find(card_id);
+    if (new_card != this->new_cards_.end()) {
+        *card = new_card->second;
+        return 0;
+    }
+
+    const RecordDirectory::Entry *entry = this->directory_.Find(card_id);
+    if (entry == nullptr) {
         return -1;
     }
+    return this->ReadRecord(*entry, card);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::MarkUsed(uint32_t card_id) {
+    const RecordDirectory::Entry *entry = this->directory_.Find(card_id);
+    if (entry == nullptr) {
+        return;
+    }
 
-    if (!this->fileio_->Read(reinterpret_cast<char *>(hash), this->crypto_->HashLen())) {
+    this->orders_.Remove(*entry);
+    RecordDirectory::Metadata metadata = entry->metadata;
+    metadata.last_used = ++this->use_counter_;
+    this->directory_.SetMetadata(card_id, metadata);
+    this->orders_.Insert(*entry);
+    ++this->edits_;
+    this->dirty_ = true;
+    this->RequestAutosave();
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FindByName(const std::string &name) const -> std::vector<uint32_t> {
+    return this->index_.FindByName(name);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FindByNamePrefix(const std::string &prefix) const
+    -> std::vector<uint32_t> {
+    return this->index_.FindByNamePrefix(prefix);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FindByNumber(const std::string &card_number) -> std::vector<uint32_t> {
+    if (card_number.empty()) {
+        return {};
+    }
+    return this->index_.FindByFingerprint(this->NumberFingerprint(card_number, this->fingerprint_key_.get()));
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FindByExpiry(uint16_t first, uint16_t last) const
+    -> std::vector<uint32_t> {
+    return this->index_.FindByExpiry(first, last);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FindExpired(uint16_t current_expiry) const -> std::vector<uint32_t> {
+    if (current_expiry == 0) {
+        return {};
+    }
+    return this->index_.FindByExpiry(0, current_expiry - 1);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CardsByExpiry() const -> std::vector<uint32_t> {
+    return this->index_.ExpiryOrder();
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::FilterCards(const CardFilter &filter) const -> std::vector<uint32_t> {
+    return this->index_.Filter(filter);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReadHeader(unsigned char *hash, unsigned char *salt, uint8_t *cipher_suite,
+                                                        uint64_t *directory_len, bool *legacy) -> int {
+    HeaderPrefix prefix;
+    if (!this->fileio_->Read(reinterpret_cast<char *>(prefix.data()), HEADER_PREFIX_LEN)) {
         return -1;
     }
-    if (!this->fileio_->Read(reinterpret_cast<char *>(salt), this->crypto_->SaltLen())) {
+    *legacy = !std::equal(HEADER_MAGIC.begin(), HEADER_MAGIC.end(), prefix.begin());
+    if (*legacy) {
+        return 0;
+    }
+    if (prefix[HEADER_MAGIC.size()] != HEADER_VERSION) {
         return -1;
     }
+    *cipher_suite = prefix[HEADER_MAGIC.size() + 1];
 
-    if (this->fileio_->GetPositionRead() != (this->crypto_->HashLen() + this->crypto_->SaltLen())) {
+    // The rest of the fixed fields; the optional ones are read once the cipher suite byte says which follow
+    unsigned char directory_len_le[sizeof(uint64_t)];
+    bool key_wrapped = (*cipher_suite & HEADER_WRAPPED_KEY) != 0;
+    const std::array<iovec, HEADER_SEGMENTS> segments = this->HeaderSegments(
+        prefix.data(), key_wrapped ? nullptr : hash, salt, directory_len_le, nullptr, nullptr, {});
+    if (!this->fileio_->ReadV(std::span(segments).subspan(1))) {
         return -1;
     }
 
+    *directory_len = LoadLE64(directory_len_le);
     return 0;
 }
 
-auto Store::ReadData(unsigned char *decrypted_data, uintmax_t data_size, uint64_t *decrypted_size_actual) -> int {
-    unsigned char header[this->crypto_->EncryptionHeaderLen()];
-    uintmax_t encrypted_data_size = data_size - this->crypto_->EncryptionHeaderLen();
-    auto *encrypted_data = static_cast<unsigned char *>(malloc(encrypted_data_size));
+// Stores from before the header magic hold the password hash and salt, then the text of every card as one message
+// sealed under the password key, with the original cipher suite and a one-lane KDF. The cards come back as unsaved
+// cards under a new random data key, so the next save writes the current format; a duplicate number is kept once, as
+// AddCard would. With autosave on, the whole set is scheduled as one save rather than one per card.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::LoadLegacyStore(unsigned char *password) -> LoadStoreStatus {
+    HashBuf hash;
+    SaltBuf salt;
+    uintmax_t store_size = this->fileio_->GetSizeRead();
+    uint64_t fields_len = this->HashLen() + this->SaltLen();
+    bool read =
+        store_size >= fields_len &&
+        this->fileio_->ReadAt(reinterpret_cast<char *>(hash.data()), static_cast<int64_t>(this->HashLen()), 0) &&
+        this->fileio_->ReadAt(reinterpret_cast<char *>(salt.data()), static_cast<int64_t>(this->SaltLen()),
+                              this->HashLen());
+    if (!read || this->crypto_->SetCipherSuite(CIPHER_XCHACHA20POLY1305) != 0 || this->crypto_->SetKdfLanes(1) != 0) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_HEADER_READ_ERR;
+    }
+    if (this->crypto_->VerifyPasswordHash(hash.data(), password) != 0) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_PWD_VERIFY_ERR;
+    }
+
+    KeyBuf password_key;
+    if (this->KeyLen() > password_key.size() ||
+        this->crypto_->DeriveEncryptionKey(password_key.data(), this->KeyLen(), password, salt.data()) != 0) {
+        this->fileio_->CloseRead();
+        return LOAD_STORE_KEY_DERIVATION_ERR;
+    }
+    std::vector<unsigned char> text;
+    LoadStoreStatus status = this->ReadLegacyText(fields_len, store_size - fields_len, password_key.data(), &text);
+
+    // The password key is already derived, so it wraps the new data key here as WrapKey would
+    auto encryption_key = std::make_unique<unsigned char[]>(this->KeyLen());
+    auto fingerprint_key = std::make_unique<unsigned char[]>(this->KeyLen());
+    auto wrapped_key = std::make_unique<unsigned char[]>(this->WrappedKeyLen());
+    this->crypto_->GenerateKey(encryption_key.get());
+    if (status == LOAD_STORE_VALID &&
+        (this->crypto_->EncryptRecord(wrapped_key.get(), encryption_key.get(), this->KeyLen(), salt.data(),
+                                      this->SaltLen(), password_key.data()) != 0 ||
+         this->crypto_->DeriveSubkey(fingerprint_key.get(), FINGERPRINT_SUBKEY_ID, encryption_key.get()) != 0)) {
+        status = LOAD_STORE_KEY_DERIVATION_ERR;
+    }
+    this->crypto_->Memzero(password_key.data(), this->KeyLen());
+    if (status != LOAD_STORE_VALID) {
+        this->crypto_->Memzero(encryption_key.get(), this->KeyLen());
+        this->crypto_->Memzero(text.data(), text.size());
+        this->fileio_->CloseRead();
+        return status;
+    }
+
+    this->hashed_password_.reset();
+    this->salt_ = std::make_unique<unsigned char[]>(this->SaltLen());
+    std::memcpy(this->salt_.get(), salt.data(), this->SaltLen());
+    this->wrapped_key_ = std::move(wrapped_key);
+    this->kdf_lanes_ = 1;
+    this->key_slots_.clear();
+    this->encryption_key_ = std::move(encryption_key);
+    this->fingerprint_key_ = std::move(fingerprint_key);
+
+    this->directory_.Clear();
+    this->index_.Clear();
+    this->orders_.Clear();
+    this->use_counter_ = 0;
+    this->new_cards_.clear();
+    this->dirty_segments_.clear();
+    this->directory_offset_ = 0;
+    this->records_offset_ = 0;
+    this->records_len_ = 0;
+
+    char *rest = nullptr;
+    char *portion = strtok_r(reinterpret_cast<char *>(text.data()), ";", &rest);
+    while (portion != nullptr) {
+        CreditCard card;
+        card.InitFromText(portion);
+        this->InsertCard(card);
+        portion = strtok_r(nullptr, ";", &rest);
+    }
+    this->crypto_->Memzero(text.data(), text.size());
+    this->dirty_ = true;
+    this->CacheKey();
+    this->RequestAutosave();
+    return LOAD_STORE_VALID;
+}
+
+// The message is the stream header followed by the ciphertext; an empty store has none. text is left NUL-terminated.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReadLegacyText(uint64_t offset, uint64_t len, const unsigned char *key,
+                                                            std::vector<unsigned char> *text) -> LoadStoreStatus {
+    text->assign(1, 0);
+    if (len == 0) {
+        return LOAD_STORE_VALID;
+    }
+    EncryptionHeaderBuf header;
+    uint64_t header_len = this->crypto_->EncryptionHeaderLen();
+    if (header_len > header.size() || len < header_len + this->crypto_->EncryptionAddedBytes()) {
+        return LOAD_STORE_DATA_READ_ERR;
+    }
+    std::vector<unsigned char> encrypted(len - header_len);
+    if (!this->fileio_->ReadAt(reinterpret_cast<char *>(header.data()), static_cast<int64_t>(header_len), offset) ||
+        !this->fileio_->ReadAt(reinterpret_cast<char *>(encrypted.data()), static_cast<int64_t>(encrypted.size()),
+                               offset + header_len)) {
+        return LOAD_STORE_DATA_READ_ERR;
+    }
+
+    text->resize(encrypted.size() + 1);
+    uint64_t text_len = 0;
+    int status = this->crypto_->DecryptBuf(text->data(), &text_len, header.data(), encrypted.data(),
+                                           encrypted.size(), key);
+    if (status != 0 || text_len >= text->size()) {
+        return LOAD_STORE_DATA_DECRYPT_ERR;
+    }
+    (*text)[text_len] = 0;
+    return LOAD_STORE_VALID;
+}
+
+// The wrapped key is bound to the salt it was wrapped with, so it cannot be paired with another salt's password key
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WrapKey(unsigned char *wrapped_key, const unsigned char *key,
+                                                     const unsigned char *password, const unsigned char *salt) -> int {
+    KeyBuf password_key;
+    if (this->KeyLen() > password_key.size() ||
+        this->crypto_->DeriveEncryptionKey(password_key.data(), this->KeyLen(), password, salt) != 0) {
+        return -1;
+    }
+    int status =
+        this->crypto_->EncryptRecord(wrapped_key, key, this->KeyLen(), salt, this->SaltLen(), password_key.data());
+    this->crypto_->Memzero(password_key.data(), this->KeyLen());
+    return status;
+}
+
+// A wrong password fails the wrapped key's authentication tag, so unwrapping takes a single KDF run. Without a wrapped
+// key the password key is the data key, and only the password hash tells a wrong password apart.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::UnwrapKey(unsigned char *key, const unsigned char *hash,
+                                                       const unsigned char *wrapped_key, const unsigned char *password,
+                                                       const unsigned char *salt) -> LoadStoreStatus {
+    if (wrapped_key == nullptr) {
+        if (hash == nullptr || this->crypto_->VerifyPasswordHash(hash, password) != 0) {
+            return LOAD_STORE_PWD_VERIFY_ERR;
+        }
+        return this->crypto_->DeriveEncryptionKey(key, this->KeyLen(), password, salt) == 0
+                   ? LOAD_STORE_VALID
+                   : LOAD_STORE_KEY_DERIVATION_ERR;
+    }
+
+    KeyBuf password_key;
+    if (this->KeyLen() > password_key.size() ||
+        this->crypto_->DeriveEncryptionKey(password_key.data(), this->KeyLen(), password, salt) != 0) {
+        return LOAD_STORE_KEY_DERIVATION_ERR;
+    }
+    uint64_t key_len = 0;
+    int status = this->crypto_->DecryptRecord(key, &key_len, wrapped_key, this->WrappedKeyLen(), salt,
+                                              this->SaltLen(), password_key.data());
+    this->crypto_->Memzero(password_key.data(), this->KeyLen());
+    return status == 0 && key_len == this->KeyLen() ? LOAD_STORE_VALID : LOAD_STORE_PWD_VERIFY_ERR;
+}
+
+// New slots take the crypto layer's current limits; they are kept with the slot so it still opens if those change
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WrapKeySlot(KeySlot *slot, const unsigned char *key,
+                                                         const unsigned char *password) -> int {
+    slot->ops_limit = this->crypto_->KdfOpsLimit();
+    slot->mem_limit = this->crypto_->KdfMemLimit();
+    slot->salt.resize(this->SaltLen());
+    slot->wrapped_key.resize(this->WrappedKeyLen());
+    this->crypto_->GenerateSalt(slot->salt.data());
+
+    KeyBuf password_key;
+    if (this->KeyLen() > password_key.size() ||
+        this->crypto_->DeriveEncryptionKeyWithLimits(password_key.data(), this->KeyLen(), password, slot->salt.data(),
+                                                     slot->ops_limit, slot->mem_limit) != 0) {
+        return -1;
+    }
+    int status = this->crypto_->EncryptRecord(slot->wrapped_key.data(), key, this->KeyLen(), slot->salt.data(),
+                                              this->SaltLen(), password_key.data());
+    this->crypto_->Memzero(password_key.data(), this->KeyLen());
+    return status;
+}
 
-    if (!this->fileio_->Read(reinterpret_cast<char *>(header), this->crypto_->EncryptionHeaderLen())) {
-        free(encrypted_data);
+// Extra slots keep no password hash; the wrapped key's authentication tag is what tells a wrong password apart
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::UnwrapKeySlot(unsigned char *key, const KeySlot &slot,
+                                                           const unsigned char *password) -> int {
+    KeyBuf password_key;
+    if (this->KeyLen() > password_key.size() ||
+        this->crypto_->DeriveEncryptionKeyWithLimits(password_key.data(), this->KeyLen(), password, slot.salt.data(),
+                                                     slot.ops_limit, slot.mem_limit) != 0) {
+        return -1;
+    }
+    uint64_t key_len = 0;
+    int status = this->crypto_->DecryptRecord(key, &key_len, slot.wrapped_key.data(), this->WrappedKeyLen(),
+                                              slot.salt.data(), this->SaltLen(), password_key.data());
+    this->crypto_->Memzero(password_key.data(), this->KeyLen());
+    return status == 0 && key_len == this->KeyLen() ? 0 : -1;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReadKeySlots(std::vector<KeySlot> *slots) -> int {
+    uint8_t count = 0;
+    if (!this->fileio_->Read(reinterpret_cast<char *>(&count), sizeof(count)) || count == 0 ||
+        count >= MAX_KEY_SLOTS) {
+        return -1;
+    }
+    std::vector<unsigned char> data(count * this->KeySlotLen());
+    if (!this->fileio_->Read(reinterpret_cast<char *>(data.data()), static_cast<int64_t>(data.size()))) {
         return -1;
     }
-    if (!this->fileio_->Read(reinterpret_cast<char *>(encrypted_data), encrypted_data_size)) {
-        free(encrypted_data);
+
+    const unsigned char *pos = data.data();
+    for (uint8_t i = 0; i < count; ++i) {
+        KeySlot slot;
+        slot.ops_limit = LoadLE64(pos);
+        slot.mem_limit = LoadLE64(pos + sizeof(uint64_t));
+        pos += 2 * sizeof(uint64_t);
+        slot.salt.assign(pos, pos + this->SaltLen());
+        pos += this->SaltLen();
+        slot.wrapped_key.assign(pos, pos + this->WrappedKeyLen());
+        pos += this->WrappedKeyLen();
+        slots->push_back(std::move(slot));
+    }
+    return 0;
+}
+
+// Every slot is a trial on the unlock pool that unwraps its copy of the data key. The first trial to open its slot
+// hands over the key; trials still queued by then are skipped, while those already deriving run to the end, as a KDF
+// cannot be stopped partway.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::TryKeySlots(unsigned char *key, const unsigned char *hash,
+                                                         const unsigned char *salt, const unsigned char *wrapped_key,
+                                                         const std::vector<KeySlot> &slots,
+                                                         const unsigned char *password) -> LoadStoreStatus {
+    std::atomic<bool> opened = false;
+    std::atomic<bool> derivation_failed = false;
+    auto trial = [&](size_t slot) {
+        if (opened) {
+            return;
+        }
+        KeyBuf slot_key;
+        int status = -1;
+        if (slot == 0) {
+            LoadStoreStatus unwrap_status = this->UnwrapKey(slot_key.data(), hash, wrapped_key, password, salt);
+            derivation_failed = unwrap_status == LOAD_STORE_KEY_DERIVATION_ERR;
+            status = unwrap_status == LOAD_STORE_VALID ? 0 : -1;
+        } else {
+            status = this->UnwrapKeySlot(slot_key.data(), slots[slot - 1], password);
+        }
+        bool first = false;
+        if (status == 0 && opened.compare_exchange_strong(first, true)) {
+            std::memcpy(key, slot_key.data(), this->KeyLen());
+        }
+        this->crypto_->Memzero(slot_key.data(), this->KeyLen());
+    };
+
+    if (this->unlock_pool_ == nullptr) {
+        unsigned int threads = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_UNLOCK_THREADS);
+        this->unlock_pool_ = std::make_unique<ThreadPool>(threads);
+    }
+    for (size_t slot = 0; slot <= slots.size(); ++slot) {
+        this->unlock_pool_->Submit([&trial, slot] { trial(slot); });
+    }
+    this->unlock_pool_->Wait();
+
+    if (opened) {
+        return LOAD_STORE_VALID;
+    }
+    return derivation_failed ? LOAD_STORE_KEY_DERIVATION_ERR : LOAD_STORE_PWD_VERIFY_ERR;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::OpensKeySlot(const unsigned char *password) -> bool {
+    if (this->key_slots_.empty()) {
+        return this->VerifyPassword(password);
+    }
+    KeyBuf key;
+    bool opened = this->TryKeySlots(key.data(), this->hashed_password_.get(), this->salt_.get(),
+                                    this->wrapped_key_.get(), this->key_slots_, password) == LOAD_STORE_VALID;
+    this->crypto_->Memzero(key.data(), this->KeyLen());
+    return opened;
+}
+
+// Checks the password of slot 0 the way LoadStore does, by unwrapping the data key or, without a wrapped key, against
+// the password hash
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::VerifyPassword(const unsigned char *password) -> bool {
+    if (this->wrapped_key_ == nullptr) {
+        return this->hashed_password_ != nullptr &&
+               this->crypto_->VerifyPasswordHash(this->hashed_password_.get(), password) == 0;
+    }
+    KeyBuf key;
+    bool opened = this->UnwrapKey(key.data(), nullptr, this->wrapped_key_.get(), password, this->salt_.get()) ==
+                  LOAD_STORE_VALID;
+    this->crypto_->Memzero(key.data(), this->KeyLen());
+    return opened;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeyCacheName(const unsigned char *salt) const -> std::string {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string name = KEY_CACHE_PREFIX;
+    for (uint64_t i = 0; i < this->SaltLen(); ++i) {
+        name += HEX_DIGITS[salt[i] >> 4];
+        name += HEX_DIGITS[salt[i] & 0xf];
+    }
+    return name;
+}
+
+// Replaces the entry for this store's salt with the current data key and wrapped key; a cache that refuses it only
+// means the next unlock asks for the password
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::CacheKey() {
+    if (this->key_cache_ == nullptr || this->encryption_key_ == nullptr) {
+        return;
+    }
+    uint64_t wrapped_key_len = this->wrapped_key_ != nullptr ? this->WrappedKeyLen() : 0;
+    std::vector<unsigned char> entry(this->KeyLen() + wrapped_key_len);
+    std::memcpy(entry.data(), this->encryption_key_.get(), this->KeyLen());
+    if (wrapped_key_len != 0) {
+        std::memcpy(entry.data() + this->KeyLen(), this->wrapped_key_.get(), wrapped_key_len);
+    }
+    this->key_cache_->Put(this->KeyCacheName(this->salt_.get()), entry.data(), entry.size(), this->key_cache_timeout_);
+    this->crypto_->Memzero(entry.data(), entry.size());
+}
+
+// The header fields in memory are written out, along with any unsaved changes
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CommitHeader() -> SaveStoreStatus {
+    if (this->dirty_) {
+        return this->SaveStore();
+    }
+    return this->RewriteHeader();
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReadRecord(const RecordDirectory::Entry &entry, CreditCard *card) -> int {
+    std::vector<unsigned char> text;
+    if (this->DecryptRecordText(entry, &text) != 0) {
         return -1;
     }
+    return this->ParseRecord(&text, card);
+}
+
+// Fills card from the first card in a record's NUL-terminated text, then wipes the text
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ParseRecord(std::vector<unsigned char> *text, CreditCard *card) -> int {
+    char *rest = nullptr;
+    char *portion = strtok_r(reinterpret_cast<char *>(text->data()), ";", &rest);
+    if (portion != nullptr) {
+        card->InitFromText(portion);
+    }
+    this->crypto_->Memzero(text->data(), text->size());
+    return portion != nullptr ? 0 : -1;
+}
+
+// Directories written before metadata existed only name their records, so each record is opened once to fill it in.
+// Each segment of records is opened as its own task, and the store is then marked dirty so the next save writes the
+// current format.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RebuildMetadata() -> int {
+    const std::vector<RecordDirectory::Entry> &entries = this->directory_.Entries();
+    std::vector<std::pair<size_t, size_t>> segments;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (segments.empty() || entries[i].id / SEGMENT_RECORDS != entries[i - 1].id / SEGMENT_RECORDS) {
+            segments.emplace_back(i, i);
+        }
+        segments.back().second = i + 1;
+    }
+
+    std::vector<RecordDirectory::Metadata> metadata(entries.size());
+    std::atomic<bool> failed = false;
+    auto open_segment = [&](size_t begin, size_t end) {
+        std::vector<unsigned char> text;
+        for (size_t i = begin; i < end && !failed; ++i) {
+            CreditCard card;
+            if (this->DecryptRecordText(entries[i], &text) != 0 || this->ParseRecord(&text, &card) != 0) {
+                failed = true;
+                return;
+            }
+            metadata[i] = this->CardMetadata(card);
+        }
+    };
 
-    if (this->crypto_->DecryptBuf(decrypted_data, decrypted_size_actual, header, encrypted_data, encrypted_data_size,
-                                  this->encryption_key_.get()) != 0) {
-        free(encrypted_data);
+    if (segments.size() <= 1) {
+        for (const auto &[begin, end] : segments) {
+            open_segment(begin, end);
+        }
+    } else {
+        ThreadPool &pool = this->SegmentPool();
+        for (const auto &[begin, end] : segments) {
+            pool.Submit([&open_segment, begin, end] { open_segment(begin, end); });
+        }
+        pool.Wait();
+    }
+    if (failed) {
         return -1;
     }
 
-    free(encrypted_data);
+    for (size_t i = 0; i < metadata.size(); ++i) {
+        this->directory_.SetMetadata(entries[i].id, metadata[i]);
+    }
+    this->dirty_ = true;
     return 0;
 }
 
-auto Store::WriteHeader(const unsigned char *hash, const unsigned char *salt) -> int {
-    if (this->fileio_->GetPositionWriteTemp() != 0) {
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::CardMetadata(const CreditCard &card) -> RecordDirectory::Metadata {
+    RecordDirectory::Metadata metadata{};
+    std::string card_number = card.GetCardNumber();
+    if (!card_number.empty()) {
+        metadata.fingerprint = this->NumberFingerprint(card_number, this->fingerprint_key_.get());
+    }
+    metadata.expiry = card.GetExpiryKey();
+    metadata.network = static_cast<uint8_t>(card.GetNetwork());
+    metadata.tags = card.GetTags();
+    return metadata;
+}
+
+// Card numbers are hashed under a subkey of the store key, so equal numbers match without the fingerprints revealing
+// anything to someone without the password. Until a store is unlocked there is no key and no fingerprint.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::NumberFingerprint(const std::string &card_number,
+                                                               const unsigned char *fingerprint_key)
+    -> RecordDirectory::Fingerprint {
+    RecordDirectory::Fingerprint fingerprint{};
+    if (fingerprint_key != nullptr &&
+        this->crypto_->KeyedHash(fingerprint.data(), fingerprint.size(),
+                                 reinterpret_cast<const unsigned char *>(card_number.data()), card_number.size(),
+                                 fingerprint_key) != 0) {
+        fingerprint = {};
+    }
+    return fingerprint;
+}
+
+// Reads and opens one sealed record, leaving its NUL-terminated plaintext in text. Safe to call from several threads
+// at once, as the file layer's ReadAt is.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::DecryptRecordText(const RecordDirectory::Entry &entry,
+                                                               std::vector<unsigned char> *text) -> int {
+    uint64_t record_len = entry.location.length;
+    if (record_len < this->crypto_->RecordAddedBytes()) {
         return -1;
     }
 
-    this->fileio_->WriteTemp(reinterpret_cast<const char *>(hash), this->crypto_->HashLen());
-    this->fileio_->WriteTemp(reinterpret_cast<const char *>(salt), this->crypto_->SaltLen());
-    if (this->fileio_->GetPositionWriteTemp() != (this->crypto_->HashLen() + this->crypto_->SaltLen())) {
+    std::vector<unsigned char> record(record_len);
+    if (!this->fileio_->ReadAt(reinterpret_cast<char *>(record.data()), static_cast<int64_t>(record_len),
+                               this->records_offset_ + entry.location.offset)) {
         return -1;
     }
 
+    // The record id is the associated data, so a record moved under another id fails to open
+    unsigned char ad[sizeof(uint32_t)];
+    StoreLE32(ad, entry.id);
+    text->resize(record_len - this->crypto_->RecordAddedBytes() + 1);
+    uint64_t text_len = 0;
+    if (this->crypto_->DecryptRecord(text->data(), &text_len, record.data(), record_len, ad, sizeof(ad),
+                                     this->encryption_key_.get()) != 0) {
+        return -1;
+    }
+    text->resize(text_len + 1);
+    (*text)[text_len] = 0;
     return 0;
 }
 
-auto Store::WriteData(unsigned char *decrypted_data, uintmax_t decrypt_data_size) -> int {
-    unsigned char header[this->crypto_->EncryptionHeaderLen()];
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WriteHeader(const unsigned char *hash, const unsigned char *salt,
+                                                         const unsigned char *wrapped_key, uint32_t kdf_lanes,
+                                                         std::span<const KeySlot> key_slots, uint64_t directory_len)
+    -> int {
+    if (kdf_lanes == 0 || kdf_lanes > UINT8_MAX) {
+        return -1;
+    }
+    auto kdf_lanes_byte = static_cast<uint8_t>(kdf_lanes);
+    HeaderPrefix prefix = this->MakeHeaderPrefix(wrapped_key, key_slots, kdf_lanes);
+    unsigned char directory_len_le[sizeof(uint64_t)];
+    StoreLE64(directory_len_le, directory_len);
+    std::vector<unsigned char> key_slots_data = this->SerializeKeySlots(key_slots);
+    const std::array<iovec, HEADER_SEGMENTS> segments = this->HeaderSegments(
+        prefix.data(), const_cast<unsigned char *>(hash), const_cast<unsigned char *>(salt), directory_len_le,
+        const_cast<unsigned char *>(wrapped_key), kdf_lanes > 1 ? &kdf_lanes_byte : nullptr, key_slots_data);
+    return this->fileio_->WriteTempV(segments) ? 0 : -1;
+}
+
+// The store header, the encrypted directory and runs of newly sealed records are gathered into as few writes as
+// possible; runs carried over from the current store are copied across by the file layer
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WriteData(const unsigned char *hash, const unsigned char *salt,
+                                                       const unsigned char *wrapped_key, uint32_t kdf_lanes,
+                                                       std::span<const KeySlot> key_slots, const unsigned char *key,
+                                                       unsigned char *data, uintmax_t decrypt_data_size,
+                                                       std::span<const RecordRun> runs, unsigned char *sealed) -> int {
+    EncryptionHeaderBuf header;
+    uint64_t header_len = this->crypto_->EncryptionHeaderLen();
+    if (header_len > header.size() || kdf_lanes == 0 || kdf_lanes > UINT8_MAX) {
+        return -1;
+    }
     uint64_t encrypted_len = decrypt_data_size + this->crypto_->EncryptionAddedBytes();
-    auto *encrypted_data = static_cast<unsigned char *>(malloc(encrypted_len));
-    if (encrypted_data == nullptr) {
+
+    if (this->crypto_->EncryptBufInPlace(data, header.data(), decrypt_data_size, key) != 0) {
         return -1;
     }
 
-    if (this->crypto_->EncryptBuf(encrypted_data, header, decrypted_data, decrypt_data_size,
-                                  this->encryption_key_.get()) != 0) {
-        free(encrypted_data);
+    auto kdf_lanes_byte = static_cast<uint8_t>(kdf_lanes);
+    HeaderPrefix prefix = this->MakeHeaderPrefix(wrapped_key, key_slots, kdf_lanes);
+    unsigned char directory_len_le[sizeof(uint64_t)];
+    StoreLE64(directory_len_le, header_len + encrypted_len);
+    std::vector<unsigned char> key_slots_data = this->SerializeKeySlots(key_slots);
+    const std::array<iovec, HEADER_SEGMENTS> header_segments = this->HeaderSegments(
+        prefix.data(), const_cast<unsigned char *>(hash), const_cast<unsigned char *>(salt), directory_len_le,
+        const_cast<unsigned char *>(wrapped_key), kdf_lanes > 1 ? &kdf_lanes_byte : nullptr, key_slots_data);
+
+    std::vector<iovec> segments(header_segments.begin(), header_segments.end());
+    segments.push_back({.iov_base = header.data(), .iov_len = header_len});
+    segments.push_back({.iov_base = data, .iov_len = encrypted_len});
+    for (const RecordRun &run : runs) {
+        if (!run.stored) {
+            segments.push_back({.iov_base = sealed + run.offset, .iov_len = run.length});
+            continue;
+        }
+        if (!segments.empty() && !this->fileio_->WriteTempV(segments)) {
+            return -1;
+        }
+        segments.clear();
+        if (!this->fileio_->CopyToTemp(this->records_offset_ + run.offset, run.length)) {
+            return -1;
+        }
+    }
+    return segments.empty() || this->fileio_->WriteTempV(segments) ? 0 : -1;
+}
+
+// A new header ahead of the directory and records of the store open for reading, which the file layer copies across
+// untouched; nothing is decrypted or sealed again
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RewriteHeader() -> SaveStoreStatus {
+    uint64_t directory_len = this->records_offset_ - this->directory_offset_;
+    uint64_t copy_len = directory_len + this->records_len_;
+    if (this->fileio_->OpenWriteTemp() != 0) {
+        return SAVE_STORE_OPEN_ERR;
+    }
+    bool written = this->WriteHeader(this->hashed_password_.get(), this->salt_.get(), this->wrapped_key_.get(),
+                                     this->kdf_lanes_, this->key_slots_, directory_len) == 0 &&
+                   (copy_len == 0 || this->fileio_->CopyToTemp(this->directory_offset_, copy_len));
+    this->fileio_->CloseWriteTemp();
+    if (!written) {
+        return SAVE_STORE_HEADER_ERR;
+    }
+    if (this->fileio_->CommitTemp() != 0) {
+        return SAVE_STORE_COMMIT_TEMP_ERR;
+    }
+
+    this->directory_offset_ = this->HeaderLen();
+    this->records_offset_ = this->directory_offset_ + directory_len;
+    return this->ReopenRead() == 0 ? SAVE_STORE_VALID : SAVE_STORE_REOPEN_ERR;
+}
+
+// Moves reads over to the store just committed. Once the old handle is closed a failure leaves no store to read
+// records from, so callers report it apart from a failed write.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ReopenRead() -> int {
+    this->fileio_->CloseRead();
+    return this->fileio_->OpenRead(0);
+}
+
+// Runs on the rotation's thread. Records are read, opened, sealed again and written a chunk at a time, each chunk a
+// run of records adjacent on disk, so they keep their order and lengths. The directory ahead of them carries
+// fingerprints under the new key, which are only known once every record has been opened, so its space is skipped and
+// it is written last along with the header.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RotateRecords(KeyRotation *rotation) -> int {
+    const std::vector<RecordDirectory::Entry> &entries = rotation->directory.Entries();
+    if (this->fileio_->OpenWriteTemp() != 0) {
         return -1;
     }
+    if (entries.empty()) {
+        bool written =
+            this->WriteHeader(nullptr, this->salt_.get(), rotation->wrapped_key.get(), this->kdf_lanes_, {}, 0) == 0;
+        this->fileio_->CloseWriteTemp();
+        return written && this->fileio_->CommitTemp() == 0 ? 0 : -1;
+    }
+
+    uint64_t header_len = this->HeaderLen(nullptr, rotation->wrapped_key.get(), this->kdf_lanes_, {});
+    uint64_t directory_size = rotation->directory.SerializedSize();
+    uint64_t buf_len = directory_size + this->crypto_->EncryptionAddedBytes();
+    rotation->directory_len = this->crypto_->EncryptionHeaderLen() + buf_len;
+
+    // A record longer than a chunk gets a chunk of its own. Only one record is open at a time, so the text buffer
+    // needs one byte past the longest to terminate its text.
+    uint64_t longest = 0;
+    for (const RecordDirectory::Entry &entry : entries) {
+        longest = std::max<uint64_t>(longest, entry.location.length);
+    }
+    uint64_t chunk_capacity = std::max(ROTATION_CHUNK_LEN, longest);
+    std::vector<unsigned char> chunk(chunk_capacity);
+    auto *text = static_cast<unsigned char *>(this->crypto_->SecureAlloc(longest + 1));
+    bool written = text != nullptr && this->fileio_->SeekWriteTemp(header_len + rotation->directory_len);
+    uint64_t offset = 0;
+    for (size_t i = 0; written && i < entries.size();) {
+        uint64_t start = entries[i].location.offset;
+        uint64_t chunk_len = 0;
+        size_t end = i;
+        while (end < entries.size() && entries[end].location.offset == start + chunk_len &&
+               chunk_len + entries[end].location.length <= chunk_capacity) {
+            chunk_len += entries[end++].location.length;
+        }
+        written = end > i && this->fileio_->ReadAt(reinterpret_cast<char *>(chunk.data()),
+                                                   static_cast<int64_t>(chunk_len), this->records_offset_ + start);
+        for (; written && i < end; ++i) {
+            uint64_t pos = entries[i].location.offset - start;
+            written = this->ResealRecord(entries[i], chunk.data() + pos, text, rotation) == 0;
+            rotation->locations.push_back({.offset = offset + pos, .length = entries[i].location.length});
+        }
+        written = written && this->fileio_->WriteTemp(reinterpret_cast<const char *>(chunk.data()),
+                                                      static_cast<int64_t>(chunk_len));
+        offset += chunk_len;
+        rotation->rotated = i;
+    }
+    if (text != nullptr) {
+        this->crypto_->SecureFree(text);
+    }
+
+    if (written) {
+        std::vector<unsigned char> data(buf_len);
+        rotation->directory.Serialize(data.data() + this->crypto_->EncryptionInPlaceOffset(), rotation->locations);
+        written = this->fileio_->SeekWriteTemp(0) &&
+                  this->WriteData(nullptr, this->salt_.get(), rotation->wrapped_key.get(), this->kdf_lanes_, {},
+                                  rotation->key.get(), data.data(), directory_size, {}, nullptr) == 0;
+        this->crypto_->Memzero(data.data(), data.size());
+    }
+    this->fileio_->CloseWriteTemp();
+    return written && this->fileio_->CommitTemp() == 0 ? 0 : -1;
+}
 
-    this->fileio_->WriteTemp(reinterpret_cast<const char *>(header), sizeof(header));
-    this->fileio_->WriteTemp(reinterpret_cast<const char *>(encrypted_data), encrypted_len);
+// Opens one record under the current key and seals it again in place under the new one, taking the card number's
+// fingerprint under the new key while the text is open
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ResealRecord(const RecordDirectory::Entry &entry, unsigned char *record,
+                                                          unsigned char *text, KeyRotation *rotation) -> int {
+    uint64_t record_len = entry.location.length;
+    if (record_len < this->crypto_->RecordAddedBytes()) {
+        return -1;
+    }
 
-    if (this->fileio_->GetPositionWriteTemp() !=
-        (this->crypto_->HashLen() + this->crypto_->SaltLen() + sizeof(header) + encrypted_len)) {
-        free(encrypted_data);
+    unsigned char ad[sizeof(uint32_t)];
+    StoreLE32(ad, entry.id);
+    uint64_t text_len = 0;
+    if (this->crypto_->DecryptRecord(text, &text_len, record, record_len, ad, sizeof(ad),
+                                     this->encryption_key_.get()) != 0) {
         return -1;
     }
+    int status = this->crypto_->EncryptRecord(record, text, text_len, ad, sizeof(ad), rotation->key.get());
 
-    free(encrypted_data);
-    return 0;
+    text[text_len] = 0;
+    char *rest = nullptr;
+    char *portion = strtok_r(reinterpret_cast<char *>(text), ";", &rest);
+    CreditCard card;
+    if (portion != nullptr) {
+        card.InitFromText(portion);
+    }
+    this->crypto_->Memzero(text, text_len + 1);
+
+    RecordDirectory::Metadata metadata = entry.metadata;
+    std::string card_number = card.GetCardNumber();
+    metadata.fingerprint = card_number.empty() ? RecordDirectory::Fingerprint{}
+                                               : this->NumberFingerprint(card_number, rotation->fingerprint_key.get());
+    this->crypto_->Memzero(card_number.data(), card_number.size());
+    rotation->directory.SetMetadata(entry.id, metadata);
+    return status;
 }
 
-auto Store::GetCardsSize() -> uintmax_t {
-    uintmax_t total_size = 0;
-    auto size = static_cast<uint32_t>(this->cards_.size());
-    for (uint32_t i = 0; i < size; ++i) {
-        if (this->deleted_.contains(i)) {
-            continue;
+// Only the first request while the save thread is idle starts it. Later requests share one waiting snapshot, which
+// each replaces with a newer one until it is due and the thread takes it, and a request with no changes since the
+// latest snapshot shares that snapshot's save.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::RequestSave(bool autosave) -> std::shared_future<SaveStoreStatus> {
+    this->EndKeyRotation();
+    auto now = this->autosave_clock_();
+    if (this->save_ != nullptr) {
+        std::unique_lock<std::mutex> lock(this->save_->mutex);
+        if (this->save_->running) {
+            if (this->edits_ != this->save_->latest_edits) {
+                if (this->save_->next == nullptr) {
+                    this->save_->next_done = std::promise<SaveStoreStatus>();
+                    this->save_->latest = this->save_->next_done.get_future().share();
+                    this->save_->next_deadline = now + std::chrono::milliseconds(this->autosave_max_unsaved_ms_);
+                }
+                this->save_->next = this->TakeSnapshot();
+                this->save_->latest_edits = this->edits_;
+            }
+            std::shared_future<SaveStoreStatus> result = this->save_->latest;
+            if (this->save_->next != nullptr) {
+                this->ScheduleNextSave(now, autosave);
+                lock.unlock();
+                this->save_->wake.notify_one();
+            }
+            return result;
+        }
+    }
+    SaveStoreStatus finished = this->FinishSaves();
+
+    // With no store open for reading, the records a new save would copy across cannot be read
+    std::promise<SaveStoreStatus> done;
+    std::shared_future<SaveStoreStatus> result = done.get_future().share();
+    if (finished == SAVE_STORE_REOPEN_ERR || !this->dirty_) {
+        done.set_value(finished == SAVE_STORE_REOPEN_ERR ? finished : SAVE_STORE_VALID);
+        return result;
+    }
+
+    this->save_ = std::make_unique<BackgroundSave>();
+    this->save_->running = true;
+    this->save_->next = this->TakeSnapshot();
+    this->save_->next_done = std::move(done);
+    this->save_->next_deadline = now + std::chrono::milliseconds(this->autosave_max_unsaved_ms_);
+    this->ScheduleNextSave(now, autosave);
+    this->save_->latest = result;
+    this->save_->latest_edits = this->edits_;
+    this->save_->thread = std::thread([this] { this->RunSaves(); });
+    return result;
+}
+
+// An autosave waits for the window to pass without another change, up to the deadline set by the first change the
+// snapshot holds; any other request is due at once. Called with the save mutex held.
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::ScheduleNextSave(std::chrono::steady_clock::time_point now,
+                                                              bool autosave) {
+    if (!autosave) {
+        this->save_->next_deadline = now;
+    }
+    this->save_->next_due =
+        std::min(now + std::chrono::milliseconds(this->autosave_window_ms_), this->save_->next_deadline);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::TakeSnapshot() -> std::unique_ptr<SaveSnapshot> {
+    auto snapshot = std::make_unique<SaveSnapshot>();
+    snapshot->directory = this->directory_;
+    snapshot->new_cards = this->new_cards_;
+    snapshot->dirty_segments = this->dirty_segments_;
+    snapshot->edits = this->edits_;
+    return snapshot;
+}
+
+// Runs on the save thread until no snapshot is waiting, taking each once it is due. Each save plans its copies from
+// the store open for reading, which the thread only reads, and reads the keys and header fields, which nothing changes
+// without FinishSaves.
+template <typename CryptoPolicy, typename FileIOPolicy>
+void BasicStore<CryptoPolicy, FileIOPolicy>::RunSaves() {
+    std::unique_lock<std::mutex> lock(this->save_->mutex);
+    while (this->save_->next != nullptr) {
+        for (auto now = this->autosave_clock_(); now < this->save_->next_due; now = this->autosave_clock_()) {
+            this->save_->wake.wait_for(lock, this->save_->next_due - now);
+        }
+        std::unique_ptr<SaveSnapshot> snapshot = std::move(this->save_->next);
+        std::promise<SaveStoreStatus> done = std::move(this->save_->next_done);
+        lock.unlock();
+
+        auto saved = std::make_unique<SavedStore>();
+        SaveStoreStatus status =
+            this->WriteStore(snapshot->directory, snapshot->new_cards, snapshot->dirty_segments, saved.get());
+        saved->edits = snapshot->edits;
+
+        lock.lock();
+        this->save_->status = status;
+        if (status == SAVE_STORE_VALID) {
+            this->save_->saved = std::move(saved);
+        }
+        done.set_value(status);
+    }
+    this->save_->running = false;
+}
+
+// Writes directory and its records to the temp file and commits it. The records are copied from the store open for
+// reading, except those in new_cards, which are sealed; saved is given where each entry now lives.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WriteStore(const RecordDirectory &directory,
+                                                        const std::unordered_map<uint32_t, CreditCard> &new_cards,
+                                                        const std::unordered_map<uint32_t, uint64_t> &dirty_segments,
+                                                        SavedStore *saved) -> SaveStoreStatus {
+    if (this->fileio_->OpenWriteTemp() != 0) {
+        return SAVE_STORE_OPEN_ERR;
+    }
+
+    std::vector<RecordDirectory::Location> locations;
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    if (directory.Size() == 0) {
+        if (this->WriteHeader(this->hashed_password_.get(), this->salt_.get(), this->wrapped_key_.get(),
+                              this->kdf_lanes_, this->key_slots_, 0) != 0) {
+            this->fileio_->CloseWriteTemp();
+            return SAVE_STORE_HEADER_ERR;
         }
+    } else {
+        std::vector<unsigned char> sealed;
+        std::vector<RecordRun> runs;
+        if (this->PlanRecords(directory, new_cards, dirty_segments, &locations, &sealed, &runs) != 0) {
+            this->fileio_->CloseWriteTemp();
+            return SAVE_STORE_WRITE_DATA_ERR;
+        }
+        records_len = locations.back().offset + locations.back().length;
+
+        // The directory is serialized directly into the buffer that WriteData encrypts in place
+        uintmax_t directory_size = directory.SerializedSize();
+        uintmax_t buf_len = directory_size + this->crypto_->EncryptionAddedBytes();
+        auto *data = static_cast<unsigned char *>(malloc(buf_len));
+        if (data == nullptr) {
+            this->fileio_->CloseWriteTemp();
+            return SAVE_STORE_WRITE_DATA_ERR;
+        }
+
+        directory.Serialize(data + this->crypto_->EncryptionInPlaceOffset(), locations);
+        int write_status = this->WriteData(this->hashed_password_.get(), this->salt_.get(), this->wrapped_key_.get(),
+                                           this->kdf_lanes_, this->key_slots_, this->encryption_key_.get(), data,
+                                           directory_size, runs, sealed.data());
+        this->crypto_->Memzero(data, buf_len);
+        free(data);
+        if (write_status != 0) {
+            this->fileio_->CloseWriteTemp();
+            return SAVE_STORE_WRITE_DATA_ERR;
+        }
+        directory_len = this->crypto_->EncryptionHeaderLen() + buf_len;
+    }
+    this->fileio_->CloseWriteTemp();
+
+    if (this->fileio_->CommitTemp() != 0) {
+        return SAVE_STORE_COMMIT_TEMP_ERR;
+    }
+
+    saved->ids.reserve(directory.Size());
+    for (const RecordDirectory::Entry &entry : directory.Entries()) {
+        saved->ids.push_back(entry.id);
+    }
+    saved->locations = std::move(locations);
+    saved->directory_len = directory_len;
+    saved->records_len = records_len;
+    return SAVE_STORE_VALID;
+}
 
-        const CreditCard &card_ptr = this->cards_[i];
-        total_size += card_ptr.FormatText().size();
+// Every saved record now lives in the committed store, so lazy reads have to come from it. Ids are never reused, so an
+// entry missing from the save was added after it and is still unsaved, as is anything changed after its edit count.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::ApplySave(const SavedStore &saved) -> SaveStoreStatus {
+    std::vector<RecordDirectory::Location> locations;
+    locations.reserve(this->directory_.Size());
+    size_t next = 0;
+    for (const RecordDirectory::Entry &entry : this->directory_.Entries()) {
+        while (next < saved.ids.size() && saved.ids[next] < entry.id) {
+            ++next;
+        }
+        if (next < saved.ids.size() && saved.ids[next] == entry.id) {
+            locations.push_back(saved.locations[next]);
+            this->new_cards_.erase(entry.id);
+        } else {
+            locations.push_back(entry.location);
+        }
     }
-    return total_size;
+    this->directory_.SetLocations(locations);
+    std::erase_if(this->dirty_segments_, [&saved](const auto &segment) { return segment.second <= saved.edits; });
+
+    this->directory_offset_ = this->HeaderLen();
+    this->records_offset_ = this->directory_offset_ + saved.directory_len;
+    this->records_len_ = saved.records_len;
+    this->dirty_ = this->edits_ != saved.edits;
+    return this->ReopenRead() == 0 ? SAVE_STORE_VALID : SAVE_STORE_REOPEN_ERR;
 }
 
-auto Store::CardsFormatted(unsigned char *buf) -> uintmax_t {
-    uintmax_t pos = 0;
-    auto size = static_cast<uint32_t>(this->cards_.size());
-    for (uint32_t i = 0; i < size; ++i) {
-        if (this->deleted_.contains(i)) {
+// Records are grouped by id into segments. A segment with no record added or deleted since the last save is still one
+// contiguous run of ciphertext in the current store, so it is copied across whole and its records all move by the same
+// amount. In a dirty segment only the new records are sealed, under their id; records already on disk are still
+// copied verbatim, since they stay sealed under the same key and id. Runs that are adjacent in their source merge.
+// The layout is fixed before anything is sealed, so every dirty segment can then be sealed independently.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::PlanRecords(const RecordDirectory &directory,
+                                                         const std::unordered_map<uint32_t, CreditCard> &new_cards,
+                                                         const std::unordered_map<uint32_t, uint64_t> &dirty_segments,
+                                                         std::vector<RecordDirectory::Location> *locations,
+                                                         std::vector<unsigned char> *sealed,
+                                                         std::vector<RecordRun> *runs) -> int {
+    const std::vector<RecordDirectory::Entry> &entries = directory.Entries();
+    uint64_t added_bytes = this->crypto_->RecordAddedBytes();
+
+    std::vector<std::string> texts;
+    texts.reserve(new_cards.size());
+    uint64_t sealed_len = 0;
+    for (const RecordDirectory::Entry &entry : entries) {
+        if (entry.location.offset == RecordDirectory::NOT_STORED) {
+            texts.push_back(new_cards.at(entry.id).FormatText());
+            sealed_len += texts.back().size() + added_bytes;
+        }
+    }
+    sealed->resize(sealed_len);
+
+    auto append_run = [runs](bool stored, uint64_t offset, uint64_t length) {
+        if (!runs->empty() && runs->back().stored == stored && runs->back().offset + runs->back().length == offset) {
+            runs->back().length += length;
+        } else {
+            runs->push_back({.stored = stored, .offset = offset, .length = length});
+        }
+    };
+
+    uint64_t offset = 0;
+    uint64_t sealed_pos = 0;
+    size_t text_idx = 0;
+    std::vector<std::vector<SealJob>> seal_jobs; // one list per dirty segment
+    locations->reserve(entries.size());
+    for (size_t i = 0; i < entries.size();) {
+        uint32_t segment = entries[i].id / SEGMENT_RECORDS;
+        size_t end = i;
+        while (end < entries.size() && entries[end].id / SEGMENT_RECORDS == segment) {
+            ++end;
+        }
+
+        if (!dirty_segments.contains(segment)) {
+            uint64_t start = entries[i].location.offset;
+            const RecordDirectory::Location &last = entries[end - 1].location;
+            uint64_t segment_len = last.offset + last.length - start;
+            append_run(true, start, segment_len);
+            for (; i < end; ++i) {
+                locations->push_back(
+                    {.offset = offset + entries[i].location.offset - start, .length = entries[i].location.length});
+            }
+            offset += segment_len;
             continue;
         }
 
-        const CreditCard &card_ptr = this->cards_[i];
-        std::string formatted_card = card_ptr.FormatText();
-        size_t formatted_len = formatted_card.size();
-        memcpy(buf + pos, formatted_card.c_str(), formatted_len);
-        pos += formatted_len;
+        for (; i < end; ++i) {
+            const RecordDirectory::Entry &entry = entries[i];
+            uint32_t record_len = entry.location.length;
+            if (entry.location.offset == RecordDirectory::NOT_STORED) {
+                if (seal_jobs.empty() || seal_jobs.back().front().id / SEGMENT_RECORDS != segment) {
+                    seal_jobs.emplace_back();
+                }
+                seal_jobs.back().push_back({.id = entry.id, .text = text_idx, .offset = sealed_pos});
+                record_len = static_cast<uint32_t>(texts[text_idx++].size() + added_bytes);
+                append_run(false, sealed_pos, record_len);
+                sealed_pos += record_len;
+            } else {
+                append_run(true, entry.location.offset, record_len);
+            }
+            locations->push_back({.offset = offset, .length = record_len});
+            offset += record_len;
+        }
     }
 
-    return pos;
+    int status = this->SealSegments(seal_jobs, texts, sealed->data());
+    for (std::string &text : texts) {
+        this->crypto_->Memzero(text.data(), text.size());
+    }
+    return status;
 }
 
-void Store::LoadCards(unsigned char *data) {
-    if (data == nullptr) {
-        return;
+// Each dirty segment is sealed as one task on the seal pool; the tasks only share the key, read-only. A single segment
+// is sealed inline, so small wallets never start the pool.
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SealSegments(const std::vector<std::vector<SealJob>> &seal_jobs,
+                                                          const std::vector<std::string> &texts, unsigned char *sealed)
+    -> int {
+    std::atomic<bool> failed = false;
+    auto seal_segment = [&](const std::vector<SealJob> &jobs) {
+        for (const SealJob &job : jobs) {
+            const std::string &text = texts[job.text];
+            unsigned char ad[sizeof(uint32_t)];
+            StoreLE32(ad, job.id);
+            if (this->crypto_->EncryptRecord(sealed + job.offset, reinterpret_cast<const unsigned char *>(text.data()),
+                                             text.size(), ad, sizeof(ad), this->encryption_key_.get()) != 0) {
+                failed = true;
+                return;
+            }
+        }
+    };
+
+    if (seal_jobs.size() <= 1) {
+        for (const std::vector<SealJob> &jobs : seal_jobs) {
+            seal_segment(jobs);
+        }
+        return failed ? -1 : 0;
     }
 
-    char *rest = nullptr;
-    char *portion = strtok_r(reinterpret_cast<char *>(data), ";", &rest);
+    ThreadPool &pool = this->SegmentPool();
+    for (const std::vector<SealJob> &jobs : seal_jobs) {
+        pool.Submit([&seal_segment, &jobs] { seal_segment(jobs); });
+    }
+    pool.Wait();
+    return failed ? -1 : 0;
+}
 
-    while (portion != nullptr) {
-        CreditCard card;
-        card.InitFromText(portion);
-        this->AddCard(card);
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SegmentPool() -> ThreadPool & {
+    if (this->segment_pool_ == nullptr) {
+        unsigned int threads = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_SEGMENT_THREADS);
+        this->segment_pool_ = std::make_unique<ThreadPool>(threads);
+    }
+    return *this->segment_pool_;
+}
 
-        portion = strtok_r(nullptr, ";", &rest);
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::HeaderLen() const -> uint64_t {
+    return this->HeaderLen(this->hashed_password_.get(), this->wrapped_key_.get(), this->kdf_lanes_, this->key_slots_);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::HeaderLen(const unsigned char *hash, const unsigned char *wrapped_key,
+                                                       uint32_t kdf_lanes, std::span<const KeySlot> key_slots) const
+    -> uint64_t {
+    // magic, version and cipher suite, hash, salt, directory length, wrapped key, KDF lanes, key slots
+    return HEADER_PREFIX_LEN + (hash != nullptr ? this->HashLen() : 0) + this->SaltLen() + sizeof(uint64_t) +
+           (wrapped_key != nullptr ? this->WrappedKeyLen() : 0) + (kdf_lanes > 1 ? sizeof(uint8_t) : 0) +
+           (!key_slots.empty() ? sizeof(uint8_t) + key_slots.size() * this->KeySlotLen() : 0);
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::MakeHeaderPrefix(const unsigned char *wrapped_key,
+                                                              std::span<const KeySlot> key_slots,
+                                                              uint32_t kdf_lanes) const -> HeaderPrefix {
+    HeaderPrefix prefix;
+    std::copy(HEADER_MAGIC.begin(), HEADER_MAGIC.end(), prefix.begin());
+    prefix[HEADER_MAGIC.size()] = HEADER_VERSION;
+    prefix[HEADER_MAGIC.size() + 1] = this->crypto_->GetCipherSuite() |
+                                      (wrapped_key != nullptr ? HEADER_WRAPPED_KEY : 0) |
+                                      (!key_slots.empty() ? HEADER_KEY_SLOTS : 0) |
+                                      (kdf_lanes > 1 ? HEADER_KDF_LANES : 0);
+    return prefix;
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::HeaderSegments(unsigned char *prefix, unsigned char *hash,
+                                                            unsigned char *salt, unsigned char *directory_len,
+                                                            unsigned char *wrapped_key, uint8_t *kdf_lanes,
+                                                            std::span<unsigned char> key_slots) const
+    -> std::array<iovec, HEADER_SEGMENTS> {
+    return {{
+        {.iov_base = prefix, .iov_len = HEADER_PREFIX_LEN},
+        {.iov_base = hash, .iov_len = hash != nullptr ? this->HashLen() : 0},
+        {.iov_base = salt, .iov_len = this->SaltLen()},
+        {.iov_base = directory_len, .iov_len = sizeof(uint64_t)},
+        {.iov_base = wrapped_key, .iov_len = wrapped_key != nullptr ? this->WrappedKeyLen() : 0},
+        {.iov_base = kdf_lanes, .iov_len = kdf_lanes != nullptr ? sizeof(uint8_t) : 0},
+        {.iov_base = key_slots.data(), .iov_len = key_slots.size()},
+    }};
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SerializeKeySlots(std::span<const KeySlot> key_slots) const
+    -> std::vector<unsigned char> {
+    if (key_slots.empty()) {
+        return {};
+    }
+    std::vector<unsigned char> data(sizeof(uint8_t) + key_slots.size() * this->KeySlotLen());
+    data[0] = static_cast<uint8_t>(key_slots.size());
+    unsigned char *pos = data.data() + sizeof(uint8_t);
+    for (const KeySlot &slot : key_slots) {
+        StoreLE64(pos, slot.ops_limit);
+        StoreLE64(pos + sizeof(uint64_t), slot.mem_limit);
+        pos += 2 * sizeof(uint64_t);
+        std::memcpy(pos, slot.salt.data(), this->SaltLen());
+        pos += this->SaltLen();
+        std::memcpy(pos, slot.wrapped_key.data(), this->WrappedKeyLen());
+        pos += this->WrappedKeyLen();
     }
+    return data;
 }
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::HashLen() const -> uint64_t {
+    if constexpr (CryptoPolicy::FIXED_KEY_SIZES) {
+        return CryptoPolicy::MAX_HASH_LEN;
+    } else {
+        return this->crypto_->HashLen();
+    }
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::SaltLen() const -> uint64_t {
+    if constexpr (CryptoPolicy::FIXED_KEY_SIZES) {
+        return CryptoPolicy::MAX_SALT_LEN;
+    } else {
+        return this->crypto_->SaltLen();
+    }
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeyLen() const -> uint64_t {
+    if constexpr (CryptoPolicy::FIXED_KEY_SIZES) {
+        return CryptoPolicy::MAX_ENCRYPTION_KEY_LEN;
+    } else {
+        return this->crypto_->EncryptionKeyLen();
+    }
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::WrappedKeyLen() const -> uint64_t {
+    return this->KeyLen() + this->crypto_->RecordAddedBytes();
+}
+
+template <typename CryptoPolicy, typename FileIOPolicy>
+auto BasicStore<CryptoPolicy, FileIOPolicy>::KeySlotLen() const -> uint64_t {
+    return 2 * sizeof(uint64_t) + this->SaltLen() + this->WrappedKeyLen();
+}
+
+template class BasicStore<ICrypto, IFileIO>;
+template class BasicStore<SodiumCrypto, PosixFileIO>;
@@ -0,0 +1,58 @@
+#include "threadpool.hpp"
+
+#include <utility>
+
+ThreadPool::ThreadPool(size_t threads) {
+    this->workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        this->workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+// Queued tasks still run before the workers exit
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stopping_ = true;
+    }
+    this->task_ready_.notify_all();
+    for (std::thread &worker : this->workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->tasks_.push_back(std::move(task));
+    }
+    this->task_ready_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    this->idle_.wait(lock, [this] { return this->tasks_.empty() && this->running_ == 0; });
+}
+
+auto ThreadPool::Size() const -> size_t { return this->workers_.size(); }
+
+void ThreadPool::WorkerLoop() {
+    std::unique_lock<std::mutex> lock(this->mutex_);
+    while (true) {
+        this->task_ready_.wait(lock, [this] { return this->stopping_ || !this->tasks_.empty(); });
+        if (this->tasks_.empty()) {
+            return; // stopping with nothing left to run
+        }
+
+        std::function<void()> task = std::move(this->tasks_.front());
+        this->tasks_.pop_front();
+        ++this->running_;
+        lock.unlock();
+        task();
+        lock.lock();
+        --this->running_;
+        if (this->tasks_.empty() && this->running_ == 0) {
+            this->idle_.notify_all();
+        }
+    }
+}
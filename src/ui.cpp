@@ -37,21 +37,35 @@ auto UI::ProfileMenu(const std::string &status_msg) const -> UI::ProfileMenuOpti
     std::cout << UIStrings::PROFILE_MENU_LIST;
     std::cout << UIStrings::PROFILE_MENU_ADD;
     std::cout << UIStrings::PROFILE_MENU_DELETE;
-
-    return static_cast<UI::ProfileMenuOption>(this->GetSelection(0, 3));
+    std::cout << UIStrings::PROFILE_MENU_EXPIRING;
+    std::cout << UIStrings::PROFILE_MENU_FILTER;
+    std::cout << UIStrings::PROFILE_MENU_CHANGE_PASSWORD;
+    std::cout << UIStrings::PROFILE_MENU_ROTATE_KEY;
+    std::cout << UIStrings::PROFILE_MENU_ADD_KEY_SLOT;
+    std::cout << UIStrings::PROFILE_MENU_REMOVE_KEY_SLOT;
+
+    return static_cast<UI::ProfileMenuOption>(this->GetSelection(0, 9));
 }
 
-auto UI::CardListMenu(const std::vector<std::pair<uint32_t, std::string>> &cards_list) const -> int {
+auto UI::CardListMenu(const std::vector<std::pair<uint32_t, std::string>> &cards_list,
+                      const std::string &order_label) const -> int {
     ClearScreen();
 
     auto choice_mapping = std::unordered_map<int, uint32_t>();
     std::cout << UIStrings::LIST_CARDS_RETURN;
+    if (!order_label.empty()) {
+        std::cout << UIStrings::LIST_CARDS_NEXT_ORDER << order_label << "\n";
+    }
 
     this->ListCards(cards_list, choice_mapping, /* starting_option */ 1);
 
-    int selection = this->GetSelection(0, static_cast<int>(cards_list.size()));
+    std::string key = order_label.empty() ? "" : UIStrings::LIST_CARDS_NEXT_ORDER_KEY;
+    int selection = this->GetSelectionOrKey(0, static_cast<int>(cards_list.size()), key);
+    if (selection == KEY_SELECTED) {
+        return CARD_LIST_NEXT_ORDER;
+    }
     if (selection == 0) {
-        return -1;
+        return CARD_LIST_RETURN;
     }
     return static_cast<int>(choice_mapping.at(selection));
 }
@@ -112,6 +126,18 @@ auto UI::CardDeleteMenu(const std::vector<std::pair<uint32_t, std::string>> &car
     }
 }
 
+auto UI::KeySlotRemoveMenu(size_t slot_count) const -> int {
+    ClearScreen();
+
+    std::cout << UIStrings::REMOVE_KEY_SLOT_MESSAGE;
+    std::cout << UIStrings::REMOVE_KEY_SLOT_RETURN;
+    for (size_t slot = 1; slot < slot_count; ++slot) {
+        std::cout << "[" << slot << "] " << UIStrings::KEY_SLOT_LABEL << slot << "\n";
+    }
+
+    return this->GetSelection(0, static_cast<int>(slot_count) - 1);
+}
+
 void UI::DisplayHashing() const { std::cout << UIStrings::HASHING; }
 
 void UI::PromptCardCvv(const std::string &status_msg, std::string &cvv) const {
@@ -146,6 +172,14 @@ void UI::PromptCardNumber(const std::string &status_msg, std::string &card_numbe
     card_number = this->PromptInput();
 }
 
+void UI::PromptCardTags(const std::string &status_msg, std::string &tags) const {
+    ClearScreen();
+
+    std::cout << status_msg;
+    std::cout << UIStrings::CARD_TAGS_PROMPT;
+    tags = this->PromptInput();
+}
+
 void UI::PromptCardYear(const std::string &status_msg, std::string &year) const {
     ClearScreen();
 
@@ -154,6 +188,13 @@ void UI::PromptCardYear(const std::string &status_msg, std::string &year) const
     year = this->PromptInput();
 }
 
+void UI::PromptFilterTags(std::string &tags) const {
+    ClearScreen();
+
+    std::cout << UIStrings::FILTER_TAGS_PROMPT;
+    tags = this->PromptInput();
+}
+
 void UI::PromptLogin(std::string &password) const {
     ClearScreen();
 
@@ -180,11 +221,17 @@ void UI::ListCards(const std::vector<std::pair<uint32_t, std::string>> &cards_li
     }
 }
 
-auto UI::GetSelection(int lower, int upper) const -> int {
+auto UI::GetSelection(int lower, int upper) const -> int { return this->GetSelectionOrKey(lower, upper, ""); }
+
+// An empty key accepts numbers only; otherwise entering the key returns KEY_SELECTED
+auto UI::GetSelectionOrKey(int lower, int upper, const std::string &key) const -> int {
     std::string input_string;
     bool valid_input;
     do {
         input_string = this->PromptInput();
+        if (!key.empty() && input_string == key) {
+            return KEY_SELECTED;
+        }
         valid_input = ValidateInputInRange(input_string, lower, upper);
 
         if (!valid_input) {
@@ -82,4 +82,50 @@ auto GetFilePath(const std::string &dir, const std::string &file_name) -> std::s
     return path;
 }
 
+auto GetGenerationPath(const std::string &file_path, uint32_t generation) -> std::string {
+    return generation == 0 ? file_path : file_path + ".bak." + std::to_string(generation);
+}
+
 void CopyToClipboard(const std::string &str) { clip::set_text(str); }
+
+void StoreLE16(unsigned char *buf, uint16_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        buf[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void StoreLE32(unsigned char *buf, uint32_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        buf[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void StoreLE64(unsigned char *buf, uint64_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        buf[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+auto LoadLE16(const unsigned char *buf) -> uint16_t {
+    uint16_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value |= static_cast<uint16_t>(buf[i]) << (8 * i);
+    }
+    return value;
+}
+
+auto LoadLE32(const unsigned char *buf) -> uint32_t {
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value |= static_cast<uint32_t>(buf[i]) << (8 * i);
+    }
+    return value;
+}
+
+auto LoadLE64(const unsigned char *buf) -> uint64_t {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value |= static_cast<uint64_t>(buf[i]) << (8 * i);
+    }
+    return value;
+}
@@ -0,0 +1,89 @@
+#include "argon2id.hpp"
+
+#include <array>
+#include <gtest/gtest.h>
+#include <sodium.h>
+#include <vector>
+
+class Argon2idTest : public ::testing::Test {
+  protected:
+    void SetUp() override { ASSERT_GE(sodium_init(), 0); }
+
+    static auto Bytes(size_t len, unsigned char value) -> std::vector<unsigned char> {
+        return std::vector<unsigned char>(len, value);
+    }
+};
+
+// Hash
+TEST_F(Argon2idTest, Hash_Rfc9106Vector_MatchesTag) {
+    const std::array<unsigned char, 32> expected = {0x0d, 0x64, 0x0d, 0xf5, 0x8d, 0x78, 0x76, 0x6c, 0x08, 0xc0, 0x37,
+                                                    0xa3, 0x4a, 0x8b, 0x53, 0xc9, 0xd0, 0x1e, 0xf0, 0x45, 0x2d, 0x75,
+                                                    0xb6, 0x5e, 0xb5, 0x25, 0x20, 0xe9, 0x6b, 0x01, 0xe6, 0x59};
+    std::vector<unsigned char> password = Bytes(32, 0x01);
+    std::vector<unsigned char> salt = Bytes(16, 0x02);
+    std::vector<unsigned char> secret = Bytes(8, 0x03);
+    std::vector<unsigned char> ad = Bytes(12, 0x04);
+
+    for (size_t threads : {1, 4}) {
+        Argon2id argon2id(threads);
+        std::array<unsigned char, 32> tag = {};
+        ASSERT_EQ(argon2id.Hash(tag, password, salt, 3, 32, 4, secret, ad), 0);
+        EXPECT_EQ(tag, expected) << threads << " threads";
+    }
+}
+
+TEST_F(Argon2idTest, Hash_OneLane_MatchesLibsodium) {
+    const char password[] = "correct horse";
+    std::array<unsigned char, crypto_pwhash_SALTBYTES> salt = {};
+    randombytes_buf(salt.data(), salt.size());
+    std::array<unsigned char, 32> expected = {};
+    ASSERT_EQ(crypto_pwhash(expected.data(), expected.size(), password, sizeof(password) - 1, salt.data(), 2, 1 << 20,
+                            crypto_pwhash_ALG_ARGON2ID13),
+              0);
+
+    Argon2id argon2id(2);
+    std::array<unsigned char, 32> key = {};
+    ASSERT_EQ(argon2id.Hash(key, {reinterpret_cast<const unsigned char *>(password), sizeof(password) - 1}, salt, 2,
+                            1024, 1),
+              0);
+    EXPECT_EQ(key, expected);
+}
+
+TEST_F(Argon2idTest, Hash_LaneCount_ChangesOutput) {
+    std::vector<unsigned char> password = Bytes(8, 'p');
+    std::vector<unsigned char> salt = Bytes(16, 's');
+    Argon2id argon2id(4);
+    std::array<unsigned char, 32> one_lane = {};
+    std::array<unsigned char, 32> four_lanes = {};
+    ASSERT_EQ(argon2id.Hash(one_lane, password, salt, 1, 256, 1), 0);
+    ASSERT_EQ(argon2id.Hash(four_lanes, password, salt, 1, 256, 4), 0);
+    EXPECT_NE(one_lane, four_lanes);
+}
+
+TEST_F(Argon2idTest, Hash_ReusedMemory_MatchesFreshAllocation) {
+    std::vector<unsigned char> password = Bytes(8, 'p');
+    std::vector<unsigned char> salt = Bytes(16, 's');
+    Argon2id fresh(2);
+    Argon2id reused(2, true);
+    std::array<unsigned char, 32> expected = {};
+    ASSERT_EQ(fresh.Hash(expected, password, salt, 2, 512, 2), 0);
+
+    for (uint32_t m_cost : {512, 256, 512}) {
+        std::array<unsigned char, 32> key = {};
+        ASSERT_EQ(reused.Hash(key, password, salt, 2, m_cost, 2), 0);
+        EXPECT_EQ(key == expected, m_cost == 512) << m_cost;
+    }
+}
+
+TEST_F(Argon2idTest, Hash_InvalidParameters_ReturnsNegative1) {
+    std::vector<unsigned char> password = Bytes(8, 'p');
+    std::vector<unsigned char> salt = Bytes(16, 's');
+    Argon2id argon2id(1);
+    std::array<unsigned char, 32> key = {};
+    std::array<unsigned char, 8> short_key = {};
+    EXPECT_EQ(argon2id.Hash(key, password, salt, 0, 256, 1), -1);
+    EXPECT_EQ(argon2id.Hash(key, password, salt, 1, 256, 0), -1);
+    EXPECT_EQ(argon2id.Hash(key, password, salt, 1, 31, 4), -1); // fewer than 8 blocks per lane
+    EXPECT_EQ(argon2id.Hash(key, password, Bytes(4, 's'), 1, 256, 1), -1);
+    EXPECT_EQ(argon2id.Hash(short_key, password, salt, 1, 256, 1), -1);
+}
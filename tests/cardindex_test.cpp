@@ -0,0 +1,103 @@
+#include "cardindex.hpp"
+
+#include <gtest/gtest.h>
+
+class CardIndexTest : public ::testing::Test {
+  protected:
+    CardIndex index_;
+
+    static auto MakeEntry(uint32_t id, const std::string &name, unsigned char fingerprint_byte, uint16_t expiry = 0)
+        -> RecordDirectory::Entry {
+        RecordDirectory::Entry entry = {.id = id, .location = {}, .name = name, .metadata = {}};
+        entry.metadata.fingerprint.fill(fingerprint_byte);
+        entry.metadata.expiry = expiry;
+        return entry;
+    }
+};
+
+TEST_F(CardIndexTest, FindByName_IgnoresCase) {
+    index_.Insert(MakeEntry(0, "Work Visa", 1));
+    index_.Insert(MakeEntry(1, "work visa", 2));
+    index_.Insert(MakeEntry(2, "Travel", 3));
+
+    EXPECT_EQ(index_.FindByName("WORK VISA"), (std::vector<uint32_t>{0, 1}));
+    EXPECT_TRUE(index_.FindByName("Work").empty());
+}
+
+TEST_F(CardIndexTest, FindByNamePrefix_ReturnsMatchesInNameOrder) {
+    index_.Insert(MakeEntry(0, "Work Visa", 1));
+    index_.Insert(MakeEntry(1, "Travel", 2));
+    index_.Insert(MakeEntry(2, "Work Amex", 3));
+    index_.Insert(MakeEntry(3, "Wor", 4));
+
+    EXPECT_EQ(index_.FindByNamePrefix("work "), (std::vector<uint32_t>{2, 0}));
+    EXPECT_EQ(index_.FindByNamePrefix("").size(), 4);
+    EXPECT_TRUE(index_.FindByNamePrefix("x").empty());
+}
+
+TEST_F(CardIndexTest, FindByFingerprint_SkipsEmptyFingerprint) {
+    index_.Insert(MakeEntry(0, "Card1", 7));
+    index_.Insert(MakeEntry(1, "Card2", 7));
+    index_.Insert(MakeEntry(2, "Card3", 0));
+
+    RecordDirectory::Fingerprint fingerprint{};
+    EXPECT_TRUE(index_.FindByFingerprint(fingerprint).empty());
+    EXPECT_FALSE(index_.ContainsFingerprint(fingerprint));
+    fingerprint.fill(7);
+    EXPECT_EQ(index_.FindByFingerprint(fingerprint), (std::vector<uint32_t>{0, 1}));
+    EXPECT_TRUE(index_.ContainsFingerprint(fingerprint));
+}
+
+TEST_F(CardIndexTest, FindByExpiry_ReturnsInclusiveRangeInExpiryOrder) {
+    index_.Insert(MakeEntry(0, "Card1", 1, 300));
+    index_.Insert(MakeEntry(1, "Card2", 2, 100));
+    index_.Insert(MakeEntry(2, "Card3", 3, 200));
+    index_.Insert(MakeEntry(3, "Card4", 4, 100));
+    index_.Insert(MakeEntry(4, "Card5", 5, 0));
+
+    EXPECT_EQ(index_.FindByExpiry(100, 200), (std::vector<uint32_t>{1, 3, 2}));
+    EXPECT_EQ(index_.FindByExpiry(0, 99), (std::vector<uint32_t>{}));
+    EXPECT_EQ(index_.FindByExpiry(201, UINT16_MAX), (std::vector<uint32_t>{0}));
+    EXPECT_EQ(index_.ExpiryOrder(), (std::vector<uint32_t>{1, 3, 2, 0}));
+}
+
+TEST_F(CardIndexTest, Filter_CombinesTagAndNetworkBitmaps) {
+    auto tagged = [](uint32_t id, CreditCard::CardNetwork network, const std::vector<std::string> &tags) {
+        RecordDirectory::Entry entry = MakeEntry(id, "Card", static_cast<unsigned char>(id + 1));
+        entry.metadata.network = network;
+        entry.metadata.tags = tags;
+        return entry;
+    };
+    index_.Insert(tagged(0, CreditCard::CARD_VISA, {"team1", "travel"}));
+    index_.Insert(tagged(1, CreditCard::CARD_AMEX, {"team1"}));
+    index_.Insert(tagged(2, CreditCard::CARD_VISA, {"team2", "travel"}));
+    index_.Insert(tagged(3, CreditCard::CARD_VISA, {}));
+
+    EXPECT_EQ(index_.Filter({}), (std::vector<uint32_t>{0, 1, 2, 3}));
+    EXPECT_EQ(index_.Filter({.all_tags = {"TEAM1", "travel"}, .any_tags = {}, .none_tags = {}, .networks = {}}),
+              (std::vector<uint32_t>{0}));
+    EXPECT_EQ(
+        index_.Filter({.all_tags = {}, .any_tags = {"team1", "team2"}, .none_tags = {"travel"}, .networks = {}}),
+        (std::vector<uint32_t>{1}));
+    EXPECT_EQ(index_.Filter(
+                  {.all_tags = {}, .any_tags = {}, .none_tags = {"travel"}, .networks = {CreditCard::CARD_VISA}}),
+              (std::vector<uint32_t>{3}));
+    EXPECT_TRUE(index_.Filter({.all_tags = {"unknown"}, .any_tags = {}, .none_tags = {}, .networks = {}}).empty());
+
+    index_.Remove(tagged(0, CreditCard::CARD_VISA, {"team1", "travel"}));
+    EXPECT_EQ(index_.Filter({.all_tags = {"team1"}, .any_tags = {}, .none_tags = {}, .networks = {}}),
+              (std::vector<uint32_t>{1}));
+}
+
+TEST_F(CardIndexTest, Remove_DropsEntryFromEveryIndex) {
+    RecordDirectory::Entry entry = MakeEntry(0, "Card1", 7, 100);
+    index_.Insert(entry);
+    index_.Insert(MakeEntry(1, "Card1", 8));
+    index_.Remove(entry);
+
+    EXPECT_EQ(index_.FindByName("card1"), (std::vector<uint32_t>{1}));
+    EXPECT_EQ(index_.FindByNamePrefix("card"), (std::vector<uint32_t>{1}));
+    EXPECT_TRUE(index_.FindByFingerprint(entry.metadata.fingerprint).empty());
+    EXPECT_FALSE(index_.ContainsFingerprint(entry.metadata.fingerprint));
+    EXPECT_TRUE(index_.ExpiryOrder().empty());
+}
@@ -0,0 +1,52 @@
+#include "cardorders.hpp"
+
+#include <gtest/gtest.h>
+
+class CardOrdersTest : public ::testing::Test {
+  protected:
+    CardOrders orders_;
+
+    static auto MakeEntry(uint32_t id, const std::string &name, uint8_t network, uint16_t expiry, uint64_t last_used)
+        -> RecordDirectory::Entry {
+        RecordDirectory::Entry entry = {.id = id, .location = {}, .name = name, .metadata = {}};
+        entry.metadata.network = network;
+        entry.metadata.expiry = expiry;
+        entry.metadata.last_used = last_used;
+        return entry;
+    }
+
+    void InsertCards() {
+        orders_.Insert(MakeEntry(0, "travel", 1, 300, 0));
+        orders_.Insert(MakeEntry(1, "Bills", 2, 0, 5));
+        orders_.Insert(MakeEntry(2, "groceries", 1, 100, 9));
+        orders_.Insert(MakeEntry(3, "Amex", 3, 200, 0));
+    }
+};
+
+TEST_F(CardOrdersTest, Ids_EachOrderSorted) {
+    InsertCards();
+
+    EXPECT_EQ(orders_.Ids(CardOrders::ORDER_CREATED), (std::vector<uint32_t>{0, 1, 2, 3}));
+    EXPECT_EQ(orders_.Ids(CardOrders::ORDER_NAME), (std::vector<uint32_t>{3, 1, 2, 0}));
+    EXPECT_EQ(orders_.Ids(CardOrders::ORDER_NETWORK), (std::vector<uint32_t>{2, 0, 1, 3}));
+    EXPECT_EQ(orders_.Ids(CardOrders::ORDER_EXPIRY), (std::vector<uint32_t>{2, 3, 0, 1}));
+    EXPECT_EQ(orders_.Ids(CardOrders::ORDER_LAST_USED), (std::vector<uint32_t>{2, 1, 3, 0}));
+}
+
+TEST_F(CardOrdersTest, Remove_DropsIdFromEveryOrder) {
+    InsertCards();
+    orders_.Remove(MakeEntry(2, "groceries", 1, 100, 9));
+
+    for (int order = 0; order < CardOrders::ORDER_COUNT; ++order) {
+        const std::vector<uint32_t> &ids = orders_.Ids(static_cast<CardOrders::Order>(order));
+        EXPECT_EQ(ids.size(), 3);
+        EXPECT_EQ(std::find(ids.begin(), ids.end(), 2), ids.end());
+    }
+}
+
+TEST_F(CardOrdersTest, Clear_EmptiesEveryOrder) {
+    InsertCards();
+    orders_.Clear();
+    EXPECT_TRUE(orders_.Ids(CardOrders::ORDER_NAME).empty());
+    EXPECT_TRUE(orders_.Ids(CardOrders::ORDER_LAST_USED).empty());
+}
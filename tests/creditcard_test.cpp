@@ -100,6 +100,22 @@ TEST_F(CreditCardTest, SetYear_InvalidYear_ReturnsNegative1) {
     EXPECT_EQ(card.SetYear("1899"), -1);
 }
 
+// SetTags
+TEST_F(CreditCardTest, SetTags_ValidTags_StoresLowerCasedSortedUnique) {
+    CreditCard card;
+    EXPECT_EQ(card.SetTags({"Travel", "team1", "TRAVEL"}), 0);
+    EXPECT_EQ(card.GetTags(), (std::vector<std::string>{"team1", "travel"}));
+}
+
+TEST_F(CreditCardTest, SetTags_InvalidTag_ReturnsNegative1) {
+    CreditCard card;
+    card.SetTags({"travel"});
+    EXPECT_EQ(card.SetTags({"cost center"}), -1);
+    EXPECT_EQ(card.SetTags({""}), -1);
+    EXPECT_EQ(card.SetTags({std::string(CreditCard::MAX_TAG_LEN + 1, 'a')}), -1);
+    EXPECT_EQ(card.GetTags(), (std::vector<std::string>{"travel"}));
+}
+
 // GetName
 TEST_F(CreditCardTest, GetName_NameSet_ReturnsSetName) {
     CreditCard card;
@@ -127,6 +143,21 @@ TEST_F(CreditCardTest, GetName_NameResetToEmpty_ReturnsDefault) {
     EXPECT_EQ(card.GetName(), "Visa 1111");
 }
 
+// GetExpiryKey
+TEST_F(CreditCardTest, GetExpiryKey_MonthAndYearSet_ReturnsPackedKey) {
+    CreditCard card;
+    card.SetMonth("12");
+    card.SetYear("2025");
+    EXPECT_EQ(card.GetExpiryKey(), 2025 * 12 + 12);
+    EXPECT_EQ(card.GetExpiryKey() + 1, CreditCard::PackExpiry(1, 2026));
+}
+
+TEST_F(CreditCardTest, GetExpiryKey_YearEmpty_Returns0) {
+    CreditCard card;
+    card.SetMonth("12");
+    EXPECT_EQ(card.GetExpiryKey(), 0);
+}
+
 // FormatText
 TEST_F(CreditCardTest, FormatText_AllFieldsFilled_ReturnsFormattedString) {
     CreditCard card;
@@ -147,6 +178,17 @@ TEST_F(CreditCardTest, FormatText_NameEmpty_ReturnsFormattedWithoutName) {
     EXPECT_EQ(card.FormatText(), ",4111111111111111,123,12,2025;");
 }
 
+TEST_F(CreditCardTest, FormatText_WithTags_AppendsTagsField) {
+    CreditCard card;
+    card.SetName("BCE");
+    card.SetCardNumber("4111111111111111");
+    card.SetCvv("123");
+    card.SetMonth("12");
+    card.SetYear("2025");
+    card.SetTags({"team1", "travel"});
+    EXPECT_EQ(card.FormatText(), "BCE,4111111111111111,123,12,2025,team1 travel;");
+}
+
 // InitFromText
 TEST_F(CreditCardTest, InitFromText_WithName_ReturnsFormattedTextWithName) {
     CreditCard card;
@@ -162,6 +204,14 @@ TEST_F(CreditCardTest, InitFromText_WithoutName_ReturnsFormattedTextWithoutName)
     EXPECT_EQ(card.FormatText(), ",371046275845869,1234,12,2025;");
 }
 
+TEST_F(CreditCardTest, InitFromText_WithTags_RestoresTags) {
+    CreditCard card;
+    char text[] = "CSR,4111111111111111,123,12,2025,team1 travel";
+    card.InitFromText(text);
+    EXPECT_EQ(card.GetTags(), (std::vector<std::string>{"team1", "travel"}));
+    EXPECT_EQ(card.GetNetwork(), CreditCard::CARD_VISA);
+}
+
 // GetNetworkString
 TEST_F(CreditCardTest, GetNetworkString_VisaCard_ReturnsVisa) {
     CreditCard card;
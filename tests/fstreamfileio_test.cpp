@@ -1,7 +1,9 @@
 #include "fstreamfileio.hpp"
 
+#include <array>
 #include <chrono>
 #include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <thread>
 
@@ -40,6 +42,11 @@ class FStreamFileIOTest : public ::testing::Test {
 
     auto TestDeleteFile(FStreamFileIO &file_io, const std::string &path) -> bool { return file_io.DeleteFile(path); }
 
+    static auto ReadWholeFile(const std::string &path) -> std::string {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
     void ExpectCommitTempNoMain(FStreamFileIO &file_io) {
         EXPECT_EQ(file_io.OpenWriteTemp(), 0);
         file_io.WriteTemp(init_write_.c_str(), init_write_.size());
@@ -122,14 +129,14 @@ TEST_F(FStreamFileIOTest, OpenRead_ExistingFile_Returns0) {
     ExpectCommitTempNoMain(file_io);
 
     EXPECT_TRUE(file_io.GetExists(false));
-    EXPECT_EQ(file_io.OpenRead(), 0);
+    EXPECT_EQ(file_io.OpenRead(0), 0);
     file_io.CloseRead();
 }
 
 TEST_F(FStreamFileIOTest, OpenRead_NonExistentFile_ReturnsNegative1) {
     FStreamFileIO file_io(file_path_);
     EXPECT_FALSE(file_io.GetExists(false));
-    EXPECT_EQ(file_io.OpenRead(), -1);
+    EXPECT_EQ(file_io.OpenRead(0), -1);
 }
 
 // Read & GetPositionRead
@@ -137,7 +144,7 @@ TEST_F(FStreamFileIOTest, Read_ValidStream_ReturnsTrue) {
     FStreamFileIO file_io(file_path_);
     ExpectCommitTempNoMain(file_io);
 
-    EXPECT_EQ(file_io.OpenRead(), 0);
+    EXPECT_EQ(file_io.OpenRead(0), 0);
     char buf[init_write_.size() + 1];
     EXPECT_TRUE(file_io.Read(buf, init_write_.size()));
     EXPECT_EQ(file_io.GetPositionRead(), init_write_.size());
@@ -239,3 +246,142 @@ TEST_F(FStreamFileIOTest, Delete_ExistingFile_ReturnsTrue) {
     EXPECT_TRUE(file_io.Delete(false));
     EXPECT_FALSE(file_io.Delete(true));
 }
+
+// WriteTempV & ReadV
+TEST_F(FStreamFileIOTest, WriteTempV_ReadV_RoundTripsSegments) {
+    FStreamFileIO file_io(file_path_);
+    char head[] = "ab";
+    char tail[] = "cdef";
+    const std::array<iovec, 2> write_segments = {{
+        {.iov_base = head, .iov_len = 2},
+        {.iov_base = tail, .iov_len = 4},
+    }};
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTempV(write_segments));
+    file_io.CloseWriteTemp();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(file_io.GetSize(false), 6);
+
+    char first[4] = {};
+    char second[4] = {};
+    const std::array<iovec, 2> read_segments = {{
+        {.iov_base = first, .iov_len = 3},
+        {.iov_base = second, .iov_len = 3},
+    }};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_TRUE(file_io.ReadV(read_segments));
+    file_io.CloseRead();
+    EXPECT_STREQ(first, "abc");
+    EXPECT_STREQ(second, "def");
+}
+
+TEST_F(FStreamFileIOTest, WriteTempV_NoOpenStream_ReturnsFalse) {
+    FStreamFileIO file_io(file_path_);
+    char buf[] = "test";
+    const std::array<iovec, 1> segments = {{{.iov_base = buf, .iov_len = 4}}};
+    EXPECT_FALSE(file_io.WriteTempV(segments));
+}
+
+TEST_F(FStreamFileIOTest, ReadV_PastEndOfFile_ReturnsFalse) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char buf[init_write_.size() + 1];
+    const std::array<iovec, 1> segments = {{{.iov_base = buf, .iov_len = sizeof(buf)}}};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_FALSE(file_io.ReadV(segments));
+    file_io.CloseRead();
+}
+
+// ReadAt
+TEST_F(FStreamFileIOTest, ReadAt_Offset_LeavesReadPositionUnchanged) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char middle[4] = {};
+    char start[4] = {};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_TRUE(file_io.ReadAt(middle, 3, 1));
+    EXPECT_TRUE(file_io.Read(start, 3));
+    file_io.CloseRead();
+    EXPECT_EQ(std::string(middle), init_write_.substr(1, 3));
+    EXPECT_EQ(std::string(start), init_write_.substr(0, 3));
+}
+
+TEST_F(FStreamFileIOTest, ReadAt_PastEndOfFile_ReturnsFalse) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char buf[4];
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_FALSE(file_io.ReadAt(buf, sizeof(buf), init_write_.size() - 1));
+    file_io.CloseRead();
+}
+
+TEST_F(FStreamFileIOTest, ReadAt_SeveralThreads_EachReadsItsOffset) {
+    std::string contents;
+    for (int i = 0; i < 256; ++i) {
+        contents += static_cast<char>(i);
+    }
+    {
+        std::ofstream out(file_path_, std::ios::binary);
+        out << contents;
+    }
+
+    FStreamFileIO file_io(file_path_);
+    ASSERT_EQ(file_io.OpenRead(0), 0);
+    auto read_all = [&file_io, &contents](uint64_t first) {
+        for (int round = 0; round < 200; ++round) {
+            for (uint64_t offset = first; offset < contents.size(); offset += 2) {
+                char byte = 0;
+                ASSERT_TRUE(file_io.ReadAt(&byte, 1, offset));
+                ASSERT_EQ(byte, contents[offset]) << offset;
+            }
+        }
+    };
+    std::thread odd(read_all, 1);
+    read_all(0);
+    odd.join();
+    file_io.CloseRead();
+}
+
+// CopyToTemp
+TEST_F(FStreamFileIOTest, CopyToTemp_Range_AppendsBytesFromReadFile) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTemp("new", 3));
+    EXPECT_TRUE(file_io.CopyToTemp(1, 2));
+    file_io.CloseWriteTemp();
+    file_io.CloseRead();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(ReadWholeFile(file_path_), "new" + init_write_.substr(1, 2));
+}
+
+TEST_F(FStreamFileIOTest, CopyToTemp_PastEndOfFile_ReturnsFalse) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_FALSE(file_io.CopyToTemp(init_write_.size() - 1, 2));
+    file_io.CloseWriteTemp();
+    file_io.CloseRead();
+}
+
+// SeekWriteTemp
+TEST_F(FStreamFileIOTest, SeekWriteTemp_SkippedRange_IsFilledInLater) {
+    FStreamFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.SeekWriteTemp(3));
+    EXPECT_TRUE(file_io.WriteTemp("body", 4));
+    EXPECT_TRUE(file_io.SeekWriteTemp(0));
+    EXPECT_TRUE(file_io.WriteTemp("new", 3));
+    file_io.CloseWriteTemp();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(ReadWholeFile(file_path_), "newbody");
+}
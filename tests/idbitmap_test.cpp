@@ -0,0 +1,90 @@
+#include "idbitmap.hpp"
+
+#include <gtest/gtest.h>
+
+class IdBitmapTest : public ::testing::Test {
+  protected:
+    static auto MakeBitmap(const std::vector<uint32_t> &ids) -> IdBitmap {
+        IdBitmap bitmap;
+        for (uint32_t id : ids) {
+            bitmap.Add(id);
+        }
+        return bitmap;
+    }
+
+    // Dense enough that the container for the first 65536 ids is a bitset
+    static auto MakeEvenIds(uint32_t count) -> std::vector<uint32_t> {
+        std::vector<uint32_t> ids;
+        for (uint32_t i = 0; i < count; ++i) {
+            ids.push_back(i * 2);
+        }
+        return ids;
+    }
+};
+
+// Add & Remove
+TEST_F(IdBitmapTest, Add_KeepsIdsSortedAcrossContainers) {
+    IdBitmap bitmap = MakeBitmap({70000, 5, 3, 5, 1U << 31});
+
+    EXPECT_EQ(bitmap.ToVector(), (std::vector<uint32_t>{3, 5, 70000, 1U << 31}));
+    EXPECT_EQ(bitmap.Cardinality(), 4);
+    EXPECT_TRUE(bitmap.Contains(70000));
+    EXPECT_FALSE(bitmap.Contains(4));
+}
+
+TEST_F(IdBitmapTest, Remove_LastIdEmptiesBitmap) {
+    IdBitmap bitmap = MakeBitmap({1, 70000});
+    bitmap.Remove(1);
+    bitmap.Remove(2);
+    EXPECT_EQ(bitmap.ToVector(), (std::vector<uint32_t>{70000}));
+    bitmap.Remove(70000);
+    EXPECT_TRUE(bitmap.Empty());
+}
+
+TEST_F(IdBitmapTest, Add_DenseContainer_RoundTripsThroughBitset) {
+    std::vector<uint32_t> ids = MakeEvenIds(5000);
+    IdBitmap bitmap = MakeBitmap(ids);
+    EXPECT_EQ(bitmap.ToVector(), ids);
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        bitmap.Remove(i * 2);
+    }
+    EXPECT_EQ(bitmap.Cardinality(), 4000);
+    EXPECT_FALSE(bitmap.Contains(0));
+    EXPECT_TRUE(bitmap.Contains(2000));
+}
+
+// And & Or & AndNot
+TEST_F(IdBitmapTest, SetOperations_SparseContainers) {
+    IdBitmap a = MakeBitmap({1, 2, 3, 70000});
+    IdBitmap b = MakeBitmap({2, 3, 4, 140000});
+
+    EXPECT_EQ(a.And(b).ToVector(), (std::vector<uint32_t>{2, 3}));
+    EXPECT_EQ(a.Or(b).ToVector(), (std::vector<uint32_t>{1, 2, 3, 4, 70000, 140000}));
+    EXPECT_EQ(a.AndNot(b).ToVector(), (std::vector<uint32_t>{1, 70000}));
+    EXPECT_TRUE(a.And(IdBitmap()).Empty());
+}
+
+TEST_F(IdBitmapTest, SetOperations_DenseAndSparseContainers) {
+    IdBitmap dense = MakeBitmap(MakeEvenIds(5000));
+    IdBitmap sparse = MakeBitmap({0, 1, 2, 3, 20000});
+
+    EXPECT_EQ(dense.And(sparse).ToVector(), (std::vector<uint32_t>{0, 2}));
+    EXPECT_EQ(sparse.And(dense).ToVector(), (std::vector<uint32_t>{0, 2}));
+    EXPECT_EQ(dense.Or(sparse).Cardinality(), 5003);
+    EXPECT_EQ(sparse.AndNot(dense).ToVector(), (std::vector<uint32_t>{1, 3, 20000}));
+    EXPECT_EQ(dense.AndNot(sparse).Cardinality(), 4998);
+}
+
+TEST_F(IdBitmapTest, SetOperations_DenseContainers) {
+    std::vector<uint32_t> odd_ids;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        odd_ids.push_back(i * 2 + 1);
+    }
+    IdBitmap even = MakeBitmap(MakeEvenIds(5000));
+    IdBitmap odd = MakeBitmap(odd_ids);
+
+    EXPECT_TRUE(even.And(odd).Empty());
+    EXPECT_EQ(even.Or(odd).Cardinality(), 10000);
+    EXPECT_EQ(even.Or(odd).AndNot(odd).ToVector(), MakeEvenIds(5000));
+}
@@ -0,0 +1,39 @@
+#include "kdfarena.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+// Acquire
+TEST(KdfArenaTest, Acquire_SmallerLen_ReusesMapping) {
+    KdfArena arena;
+    void *first = arena.Acquire(3 << 20);
+    ASSERT_NE(first, nullptr);
+    EXPECT_GE(arena.Capacity(), 3U << 20);
+    arena.Release();
+
+    EXPECT_EQ(arena.Acquire(1 << 20), first);
+    arena.Release();
+}
+
+TEST(KdfArenaTest, Acquire_LargerLen_GrowsCapacity) {
+    KdfArena arena;
+    ASSERT_NE(arena.Acquire(1 << 20), nullptr);
+    arena.Release();
+
+    ASSERT_NE(arena.Acquire(5 << 20), nullptr);
+    EXPECT_GE(arena.Capacity(), 5U << 20);
+    arena.Release();
+}
+
+// Release
+TEST(KdfArenaTest, Release_WipesUsedBytes) {
+    KdfArena arena;
+    auto *bytes = static_cast<unsigned char *>(arena.Acquire(4096));
+    ASSERT_NE(bytes, nullptr);
+    memset(bytes, 0xab, 4096);
+    arena.Release();
+
+    for (size_t i = 0; i < 4096; ++i) {
+        ASSERT_EQ(bytes[i], 0) << i;
+    }
+}
@@ -0,0 +1,56 @@
+#include "keyringkeycache.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+class KeyringKeyCacheTest : public ::testing::Test {
+  protected:
+    KeyringKeyCache cache_;
+    std::string name_;
+
+    // Keys outlive the process, so each run gets its own name
+    void SetUp() override {
+        name_ = "walletcache-test:" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()) +
+                ":" + std::to_string(getpid());
+    }
+
+    void TearDown() override { cache_.Remove(name_); }
+};
+
+TEST_F(KeyringKeyCacheTest, PutThenGet_ReturnsData) {
+    const unsigned char data[] = {1, 2, 3, 4, 5};
+    if (cache_.Put(name_, data, sizeof(data), 60) != 0) {
+        GTEST_SKIP() << "kernel keyring unavailable";
+    }
+
+    unsigned char read[16] = {};
+    ASSERT_EQ(cache_.Get(name_, read, sizeof(read)), sizeof(data));
+    EXPECT_EQ(memcmp(read, data, sizeof(data)), 0);
+
+    const unsigned char replaced[] = {9, 8, 7};
+    ASSERT_EQ(cache_.Put(name_, replaced, sizeof(replaced), 60), 0);
+    ASSERT_EQ(cache_.Get(name_, read, sizeof(read)), sizeof(replaced));
+    EXPECT_EQ(memcmp(read, replaced, sizeof(replaced)), 0);
+}
+
+TEST_F(KeyringKeyCacheTest, Get_BufferTooSmall_ReturnsNegative1) {
+    const unsigned char data[] = {1, 2, 3, 4, 5};
+    if (cache_.Put(name_, data, sizeof(data), 60) != 0) {
+        GTEST_SKIP() << "kernel keyring unavailable";
+    }
+
+    unsigned char read[4] = {};
+    EXPECT_EQ(cache_.Get(name_, read, sizeof(read)), -1);
+}
+
+TEST_F(KeyringKeyCacheTest, Remove_GetReturnsNegative1) {
+    const unsigned char data[] = {1, 2, 3};
+    if (cache_.Put(name_, data, sizeof(data), 60) != 0) {
+        GTEST_SKIP() << "kernel keyring unavailable";
+    }
+
+    cache_.Remove(name_);
+    unsigned char read[16] = {};
+    EXPECT_EQ(cache_.Get(name_, read, sizeof(read)), -1);
+}
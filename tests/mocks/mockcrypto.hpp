@@ -8,23 +8,52 @@
 class MockCrypto : public ICrypto {
   public:
     MOCK_METHOD(int, InitCrypto, (), (override));
+    MOCK_METHOD(uint8_t, GetCipherSuite, (), (const, override));
+    MOCK_METHOD(int, SetCipherSuite, (uint8_t), (override));
     MOCK_METHOD(uint64_t, EncryptionAddedBytes, (), (const, override));
     MOCK_METHOD(uint64_t, EncryptionHeaderLen, (), (const, override));
+    MOCK_METHOD(uint64_t, EncryptionInPlaceOffset, (), (const, override));
     MOCK_METHOD(uint64_t, EncryptionKeyLen, (), (const, override));
+    MOCK_METHOD(uint64_t, RecordAddedBytes, (), (const, override));
     MOCK_METHOD(uint64_t, HashLen, (), (const, override));
     MOCK_METHOD(uint64_t, SaltLen, (), (const, override));
     MOCK_METHOD(int, DeriveEncryptionKey, (unsigned char *, size_t, const unsigned char *, const unsigned char *),
                 (override));
+    MOCK_METHOD(int, DeriveEncryptionKeyWithLimits,
+                (unsigned char *, size_t, const unsigned char *, const unsigned char *, uint64_t, uint64_t),
+                (override));
+    MOCK_METHOD(uint64_t, KdfOpsLimit, (), (const, override));
+    MOCK_METHOD(uint64_t, KdfMemLimit, (), (const, override));
+    MOCK_METHOD(uint32_t, KdfLanes, (), (const, override));
+    MOCK_METHOD(int, SetKdfLanes, (uint32_t), (override));
     MOCK_METHOD(int, EncryptBuf,
                 (unsigned char *, unsigned char *, const unsigned char *, uintmax_t, const unsigned char *),
                 (override));
+    MOCK_METHOD(int, EncryptBufInPlace, (unsigned char *, unsigned char *, uintmax_t, const unsigned char *),
+                (override));
+    MOCK_METHOD(int, DecryptBufInPlace, (unsigned char *, uint64_t *, unsigned char *, uintmax_t, const unsigned char *),
+                (override));
+    MOCK_METHOD(int, EncryptRecord,
+                (unsigned char *, const unsigned char *, uintmax_t, const unsigned char *, uint64_t,
+                 const unsigned char *),
+                (override));
+    MOCK_METHOD(int, DecryptRecord,
+                (unsigned char *, uint64_t *, const unsigned char *, uintmax_t, const unsigned char *, uint64_t,
+                 const unsigned char *),
+                (override));
+    MOCK_METHOD(int, DeriveSubkey, (unsigned char *, uint64_t, const unsigned char *), (override));
+    MOCK_METHOD(int, KeyedHash, (unsigned char *, size_t, const unsigned char *, uint64_t, const unsigned char *),
+                (override));
     MOCK_METHOD(int, HashPassword, (unsigned char *, const unsigned char *), (override));
     MOCK_METHOD(void, GenerateSalt, (unsigned char *), (override));
+    MOCK_METHOD(void, GenerateKey, (unsigned char *), (override));
     MOCK_METHOD(int, DecryptBuf,
                 (unsigned char *, uint64_t *, unsigned char *, unsigned char *, uintmax_t, const unsigned char *),
                 (override));
     MOCK_METHOD(int, VerifyPasswordHash, (const unsigned char *, const unsigned char *), (override));
     MOCK_METHOD(void, Memzero, (void *, size_t), (override));
+    MOCK_METHOD(void *, SecureAlloc, (size_t), (override));
+    MOCK_METHOD(void, SecureFree, (void *), (override));
 };
 
 #endif // MOCKCRYPTO_HPP
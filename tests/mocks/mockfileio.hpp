@@ -11,9 +11,14 @@ class MockFileIO : public IFileIO {
 
     MOCK_METHOD(bool, Read, (char *buf, int64_t stream_size), (override));
     MOCK_METHOD(bool, WriteTemp, (const char *buf, int64_t stream_size), (override));
+    MOCK_METHOD(bool, ReadV, (std::span<const iovec> segments), (override));
+    MOCK_METHOD(bool, WriteTempV, (std::span<const iovec> segments), (override));
+    MOCK_METHOD(bool, ReadAt, (char *buf, int64_t len, uint64_t offset), (override));
+    MOCK_METHOD(bool, CopyToTemp, (uint64_t offset, uint64_t len), (override));
+    MOCK_METHOD(bool, SeekWriteTemp, (uint64_t offset), (override));
     MOCK_METHOD(int, CommitTemp, (), (override));
 
-    MOCK_METHOD(int, OpenRead, (), (override));
+    MOCK_METHOD(int, OpenRead, (uint32_t generation), (override));
     MOCK_METHOD(int, OpenWriteTemp, (), (override));
 
     MOCK_METHOD(void, CloseRead, (), (override));
@@ -23,6 +28,7 @@ class MockFileIO : public IFileIO {
     MOCK_METHOD(int64_t, GetPositionWriteTemp, (), (override));
 
     MOCK_METHOD(uintmax_t, GetSize, (bool temp), (override));
+    MOCK_METHOD(uintmax_t, GetSizeRead, (), (override));
     MOCK_METHOD(bool, GetExists, (bool temp), (override));
     MOCK_METHOD(bool, Delete, (bool temp), (override));
 };
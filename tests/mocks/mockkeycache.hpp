@@ -0,0 +1,18 @@
+#ifndef MOCKKEYCACHE_HPP
+#define MOCKKEYCACHE_HPP
+
+#include "ikeycache.hpp"
+
+#include <gmock/gmock.h>
+
+class MockKeyCache : public IKeyCache {
+  public:
+    ~MockKeyCache() override = default;
+
+    MOCK_METHOD(int, Put, (const std::string &name, const unsigned char *data, size_t len, uint32_t timeout_seconds),
+                (override));
+    MOCK_METHOD(int64_t, Get, (const std::string &name, unsigned char *data, size_t len), (override));
+    MOCK_METHOD(void, Remove, (const std::string &name), (override));
+};
+
+#endif // MOCKKEYCACHE_HPP
@@ -0,0 +1,528 @@
+#include "posixfileio.hpp"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <thread>
+
+class PosixFileIOTest : public ::testing::Test {
+  protected:
+    std::string test_dir_;
+    std::string file_path_;
+    std::string tmp_file_path_;
+    std::string bak_file_path_;
+    std::string init_write_ = "test";
+
+    void SetUp() override {
+        const std::string test_name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        test_dir_ = "posixfileio_test_" + test_name;
+
+        std::filesystem::create_directory(test_dir_);
+        file_path_ = test_dir_ + "/test_file";
+        tmp_file_path_ = file_path_ + ".tmp";
+        bak_file_path_ = file_path_ + ".bak.1";
+    }
+
+    void TearDown() override {
+        int attempts = 3;
+        while (attempts-- > 0) {
+            try {
+                std::filesystem::remove_all(test_dir_);
+                break;
+            } catch (...) {
+                if (attempts == 0) {
+                    throw;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }
+
+    auto TestDeleteFile(PosixFileIO &file_io, const std::string &path) -> bool { return file_io.DeleteFile(path); }
+    auto TestSnapshotStore(PosixFileIO &file_io, const std::string &path) -> int { return file_io.SnapshotStore(path); }
+
+    static auto ReadWholeFile(const std::string &path) -> std::string {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void ExpectCommitTempReplacesMain(PosixFileIO &file_io, const std::string &contents) {
+        EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+        EXPECT_TRUE(file_io.WriteTemp(contents.c_str(), contents.size()));
+        file_io.CloseWriteTemp();
+        EXPECT_EQ(file_io.CommitTemp(), 0);
+        EXPECT_EQ(ReadWholeFile(file_path_), contents);
+        EXPECT_FALSE(file_io.GetExists(true));
+    }
+
+    void ExpectCommitTempNoMain(PosixFileIO &file_io) {
+        EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+        file_io.WriteTemp(init_write_.c_str(), init_write_.size());
+        file_io.CloseWriteTemp();
+
+        // Only temp file should exist
+        EXPECT_FALSE(file_io.GetExists(false));
+        EXPECT_TRUE(file_io.GetExists(true));
+
+        EXPECT_EQ(file_io.CommitTemp(), 0);
+        EXPECT_TRUE(file_io.GetExists(false));
+        EXPECT_FALSE(file_io.GetExists(true));
+    }
+};
+
+// OpenWriteTemp
+TEST_F(PosixFileIOTest, OpenWriteTemp_ValidPath_Returns0) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.CloseWriteTemp();
+}
+
+// WriteTemp
+TEST_F(PosixFileIOTest, WriteTemp_ValidStream_ReturnsTrue) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTemp("test", 4));
+    file_io.CloseWriteTemp();
+}
+
+TEST_F(PosixFileIOTest, WriteTemp_NoOpenStream_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(file_io.WriteTemp("test", 4));
+}
+
+// CommitTemp
+TEST_F(PosixFileIOTest, CommitTemp_NoExistingFile_Returns0) {
+    PosixFileIO file_io(file_path_);
+
+    ExpectCommitTempNoMain(file_io);
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_ExistingFile_Returns0) {
+    PosixFileIO file_io(file_path_);
+
+    ExpectCommitTempNoMain(file_io);
+
+    // recreate temp
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.WriteTemp("new", 3);
+    file_io.CloseWriteTemp();
+    EXPECT_TRUE(file_io.GetExists(false));
+    EXPECT_TRUE(file_io.GetExists(true));
+
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_TRUE(file_io.GetExists(false));
+    EXPECT_FALSE(file_io.GetExists(true));
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_ExistingFile_LeavesOnlyStore) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+    ExpectCommitTempReplacesMain(file_io, "new");
+
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(test_dir_), std::filesystem::directory_iterator()),
+              1);
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_OneGeneration_MovesReplacedStoreToBak) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 1);
+    ExpectCommitTempNoMain(file_io);
+    EXPECT_FALSE(std::filesystem::exists(bak_file_path_));
+
+    ExpectCommitTempReplacesMain(file_io, "new");
+    EXPECT_EQ(ReadWholeFile(bak_file_path_), init_write_);
+
+    ExpectCommitTempReplacesMain(file_io, "newer");
+    EXPECT_EQ(ReadWholeFile(bak_file_path_), "new");
+    EXPECT_FALSE(std::filesystem::exists(tmp_file_path_));
+    EXPECT_FALSE(std::filesystem::exists(file_path_ + ".bak.2"));
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_ThreeGenerations_KeepsNewestBackups) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 3);
+    ExpectCommitTempNoMain(file_io);
+    for (const std::string contents : {"v1", "v2", "v3", "v4"}) {
+        ExpectCommitTempReplacesMain(file_io, contents);
+    }
+
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.1"), "v3");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.2"), "v2");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.3"), "v1");
+    EXPECT_FALSE(std::filesystem::exists(file_path_ + ".bak.4"));
+}
+
+TEST_F(PosixFileIOTest, OpenRead_Generation_ReadsBackup) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 2);
+    ExpectCommitTempNoMain(file_io);
+    ExpectCommitTempReplacesMain(file_io, "new");
+
+    char buf[init_write_.size() + 1] = {};
+    EXPECT_EQ(file_io.OpenRead(1), 0);
+    EXPECT_EQ(file_io.GetSizeRead(), init_write_.size());
+    EXPECT_TRUE(file_io.Read(buf, init_write_.size()));
+    file_io.CloseRead();
+    EXPECT_STREQ(buf, init_write_.c_str());
+
+    EXPECT_EQ(file_io.OpenRead(2), -1);
+}
+
+// SnapshotStore
+TEST_F(PosixFileIOTest, SnapshotStore_ExistingStore_CopiesContents) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(TestSnapshotStore(file_io, bak_file_path_), 0);
+    EXPECT_EQ(ReadWholeFile(bak_file_path_), init_write_);
+
+    // A snapshot must not follow later saves
+    ExpectCommitTempReplacesMain(file_io, "new");
+    EXPECT_EQ(ReadWholeFile(bak_file_path_), init_write_);
+}
+
+TEST_F(PosixFileIOTest, SnapshotStore_NoStore_ReturnsNegative1) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_EQ(TestSnapshotStore(file_io, bak_file_path_), -1);
+    EXPECT_FALSE(std::filesystem::exists(bak_file_path_));
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_StaleTempFile_IsReplaced) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    std::ofstream(tmp_file_path_) << "stale";
+    ExpectCommitTempReplacesMain(file_io, "new");
+}
+
+// A partial temp file left by an interrupted save is scratch, so the backups keep their oldest generation
+TEST_F(PosixFileIOTest, OpenWriteTemp_PartialTempFileWithGenerations_Deleted) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 2);
+    ExpectCommitTempNoMain(file_io);
+    ExpectCommitTempReplacesMain(file_io, "second");
+
+    std::ofstream(tmp_file_path_) << "parti";
+    ExpectCommitTempReplacesMain(file_io, "third");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.1"), "second");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.2"), init_write_);
+    EXPECT_FALSE(std::filesystem::exists(tmp_file_path_));
+}
+
+TEST_F(PosixFileIOTest, OpenWriteTemp_ReplacedStoreLeftOver_KeptAsBackup) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 3);
+    ExpectCommitTempNoMain(file_io);
+
+    // A store an interrupted commit had already replaced
+    std::ofstream(file_path_ + ".old") << "replaced";
+    ExpectCommitTempReplacesMain(file_io, "new");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.1"), init_write_);
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.2"), "replaced");
+    EXPECT_FALSE(std::filesystem::exists(file_path_ + ".old"));
+}
+
+// Backups that cannot be renamed do not fail a commit whose store is already published, and the replaced store is
+// retired by the next one
+TEST_F(PosixFileIOTest, CommitTemp_BackupsBlocked_PublishesAndRetiresLater) {
+    PosixFileIO file_io(file_path_, PosixFileIO::DURABILITY_FULL, 3);
+    ExpectCommitTempNoMain(file_io);
+    for (int generation = 1; generation <= 3; ++generation) {
+        std::string blocker = file_path_ + ".bak." + std::to_string(generation);
+        std::filesystem::create_directory(blocker);
+        std::ofstream(blocker + "/file") << "x";
+    }
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTemp("new", 3));
+    file_io.CloseWriteTemp();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(ReadWholeFile(file_path_), "new");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".old"), init_write_);
+
+    for (int generation = 1; generation <= 3; ++generation) {
+        std::filesystem::remove_all(file_path_ + ".bak." + std::to_string(generation));
+    }
+    ExpectCommitTempReplacesMain(file_io, "newer");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.1"), "new");
+    EXPECT_EQ(ReadWholeFile(file_path_ + ".bak.2"), init_write_);
+    EXPECT_FALSE(std::filesystem::exists(file_path_ + ".old"));
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_TempDeleted_ReturnsNegative1) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.WriteTemp("new", 3);
+    file_io.CloseWriteTemp();
+    EXPECT_TRUE(file_io.Delete(true));
+    EXPECT_EQ(file_io.CommitTemp(), -1);
+    EXPECT_EQ(ReadWholeFile(file_path_), init_write_);
+}
+
+// OpenRead
+TEST_F(PosixFileIOTest, OpenRead_ExistingFile_Returns0) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_TRUE(file_io.GetExists(false));
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    file_io.CloseRead();
+}
+
+TEST_F(PosixFileIOTest, OpenRead_NonExistentFile_ReturnsNegative1) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(file_io.GetExists(false));
+    EXPECT_EQ(file_io.OpenRead(0), -1);
+}
+
+// Read & GetPositionRead
+TEST_F(PosixFileIOTest, Read_ValidStream_ReturnsTrue) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    char buf[init_write_.size() + 1];
+    EXPECT_TRUE(file_io.Read(buf, init_write_.size()));
+    EXPECT_EQ(file_io.GetPositionRead(), init_write_.size());
+    file_io.CloseRead();
+    buf[init_write_.size()] = 0;
+
+    EXPECT_EQ(memcmp(buf, init_write_.c_str(), init_write_.size()), 0);
+}
+
+TEST_F(PosixFileIOTest, Read_InvalidStream_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    char buf[10];
+    EXPECT_FALSE(file_io.Read(buf, 10));
+}
+
+// GetPositionWriteTemp
+TEST_F(PosixFileIOTest, GetPositionWriteTemp_AfterWrite_ReturnsCorrectPosition) {
+    PosixFileIO file_io(file_path_);
+    file_io.OpenWriteTemp();
+    file_io.WriteTemp("test", 4);
+    EXPECT_EQ(file_io.GetPositionWriteTemp(), 4);
+    file_io.CloseWriteTemp();
+}
+
+// GetSize
+TEST_F(PosixFileIOTest, GetSize_ExistingFile_ReturnsCorrectSize) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_EQ(file_io.GetSize(false), 0);
+    EXPECT_EQ(file_io.GetSize(true), 0);
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.WriteTemp(init_write_.c_str(), init_write_.size());
+    file_io.CloseWriteTemp();
+
+    EXPECT_TRUE(file_io.GetExists(true));
+
+    EXPECT_EQ(file_io.GetSize(false), 0);
+    EXPECT_EQ(file_io.GetSize(true), init_write_.size());
+
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_TRUE(file_io.GetExists(false));
+
+    EXPECT_EQ(file_io.GetSize(false), init_write_.size());
+    EXPECT_EQ(file_io.GetSize(true), 0);
+}
+
+// GetExists
+TEST_F(PosixFileIOTest, GetExists_FilePresent_ReturnsTrue) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(file_io.GetExists(false));
+    EXPECT_FALSE(file_io.GetExists(true));
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.WriteTemp(init_write_.c_str(), init_write_.size());
+    file_io.CloseWriteTemp();
+
+    EXPECT_FALSE(file_io.GetExists(false));
+    EXPECT_TRUE(file_io.GetExists(true));
+
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+
+    EXPECT_TRUE(file_io.GetExists(false));
+    EXPECT_FALSE(file_io.GetExists(true));
+}
+
+TEST_F(PosixFileIOTest, GetExists_FileMissing_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(file_io.GetExists(false));
+    EXPECT_FALSE(file_io.GetExists(true));
+}
+
+// DeleteFile
+TEST_F(PosixFileIOTest, DeleteFile_ExistingFile_ReturnsTrue) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+    EXPECT_TRUE(TestDeleteFile(file_io, file_path_));
+}
+
+TEST_F(PosixFileIOTest, DeleteFile_NonExistentFile_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(TestDeleteFile(file_io, file_path_));
+}
+
+// Delete
+TEST_F(PosixFileIOTest, Delete_ExistingFile_ReturnsTrue) {
+    PosixFileIO file_io(file_path_);
+    EXPECT_FALSE(file_io.Delete(false));
+    EXPECT_FALSE(file_io.Delete(true));
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.WriteTemp(init_write_.c_str(), init_write_.size());
+    file_io.CloseWriteTemp();
+    EXPECT_FALSE(file_io.Delete(false));
+    EXPECT_TRUE(file_io.Delete(true));
+
+    ExpectCommitTempNoMain(file_io);
+    EXPECT_TRUE(file_io.Delete(false));
+    EXPECT_FALSE(file_io.Delete(true));
+}
+
+// WriteTempV & ReadV
+TEST_F(PosixFileIOTest, WriteTempV_ReadV_RoundTripsSegments) {
+    PosixFileIO file_io(file_path_);
+    char head[] = "ab";
+    char tail[] = "cdef";
+    const std::array<iovec, 2> write_segments = {{
+        {.iov_base = head, .iov_len = 2},
+        {.iov_base = tail, .iov_len = 4},
+    }};
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTempV(write_segments));
+    file_io.CloseWriteTemp();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(file_io.GetSize(false), 6);
+
+    char first[4] = {};
+    char second[4] = {};
+    const std::array<iovec, 2> read_segments = {{
+        {.iov_base = first, .iov_len = 3},
+        {.iov_base = second, .iov_len = 3},
+    }};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_TRUE(file_io.ReadV(read_segments));
+    file_io.CloseRead();
+    EXPECT_STREQ(first, "abc");
+    EXPECT_STREQ(second, "def");
+}
+
+TEST_F(PosixFileIOTest, WriteTempV_NoOpenStream_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    char buf[] = "test";
+    const std::array<iovec, 1> segments = {{{.iov_base = buf, .iov_len = 4}}};
+    EXPECT_FALSE(file_io.WriteTempV(segments));
+}
+
+TEST_F(PosixFileIOTest, ReadV_PastEndOfFile_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char buf[init_write_.size() + 1];
+    const std::array<iovec, 1> segments = {{{.iov_base = buf, .iov_len = sizeof(buf)}}};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_FALSE(file_io.ReadV(segments));
+    file_io.CloseRead();
+}
+
+// ReadAt
+TEST_F(PosixFileIOTest, ReadAt_Offset_LeavesReadPositionUnchanged) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char middle[4] = {};
+    char start[4] = {};
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_TRUE(file_io.ReadAt(middle, 3, 1));
+    EXPECT_TRUE(file_io.Read(start, 3));
+    file_io.CloseRead();
+    EXPECT_EQ(std::string(middle), init_write_.substr(1, 3));
+    EXPECT_EQ(std::string(start), init_write_.substr(0, 3));
+}
+
+TEST_F(PosixFileIOTest, ReadAt_PastEndOfFile_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    char buf[4];
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_FALSE(file_io.ReadAt(buf, sizeof(buf), init_write_.size() - 1));
+    file_io.CloseRead();
+}
+
+// CopyToTemp
+TEST_F(PosixFileIOTest, CopyToTemp_Range_AppendsBytesFromReadFile) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.WriteTemp("new", 3));
+    EXPECT_TRUE(file_io.CopyToTemp(1, 2));
+    file_io.CloseWriteTemp();
+    file_io.CloseRead();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(ReadWholeFile(file_path_), "new" + init_write_.substr(1, 2));
+}
+
+TEST_F(PosixFileIOTest, CopyToTemp_PastEndOfFile_ReturnsFalse) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenRead(0), 0);
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_FALSE(file_io.CopyToTemp(init_write_.size() - 1, 2));
+    file_io.CloseWriteTemp();
+    file_io.CloseRead();
+}
+
+// SeekWriteTemp
+TEST_F(PosixFileIOTest, SeekWriteTemp_SkippedRange_IsFilledInLater) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    EXPECT_TRUE(file_io.SeekWriteTemp(3));
+    EXPECT_TRUE(file_io.WriteTemp("body", 4));
+    EXPECT_TRUE(file_io.SeekWriteTemp(0));
+    EXPECT_TRUE(file_io.WriteTemp("new", 3));
+    file_io.CloseWriteTemp();
+    EXPECT_EQ(file_io.CommitTemp(), 0);
+    EXPECT_EQ(ReadWholeFile(file_path_), "newbody");
+}
+
+// Durability
+TEST_F(PosixFileIOTest, CommitTemp_EachDurability_Returns0) {
+    for (auto durability :
+         {PosixFileIO::DURABILITY_NONE, PosixFileIO::DURABILITY_DATA, PosixFileIO::DURABILITY_FULL}) {
+        PosixFileIO file_io(file_path_, durability);
+        EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+        EXPECT_TRUE(file_io.WriteTemp(init_write_.c_str(), init_write_.size()));
+        file_io.CloseWriteTemp();
+        EXPECT_EQ(file_io.CommitTemp(), 0);
+        EXPECT_EQ(file_io.GetSize(false), init_write_.size());
+    }
+}
+
+TEST_F(PosixFileIOTest, CommitTemp_AfterFailedWrite_ReturnsNegative1) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    EXPECT_EQ(file_io.OpenWriteTemp(), 0);
+    file_io.CloseWriteTemp();
+    EXPECT_FALSE(file_io.WriteTemp("new", 3)); // no descriptor left to write to
+    EXPECT_EQ(file_io.CommitTemp(), -1);
+
+    EXPECT_EQ(file_io.GetSize(false), init_write_.size()); // previous store untouched
+    EXPECT_FALSE(file_io.GetExists(true));
+}
+
+TEST_F(PosixFileIOTest, OpenWriteTemp_CreatesOwnerOnlyFile) {
+    PosixFileIO file_io(file_path_);
+    ExpectCommitTempNoMain(file_io);
+
+    auto perms = std::filesystem::status(file_path_).permissions();
+    EXPECT_EQ(perms & (std::filesystem::perms::group_all | std::filesystem::perms::others_all),
+              std::filesystem::perms::none);
+}
@@ -0,0 +1,159 @@
+#include "recorddirectory.hpp"
+#include "utils.hpp"
+
+#include <cstring>
+#include <gtest/gtest.h>
+
+class RecordDirectoryTest : public ::testing::Test {
+  protected:
+    RecordDirectory directory_;
+
+    auto SerializeWith(const std::vector<RecordDirectory::Location> &locations) -> std::vector<unsigned char> {
+        std::vector<unsigned char> buf(directory_.SerializedSize());
+        directory_.Serialize(buf.data(), locations);
+        return buf;
+    }
+};
+
+// Add & Remove
+TEST_F(RecordDirectoryTest, Add_AssignsIncreasingIds) {
+    EXPECT_EQ(directory_.Add("Card1"), 0);
+    EXPECT_EQ(directory_.Add("Card2"), 1);
+    EXPECT_EQ(directory_.Size(), 2);
+    EXPECT_EQ(directory_.Find(1)->name, "Card2");
+    EXPECT_EQ(directory_.Find(1)->location.offset, RecordDirectory::NOT_STORED);
+}
+
+TEST_F(RecordDirectoryTest, Remove_IdNotReused) {
+    directory_.Add("Card1");
+    EXPECT_TRUE(directory_.Remove(0));
+    EXPECT_FALSE(directory_.Remove(0));
+    EXPECT_EQ(directory_.Find(0), nullptr);
+    EXPECT_EQ(directory_.Add("Card2"), 1);
+}
+
+TEST_F(RecordDirectoryTest, SetLocation_UnknownId_ReturnsFalse) {
+    directory_.Add("Card1");
+    directory_.Add("Card2");
+    EXPECT_TRUE(directory_.SetLocation(1, {.offset = 16, .length = 40}));
+    EXPECT_FALSE(directory_.SetLocation(2, {.offset = 0, .length = 16}));
+    EXPECT_EQ(directory_.Find(0)->location.offset, RecordDirectory::NOT_STORED);
+    EXPECT_EQ(directory_.Find(1)->location.offset, 16);
+    EXPECT_EQ(directory_.Find(1)->location.length, 40);
+}
+
+// Serialize & Parse
+TEST_F(RecordDirectoryTest, Parse_SerializedDirectory_RoundTrips) {
+    directory_.Add("Card1");
+    directory_.Add("");
+    directory_.Add("Card3");
+    directory_.Remove(1);
+    std::vector<unsigned char> buf = SerializeWith({{0, 40}, {40, 60}});
+
+    RecordDirectory parsed;
+    ASSERT_EQ(parsed.Parse(buf.data(), buf.size(), 100), 0);
+    ASSERT_EQ(parsed.Size(), 2);
+    EXPECT_EQ(parsed.Find(0)->name, "Card1");
+    EXPECT_EQ(parsed.Find(2)->name, "Card3");
+    EXPECT_EQ(parsed.Find(2)->location.offset, 40);
+    EXPECT_EQ(parsed.Find(2)->location.length, 60);
+    EXPECT_EQ(parsed.Add("Card4"), 3);
+}
+
+TEST_F(RecordDirectoryTest, Parse_Metadata_RoundTrips) {
+    RecordDirectory::Metadata metadata{};
+    metadata.fingerprint.fill(0xab);
+    metadata.expiry = 2030 * 12 + 10;
+    metadata.network = 2;
+    metadata.tags = {"team1", "travel"};
+    metadata.last_used = 7;
+    directory_.Add("Card1");
+    directory_.Add("Card2", metadata);
+    std::vector<unsigned char> buf = SerializeWith({{0, 0}, {0, 40}});
+
+    RecordDirectory parsed;
+    ASSERT_EQ(parsed.Parse(buf.data(), buf.size(), 40), 0);
+    EXPECT_EQ(parsed.Version(), RecordDirectory::FORMAT_VERSION);
+    EXPECT_TRUE(parsed.Find(0)->metadata.tags.empty());
+    EXPECT_EQ(parsed.Find(1)->metadata.fingerprint, metadata.fingerprint);
+    EXPECT_EQ(parsed.Find(1)->metadata.expiry, metadata.expiry);
+    EXPECT_EQ(parsed.Find(1)->metadata.network, metadata.network);
+    EXPECT_EQ(parsed.Find(1)->metadata.tags, metadata.tags);
+    EXPECT_EQ(parsed.Find(1)->metadata.last_used, metadata.last_used);
+
+    // Cut inside the last tag
+    EXPECT_EQ(parsed.Parse(buf.data(), buf.size() - 2, 40), -1);
+}
+
+TEST_F(RecordDirectoryTest, Parse_Version1_EntriesHaveEmptyMetadata) {
+    // version, next id, count, then id, offset, length, name length, name
+    std::vector<unsigned char> buf(9 + 18 + 5);
+    buf[0] = 1;
+    StoreLE32(buf.data() + 1, 1);
+    StoreLE32(buf.data() + 5, 1);
+    StoreLE32(buf.data() + 9, 0);
+    StoreLE64(buf.data() + 13, 0);
+    StoreLE32(buf.data() + 21, 40);
+    StoreLE16(buf.data() + 25, 5);
+    memcpy(buf.data() + 27, "Card1", 5);
+
+    RecordDirectory parsed;
+    ASSERT_EQ(parsed.Parse(buf.data(), buf.size(), 40), 0);
+    EXPECT_EQ(parsed.Version(), 1);
+    EXPECT_EQ(parsed.Find(0)->name, "Card1");
+    EXPECT_EQ(parsed.Find(0)->metadata.fingerprint, RecordDirectory::Fingerprint{});
+    EXPECT_EQ(parsed.Find(0)->metadata.expiry, 0);
+
+    RecordDirectory::Metadata metadata{};
+    metadata.fingerprint.fill(1);
+    EXPECT_TRUE(parsed.SetMetadata(0, metadata));
+    EXPECT_FALSE(parsed.SetMetadata(1, metadata));
+    EXPECT_EQ(parsed.Find(0)->metadata.fingerprint, metadata.fingerprint);
+}
+
+TEST_F(RecordDirectoryTest, Parse_Version2_EntriesHaveFingerprintButNoExpiry) {
+    // version, next id, count, then id, offset, length, fingerprint, name length, name
+    std::vector<unsigned char> buf(9 + 18 + RecordDirectory::FINGERPRINT_LEN + 5);
+    buf[0] = 2;
+    StoreLE32(buf.data() + 1, 1);
+    StoreLE32(buf.data() + 5, 1);
+    StoreLE32(buf.data() + 9, 0);
+    StoreLE64(buf.data() + 13, 0);
+    StoreLE32(buf.data() + 21, 40);
+    memset(buf.data() + 25, 0xab, RecordDirectory::FINGERPRINT_LEN);
+    StoreLE16(buf.data() + 25 + RecordDirectory::FINGERPRINT_LEN, 5);
+    memcpy(buf.data() + 27 + RecordDirectory::FINGERPRINT_LEN, "Card1", 5);
+
+    RecordDirectory parsed;
+    ASSERT_EQ(parsed.Parse(buf.data(), buf.size(), 40), 0);
+    EXPECT_EQ(parsed.Version(), 2);
+    EXPECT_EQ(parsed.Find(0)->name, "Card1");
+    EXPECT_EQ(parsed.Find(0)->metadata.fingerprint[0], 0xab);
+    EXPECT_EQ(parsed.Find(0)->metadata.expiry, 0);
+}
+
+TEST_F(RecordDirectoryTest, Parse_RecordPastRegion_ReturnsNegative1) {
+    directory_.Add("Card1");
+    std::vector<unsigned char> buf = SerializeWith({{10, 40}});
+
+    RecordDirectory parsed;
+    EXPECT_EQ(parsed.Parse(buf.data(), buf.size(), 49), -1);
+    EXPECT_EQ(parsed.Size(), 0);
+}
+
+TEST_F(RecordDirectoryTest, Parse_Truncated_ReturnsNegative1) {
+    directory_.Add("Card1");
+    std::vector<unsigned char> buf = SerializeWith({{0, 40}});
+
+    RecordDirectory parsed;
+    EXPECT_EQ(parsed.Parse(buf.data(), buf.size() - 1, 40), -1);
+    EXPECT_EQ(parsed.Parse(buf.data(), 0, 40), -1);
+}
+
+TEST_F(RecordDirectoryTest, Parse_UnknownVersion_ReturnsNegative1) {
+    std::vector<unsigned char> buf = SerializeWith({});
+    buf[0] = RecordDirectory::FORMAT_VERSION + 1;
+
+    RecordDirectory parsed;
+    EXPECT_EQ(parsed.Parse(buf.data(), buf.size(), 0), -1);
+}
@@ -12,6 +12,21 @@ class SodiumCryptoTest : public ::testing::Test {
 // InitCrypto
 TEST_F(SodiumCryptoTest, InitCrypto_WhenAlreadyInitialized_ReturnsOne) { EXPECT_EQ(crypto_.InitCrypto(), 1); }
 
+// GetCipherSuite + SetCipherSuite
+TEST_F(SodiumCryptoTest, GetCipherSuite_Default_ReturnsXChaCha20) {
+    EXPECT_EQ(crypto_.GetCipherSuite(), CIPHER_XCHACHA20POLY1305);
+}
+
+TEST_F(SodiumCryptoTest, SetCipherSuite_UnknownSuite_ReturnsNegative1) {
+    EXPECT_EQ(crypto_.SetCipherSuite(0xff), -1);
+    EXPECT_EQ(crypto_.GetCipherSuite(), CIPHER_XCHACHA20POLY1305);
+}
+
+TEST_F(SodiumCryptoTest, SetCipherSuite_Aes256Gcm_MatchesHardwareSupport) {
+    int expected = crypto_aead_aes256gcm_is_available() != 0 ? 0 : -1;
+    EXPECT_EQ(crypto_.SetCipherSuite(CIPHER_AES256GCM), expected);
+}
+
 // EncryptionAddedBytes
 TEST_F(SodiumCryptoTest, EncryptionAddedBytes_ReturnsLibsodiumConstant) {
     EXPECT_EQ(crypto_.EncryptionAddedBytes(), crypto_secretstream_xchacha20poly1305_ABYTES);
@@ -45,6 +60,55 @@ TEST_F(SodiumCryptoTest, DeriveEncryptionKey_ValidInput_Returns0) {
               0);
 }
 
+TEST_F(SodiumCryptoTest, DeriveEncryptionKeyWithLimits_DefaultLimits_MatchesDeriveEncryptionKey) {
+    unsigned char key[crypto_.EncryptionKeyLen()];
+    unsigned char limited_key[crypto_.EncryptionKeyLen()];
+    unsigned char salt[crypto_.SaltLen()];
+    const auto *password = reinterpret_cast<const unsigned char *>("valid_password");
+
+    crypto_.GenerateSalt(salt);
+    ASSERT_EQ(crypto_.DeriveEncryptionKey(key, sizeof(key), password, salt), 0);
+    ASSERT_EQ(crypto_.DeriveEncryptionKeyWithLimits(limited_key, sizeof(limited_key), password, salt,
+                                                    crypto_.KdfOpsLimit(), crypto_.KdfMemLimit()),
+              0);
+    EXPECT_EQ(memcmp(key, limited_key, sizeof(key)), 0);
+}
+
+TEST_F(SodiumCryptoTest, DeriveEncryptionKeyWithLimits_LimitsOutOfRange_ReturnsNegative1) {
+    unsigned char key[crypto_.EncryptionKeyLen()];
+    unsigned char salt[crypto_.SaltLen()];
+    const auto *password = reinterpret_cast<const unsigned char *>("valid_password");
+
+    crypto_.GenerateSalt(salt);
+    EXPECT_EQ(crypto_.DeriveEncryptionKeyWithLimits(key, sizeof(key), password, salt, 0, crypto_.KdfMemLimit()), -1);
+    EXPECT_EQ(crypto_.DeriveEncryptionKeyWithLimits(key, sizeof(key), password, salt, crypto_.KdfOpsLimit(), 1), -1);
+}
+
+// KdfLanes + SetKdfLanes
+TEST_F(SodiumCryptoTest, SetKdfLanes_OutOfRange_ReturnsNegative1) {
+    EXPECT_EQ(crypto_.KdfLanes(), 1);
+    EXPECT_EQ(crypto_.SetKdfLanes(0), -1);
+    EXPECT_EQ(crypto_.SetKdfLanes(SodiumCrypto::MAX_KDF_LANES + 1), -1);
+    EXPECT_EQ(crypto_.SetKdfLanes(SodiumCrypto::MAX_KDF_LANES), 0);
+    EXPECT_EQ(crypto_.KdfLanes(), SodiumCrypto::MAX_KDF_LANES);
+}
+
+TEST_F(SodiumCryptoTest, DeriveEncryptionKey_SeveralLanes_DependsOnLaneCount) {
+    unsigned char one_lane_key[crypto_.EncryptionKeyLen()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+    unsigned char key_again[crypto_.EncryptionKeyLen()];
+    unsigned char salt[crypto_.SaltLen()];
+    const auto *password = reinterpret_cast<const unsigned char *>("valid_password");
+
+    crypto_.GenerateSalt(salt);
+    ASSERT_EQ(crypto_.DeriveEncryptionKey(one_lane_key, sizeof(one_lane_key), password, salt), 0);
+    ASSERT_EQ(crypto_.SetKdfLanes(2), 0);
+    ASSERT_EQ(crypto_.DeriveEncryptionKey(key, sizeof(key), password, salt), 0);
+    ASSERT_EQ(crypto_.DeriveEncryptionKey(key_again, sizeof(key_again), password, salt), 0);
+    EXPECT_EQ(memcmp(key, key_again, sizeof(key)), 0);
+    EXPECT_NE(memcmp(key, one_lane_key, sizeof(key)), 0);
+}
+
 // EncryptBuf
 TEST_F(SodiumCryptoTest, EncryptBuf_InvalidBufLen_ReturnsNegative1) {
     const std::string plaintext = "Test secret message";
@@ -78,6 +142,134 @@ TEST_F(SodiumCryptoTest, EncryptDecryptBuf_SimpleString_ReturnsSameString) {
     ASSERT_EQ(memcmp(decrypted, plaintext.c_str(), plaintext.size()), 0);
 }
 
+TEST_F(SodiumCryptoTest, EncryptDecryptBuf_Aes256Gcm_ReturnsSameString) {
+    if (crypto_.SetCipherSuite(CIPHER_AES256GCM) != 0) {
+        GTEST_SKIP() << "AES-256-GCM not available on this host";
+    }
+    EXPECT_EQ(crypto_.EncryptionHeaderLen(), crypto_aead_aes256gcm_NPUBBYTES);
+    EXPECT_EQ(crypto_.EncryptionAddedBytes(), crypto_aead_aes256gcm_ABYTES);
+
+    const std::string plaintext = "Test secret message";
+    uint64_t data_len = plaintext.size() + crypto_.EncryptionAddedBytes();
+    unsigned char encrypted[data_len];
+    unsigned char header[crypto_.EncryptionHeaderLen()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+
+    ASSERT_EQ(crypto_.EncryptBuf(encrypted, header, reinterpret_cast<const unsigned char *>(plaintext.c_str()),
+                                 plaintext.size(), key),
+              0);
+
+    unsigned char decrypted[data_len];
+    uint64_t decrypted_len;
+    ASSERT_EQ(crypto_.DecryptBuf(decrypted, &decrypted_len, header, encrypted, data_len, key), 0);
+    ASSERT_EQ(decrypted_len, plaintext.size());
+    ASSERT_EQ(memcmp(decrypted, plaintext.c_str(), plaintext.size()), 0);
+
+    encrypted[0] ^= 1;
+    ASSERT_EQ(crypto_.DecryptBuf(decrypted, &decrypted_len, header, encrypted, data_len, key), -1);
+}
+
+// EncryptBufInPlace + DecryptBufInPlace
+TEST_F(SodiumCryptoTest, EncryptDecryptBufInPlace_SimpleString_ReturnsSameString) {
+    const std::string plaintext = "Test secret message";
+    uint64_t data_len = plaintext.size() + crypto_.EncryptionAddedBytes();
+    unsigned char buf[data_len];
+    unsigned char header[crypto_.EncryptionHeaderLen()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+    crypto_.GenerateSalt(key);
+
+    memcpy(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size());
+    ASSERT_EQ(crypto_.EncryptBufInPlace(buf, header, plaintext.size(), key), 0);
+    ASSERT_NE(memcmp(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size()), 0);
+
+    uint64_t decrypted_len;
+    ASSERT_EQ(crypto_.DecryptBufInPlace(buf, &decrypted_len, header, data_len, key), 0);
+    ASSERT_EQ(decrypted_len, plaintext.size());
+    ASSERT_EQ(memcmp(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size()), 0);
+}
+
+TEST_F(SodiumCryptoTest, EncryptBufInPlace_MatchesOutOfPlaceDecrypt) {
+    const std::string plaintext = "Test secret message";
+    uint64_t data_len = plaintext.size() + crypto_.EncryptionAddedBytes();
+    unsigned char buf[data_len];
+    unsigned char header[crypto_.EncryptionHeaderLen()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+
+    memcpy(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size());
+    ASSERT_EQ(crypto_.EncryptBufInPlace(buf, header, plaintext.size(), key), 0);
+
+    unsigned char decrypted[data_len];
+    uint64_t decrypted_len;
+    ASSERT_EQ(crypto_.DecryptBuf(decrypted, &decrypted_len, header, buf, data_len, key), 0);
+    ASSERT_EQ(memcmp(decrypted, plaintext.c_str(), plaintext.size()), 0);
+}
+
+TEST_F(SodiumCryptoTest, EncryptDecryptBufInPlace_Aes256Gcm_ReturnsSameString) {
+    if (crypto_.SetCipherSuite(CIPHER_AES256GCM) != 0) {
+        GTEST_SKIP() << "AES-256-GCM not available on this host";
+    }
+
+    const std::string plaintext = "Test secret message";
+    uint64_t data_len = plaintext.size() + crypto_.EncryptionAddedBytes();
+    unsigned char buf[data_len];
+    unsigned char header[crypto_.EncryptionHeaderLen()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+
+    memcpy(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size());
+    ASSERT_EQ(crypto_.EncryptBufInPlace(buf, header, plaintext.size(), key), 0);
+
+    uint64_t decrypted_len;
+    ASSERT_EQ(crypto_.DecryptBufInPlace(buf, &decrypted_len, header, data_len, key), 0);
+    ASSERT_EQ(decrypted_len, plaintext.size());
+    ASSERT_EQ(memcmp(buf + crypto_.EncryptionInPlaceOffset(), plaintext.c_str(), plaintext.size()), 0);
+}
+
+// EncryptRecord + DecryptRecord
+TEST_F(SodiumCryptoTest, EncryptDecryptRecord_SimpleString_ReturnsSameString) {
+    for (uint8_t suite : {CIPHER_XCHACHA20POLY1305, CIPHER_AES256GCM}) {
+        if (crypto_.SetCipherSuite(suite) != 0) {
+            continue; // AES-256-GCM not available on this host
+        }
+
+        const std::string plaintext = "Test secret message";
+        unsigned char record[plaintext.size() + crypto_.RecordAddedBytes()];
+        unsigned char key[crypto_.EncryptionKeyLen()];
+        crypto_.GenerateSalt(key);
+        crypto_.GenerateSalt(key + crypto_.SaltLen());
+        const unsigned char ad[] = {7, 0, 0, 0};
+
+        ASSERT_EQ(crypto_.EncryptRecord(record, reinterpret_cast<const unsigned char *>(plaintext.c_str()),
+                                        plaintext.size(), ad, sizeof(ad), key),
+                  0);
+
+        unsigned char decrypted[plaintext.size()];
+        uint64_t decrypted_len;
+        ASSERT_EQ(crypto_.DecryptRecord(decrypted, &decrypted_len, record, sizeof(record), ad, sizeof(ad), key), 0);
+        ASSERT_EQ(decrypted_len, plaintext.size());
+        ASSERT_EQ(memcmp(decrypted, plaintext.c_str(), plaintext.size()), 0);
+    }
+}
+
+TEST_F(SodiumCryptoTest, DecryptRecord_OtherAssociatedData_ReturnsNegative1) {
+    const std::string plaintext = "Test secret message";
+    unsigned char record[plaintext.size() + crypto_.RecordAddedBytes()];
+    unsigned char key[crypto_.EncryptionKeyLen()];
+    const unsigned char ad[] = {7, 0, 0, 0};
+    const unsigned char other_ad[] = {8, 0, 0, 0};
+
+    ASSERT_EQ(crypto_.EncryptRecord(record, reinterpret_cast<const unsigned char *>(plaintext.c_str()),
+                                    plaintext.size(), ad, sizeof(ad), key),
+              0);
+
+    unsigned char decrypted[plaintext.size()];
+    uint64_t decrypted_len;
+    ASSERT_EQ(crypto_.DecryptRecord(decrypted, &decrypted_len, record, sizeof(record), other_ad, sizeof(other_ad), key),
+              -1);
+    ASSERT_EQ(crypto_.DecryptRecord(decrypted, &decrypted_len, record, crypto_.RecordAddedBytes() - 1, ad, sizeof(ad),
+                                    key),
+              -1);
+}
+
 // HashPassword + VerifyPasswordHash
 TEST_F(SodiumCryptoTest, HashPassword_ValidPassword_VerifiesSuccessfully) {
     unsigned char hash[crypto_pwhash_STRBYTES];
@@ -107,6 +299,17 @@ TEST_F(SodiumCryptoTest, GenerateSalt_ProducesUniqueValues) {
     EXPECT_NE(memcmp(salt1, salt2, crypto_.SaltLen()), 0);
 }
 
+// GenerateKey
+TEST_F(SodiumCryptoTest, GenerateKey_ProducesUniqueKeys) {
+    unsigned char key1[crypto_.EncryptionKeyLen()];
+    unsigned char key2[crypto_.EncryptionKeyLen()];
+
+    crypto_.GenerateKey(key1);
+    crypto_.GenerateKey(key2);
+
+    EXPECT_NE(memcmp(key1, key2, crypto_.EncryptionKeyLen()), 0);
+}
+
 // Memzero 
 TEST_F(SodiumCryptoTest, Memzero_ZeroesMemory) {
     unsigned char buffer[crypto_.SaltLen()];
@@ -117,3 +320,39 @@ TEST_F(SodiumCryptoTest, Memzero_ZeroesMemory) {
         EXPECT_EQ(i, 0);
     }
 }
+
+// DeriveSubkey + KeyedHash
+TEST_F(SodiumCryptoTest, DeriveSubkey_DistinctIds_GiveDistinctKeys) {
+    unsigned char key[crypto_kdf_KEYBYTES] = {1};
+    unsigned char subkey1[crypto_kdf_KEYBYTES];
+    unsigned char subkey2[crypto_kdf_KEYBYTES];
+    unsigned char again[crypto_kdf_KEYBYTES];
+    ASSERT_EQ(crypto_.DeriveSubkey(subkey1, 1, key), 0);
+    ASSERT_EQ(crypto_.DeriveSubkey(subkey2, 2, key), 0);
+    ASSERT_EQ(crypto_.DeriveSubkey(again, 1, key), 0);
+    EXPECT_NE(memcmp(subkey1, subkey2, sizeof(subkey1)), 0);
+    EXPECT_EQ(memcmp(subkey1, again, sizeof(subkey1)), 0);
+}
+
+TEST_F(SodiumCryptoTest, KeyedHash_DependsOnKey) {
+    unsigned char key1[crypto_generichash_KEYBYTES] = {1};
+    unsigned char key2[crypto_generichash_KEYBYTES] = {2};
+    const auto *in = reinterpret_cast<const unsigned char *>("4111111111111111");
+    unsigned char hash1[16];
+    unsigned char hash2[16];
+    unsigned char again[16];
+    ASSERT_EQ(crypto_.KeyedHash(hash1, sizeof(hash1), in, 16, key1), 0);
+    ASSERT_EQ(crypto_.KeyedHash(hash2, sizeof(hash2), in, 16, key2), 0);
+    ASSERT_EQ(crypto_.KeyedHash(again, sizeof(again), in, 16, key1), 0);
+    EXPECT_NE(memcmp(hash1, hash2, sizeof(hash1)), 0);
+    EXPECT_EQ(memcmp(hash1, again, sizeof(hash1)), 0);
+}
+
+// SecureAlloc + SecureFree
+TEST_F(SodiumCryptoTest, SecureAlloc_ReturnsWritableMemory) {
+    auto *buf = static_cast<unsigned char *>(crypto_.SecureAlloc(64));
+    ASSERT_NE(buf, nullptr);
+    memset(buf, 0xab, 64);
+    EXPECT_EQ(buf[63], 0xab);
+    crypto_.SecureFree(buf);
+}
@@ -1,12 +1,19 @@
 #include "mockcrypto.hpp"
 #include "mockfileio.hpp"
+#include "mockkeycache.hpp"
 #include "store.hpp"
+#include "utils.hpp"
 
+#include <atomic>
+#include <future>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 using ::testing::_;
+using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::SizeIs;
+using ::testing::StartsWith;
 
 class StoreTest : public ::testing::Test {
   protected:
@@ -16,12 +23,19 @@ class StoreTest : public ::testing::Test {
 
     uint64_t hash_len_ = 32;
     uint64_t salt_len_ = 16;
+    uint64_t header_len_ = HEADER_PREFIX_LEN + hash_len_ + salt_len_ + 8;
+    uint64_t unhashed_header_len_ = header_len_ - hash_len_; // a header without the password hash
     uint64_t encryption_key_len_ = 64;
     uint64_t encryption_header_len_ = 32;
     uint64_t encryption_added_bytes_ = 32;
+    uint64_t encryption_in_place_offset_ = 1;
+    uint64_t record_added_bytes_ = 40;
+    uint64_t wrapped_key_len_ = encryption_key_len_ + record_added_bytes_;
+    uint64_t key_slot_len_ = 2 * sizeof(uint64_t) + salt_len_ + wrapped_key_len_;
+    uint64_t ops_limit_ = 3;
+    uint64_t mem_limit_ = 1 << 16;
 
-    std::string one_card_formatted_ = ",4111111111111111,111,10,2020;";
-    std::string two_cards_formatted_ = ",4111111111111111,111,10,2020;,4111111111111111,111,10,2020;";
+    std::string card_formatted_ = "Card1,4111111111111111,111,10,2030;";
 
     void SetUp() override {
         auto mock_crypto = std::make_shared<::testing::NaggyMock<MockCrypto>>();
@@ -33,345 +47,1843 @@ class StoreTest : public ::testing::Test {
         store_ = std::make_unique<Store>(mock_crypto, std::move(mock_file_io));
     }
 
-    auto TestReadHeader(unsigned char *hash, unsigned char *salt) -> int { return store_->ReadHeader(hash, salt); }
-    auto TestReadData(unsigned char *decrypted_data, uintmax_t data_size, uint64_t *decrypted_size_actual) -> int {
-        return store_->ReadData(decrypted_data, data_size, decrypted_size_actual);
+    auto TestReadHeader(unsigned char *hash, unsigned char *salt, uint8_t *cipher_suite, uint64_t *directory_len,
+                        bool *legacy) -> int {
+        return store_->ReadHeader(hash, salt, cipher_suite, directory_len, legacy);
+    }
+    auto TestPrefetchDirectory(uint64_t directory_len) -> Store::LoadStoreStatus {
+        Store::DirectoryPrefetch prefetch;
+        store_->PrefetchDirectory(directory_len, &prefetch);
+        if (prefetch.thread.joinable()) {
+            prefetch.thread.join();
+        }
+        return prefetch.status;
     }
     auto TestWriteHeader(const unsigned char *hash, const unsigned char *salt) -> int {
-        return store_->WriteHeader(hash, salt);
+        return store_->WriteHeader(hash, salt, nullptr, 1, {}, 0);
+    }
+    auto TestWriteData(const unsigned char *hash, const unsigned char *salt, unsigned char *data, uintmax_t data_size)
+        -> int {
+        return store_->WriteData(hash, salt, nullptr, 1, {}, nullptr, data, data_size, {}, nullptr);
+    }
+
+    // The magic and version, then the cipher suite byte
+    inline void ValidReadPrefixExpects(uint8_t cipher_suite) {
+        EXPECT_CALL(*mock_file_io_ptr_, Read(_, HEADER_PREFIX_LEN)).WillOnce(Invoke([cipher_suite](char *buf, int64_t) {
+            memcpy(buf, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+            buf[sizeof(HEADER_MAGIC)] = HEADER_VERSION;
+            buf[sizeof(HEADER_MAGIC) + 1] = static_cast<char>(cipher_suite);
+            return true;
+        }));
+    }
+
+    // The header read hands back the cipher suite byte from the prefix and directory_len from the fixed segments that
+    // follow it; the wrapped key, if the byte says there is one, is read separately
+    inline void ValidReadHeaderExpects(uint64_t directory_len = 0, bool key_wrapped = false) {
+        EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+        ValidReadPrefixExpects(CIPHER_XCHACHA20POLY1305 | (key_wrapped ? HEADER_WRAPPED_KEY : 0));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(HEADER_SEGMENTS - 1)))
+            .WillOnce(Invoke([directory_len](std::span<const iovec> seg) {
+                StoreLE64(static_cast<unsigned char *>(seg[2].iov_base), directory_len);
+                return true;
+            }));
+        EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(1)).WillRepeatedly(Return(0));
+    }
+
+    // Without a wrapped key the password key is used as the data key, as in stores written before data keys, and the
+    // password is checked against the hash; a wrapped key is checked by its own tag instead
+    inline void ValidUnlockExpects(uint32_t generation, uint64_t directory_len, bool key_wrapped = false) {
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_file_io_ptr_, OpenRead(generation)).WillOnce(Return(0));
+        ValidReadHeaderExpects(directory_len, key_wrapped);
+        EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+        if (!key_wrapped) {
+            EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+        }
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
+        if (key_wrapped) {
+            EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+            EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+            EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+                .WillOnce(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                        const unsigned char *, uint64_t, const unsigned char *) {
+                    *out_len = encryption_key_len_;
+                    return 0;
+                }));
+        }
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    }
+
+    // A store from before the header magic: the password hash and salt, then every card's text as one message under
+    // the password key. Unlocking it wraps a new data key and takes the fingerprint of each card's number.
+    inline void ValidLegacyUnlockExpects(const std::string &text, int cards) {
+        uint64_t fields_len = hash_len_ + salt_len_;
+        uint64_t encrypted_len = text.size() + encryption_added_bytes_;
+        EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+        EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, Read(_, HEADER_PREFIX_LEN)).WillOnce(Invoke([](char *buf, int64_t len) {
+            memcpy(buf, "$argon2id$", len);
+            return true;
+        }));
+        EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead())
+            .WillOnce(Return(fields_len + encryption_header_len_ + encrypted_len));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, hash_len_, 0)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, salt_len_, hash_len_)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(1)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, encryption_header_len_, fields_len)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, encrypted_len, fields_len + encryption_header_len_))
+            .WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, DecryptBuf(_, _, _, _, encrypted_len, _))
+            .WillOnce(Invoke([text](unsigned char *out, uint64_t *out_len, unsigned char *, unsigned char *, uintmax_t,
+                                    const unsigned char *) {
+                memcpy(out, text.data(), text.size());
+                *out_len = text.size();
+                return 0;
+            }));
+        EXPECT_CALL(*mock_crypto_ptr_, GenerateKey(_)).Times(1);
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, encryption_key_len_, _, salt_len_, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, _, _, _, _)).Times(cards).WillRepeatedly(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+    }
+
+    // Loads a store from before data keys with one stored record
+    inline void LoadOneRecord(uint64_t *directory_len, uint64_t *records_len) {
+        RecordDirectory directory;
+        directory.Add("Card1");
+        *records_len = card_formatted_.size() + record_added_bytes_;
+        *directory_len = encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+        ValidUnlockExpects(0, *directory_len);
+        EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + *directory_len + *records_len));
+        ValidReadDirectoryExpects(directory, {{0, static_cast<uint32_t>(*records_len)}});
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+        unsigned char password[] = "pwd";
+        ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+        ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+        ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+    }
+
+    // The old password checked, by the password hash or, once the key is wrapped, by unwrapping it, then a fresh salt
+    // and wrapped key and the new header without a hash followed by copy_len bytes of the current store from
+    // copy_offset
+    inline void ValidChangePasswordExpects(uint64_t directory_len, uint64_t copy_offset, uint64_t copy_len,
+                                           bool key_wrapped = false) {
+        if (key_wrapped) {
+            ValidVerifyWrappedPasswordExpects();
+        } else {
+            EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+        }
+        EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).Times(0);
+        EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _))
+            .Times(key_wrapped ? 2 : 1)
+            .WillRepeatedly(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, encryption_key_len_, _, salt_len_, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(key_wrapped ? 3 : 1);
+
+        EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS)))
+            .WillOnce(Invoke([this, directory_len](std::span<const iovec> seg) {
+                EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[HEADER_PREFIX_LEN - 1],
+                          CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY);
+                EXPECT_EQ(seg[1].iov_len, 0);
+                EXPECT_EQ(LoadLE64(static_cast<unsigned char *>(seg[3].iov_base)), directory_len);
+                EXPECT_EQ(seg[4].iov_len, wrapped_key_len_);
+                return true;
+            }));
+        EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(copy_offset, copy_len)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    }
+
+    // The password of a store with a wrapped key is checked by deriving the password key and unwrapping the data key
+    inline void ValidVerifyWrappedPasswordExpects() {
+        EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).Times(0);
+        EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+            .WillOnce(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                    const unsigned char *, uint64_t, const unsigned char *) {
+                *out_len = encryption_key_len_;
+                return 0;
+            }));
     }
-    auto TestWriteData(unsigned char *data, uintmax_t data_size) -> int { return store_->WriteData(data, data_size); }
-    auto TestGetCardsSize() -> uintmax_t { return store_->GetCardsSize(); }
-    auto TestCardsFormatted(unsigned char *buf) -> uintmax_t { return store_->CardsFormatted(buf); }
-    void TestLoadCards(unsigned char *data) { store_->LoadCards(data); }
 
-    inline void ValidReadHeaderExpects() {
-        EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0)).WillOnce(Return(hash_len_ + salt_len_));
+    // A header with a wrapped key and one extra key slot, whose limits are ops_limit_ and mem_limit_
+    inline void ValidReadKeySlotsExpects() {
+        uint8_t cipher_suite = CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY | HEADER_KEY_SLOTS;
         EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
         EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-        EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+        ValidReadPrefixExpects(cipher_suite);
+        EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(HEADER_SEGMENTS - 1)))
+            .WillOnce(Invoke([](std::span<const iovec> seg) {
+                StoreLE64(static_cast<unsigned char *>(seg[2].iov_base), 0);
+                return true;
+            }));
+        EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(1)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, Read(_, 1)).WillOnce(Invoke([](char *buf, int64_t) {
+            *buf = 1;
+            return true;
+        }));
+        EXPECT_CALL(*mock_file_io_ptr_, Read(_, key_slot_len_)).WillOnce(Invoke([this](char *buf, int64_t) {
+            StoreLE64(reinterpret_cast<unsigned char *>(buf), ops_limit_);
+            StoreLE64(reinterpret_cast<unsigned char *>(buf) + sizeof(uint64_t), mem_limit_);
+            return true;
+        }));
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+    }
+
+    // Slot 0 and the extra slot derive different password keys, so an unwrap can tell which slot it is opening. Slot 0
+    // may be skipped when the extra slot opens first
+    inline void ValidSlotPasswordKeysExpects(bool extra_slot_opens) {
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _))
+            .Times(extra_slot_opens ? ::testing::AtMost(1) : ::testing::Exactly(1))
+            .WillRepeatedly(
+                Invoke([](unsigned char *key, size_t key_len, const unsigned char *, const unsigned char *) {
+                    memset(key, 0, key_len);
+                    return 0;
+                }));
+        EXPECT_CALL(*mock_crypto_ptr_,
+                    DeriveEncryptionKeyWithLimits(_, encryption_key_len_, _, _, ops_limit_, mem_limit_))
+            .WillOnce(Invoke([](unsigned char *key, size_t key_len, const unsigned char *, const unsigned char *,
+                                uint64_t, uint64_t) {
+                memset(key, EXTRA_SLOT_KEY_BYTE, key_len);
+                return 0;
+            }));
+    }
+
+    // The one record of LoadOneRecord read from records_offset and opened
+    inline void ValidReadRecordExpects(uint64_t records_offset, uint64_t records_len) {
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, records_len, records_offset)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, records_len, _, sizeof(uint32_t), _))
+            .WillOnce(Invoke([this](unsigned char *out, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                    const unsigned char *, uint64_t, const unsigned char *) {
+                memcpy(out, card_formatted_.data(), card_formatted_.size());
+                *out_len = card_formatted_.size();
+                return 0;
+            }));
+        EXPECT_CALL(*mock_crypto_ptr_, SecureAlloc(_)).WillRepeatedly(Invoke(malloc));
+        EXPECT_CALL(*mock_crypto_ptr_, SecureFree(_)).WillRepeatedly(Invoke(free));
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
     }
 
-    inline void ValidReadDataExpects() {
+    // A new data key wrapped under the password key, then on the rotation's thread the one record of LoadOneRecord
+    // opened and sealed again behind the space for the header and directory, which are written last
+    inline void ValidRotateDataKeyExpects(uint64_t directory_len, uint64_t records_len) {
+        EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
         EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
-        EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(true));
-        EXPECT_CALL(*mock_crypto_ptr_, DecryptBuf(_, _, _, _, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillRepeatedly(Return(encryption_in_place_offset_));
+        EXPECT_CALL(*mock_crypto_ptr_, GenerateKey(_)).Times(1);
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, encryption_key_len_, _, salt_len_, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+
+        EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, SeekWriteTemp(unhashed_header_len_ + wrapped_key_len_ + directory_len))
+            .WillOnce(Return(true));
+        ValidReadRecordExpects(header_len_ + directory_len, records_len);
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, card_formatted_.size(), _, sizeof(uint32_t), _))
+            .WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, _, _, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, records_len)).WillOnce(Return(true));
+
+        EXPECT_CALL(*mock_file_io_ptr_, SeekWriteTemp(0)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 2)))
+            .WillOnce(Invoke([this, directory_len](std::span<const iovec> seg) {
+                EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[HEADER_PREFIX_LEN - 1],
+                          CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY);
+                EXPECT_EQ(LoadLE64(static_cast<unsigned char *>(seg[3].iov_base)), directory_len);
+                EXPECT_EQ(seg[4].iov_len, wrapped_key_len_);
+                return true;
+            }));
+        EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    }
+
+    // Decryption of the directory yields the serialization of directory, whose records take records_len bytes
+    inline void ValidReadDirectoryExpects(const RecordDirectory &directory,
+                                          const std::vector<RecordDirectory::Location> &locations) {
+        std::vector<unsigned char> plain(directory.SerializedSize());
+        directory.Serialize(plain.data(), locations);
+        ValidReadDirectoryExpects(plain);
+    }
+
+    inline void ValidReadDirectoryExpects(const std::vector<unsigned char> &plain) {
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+        EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, DecryptBufInPlace(_, _, _, _, _))
+            .WillOnce(Invoke([this, plain](unsigned char *buf, uint64_t *out_len, unsigned char *, uintmax_t,
+                                           const unsigned char *) {
+                memcpy(buf + encryption_in_place_offset_, plain.data(), plain.size());
+                *out_len = plain.size();
+                return 0;
+            }));
+    }
+
+    // A random data key is generated and sealed under the password key, bound to the salt
+    inline void ValidWrapKeyExpects() {
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, GenerateKey(_)).Times(1);
+        EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, encryption_key_len_, _, salt_len_, _)).WillOnce(Return(0));
     }
 
     inline void ValidWriteHeaderExpects() {
-        EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-            .WillOnce(Return(0))
-            .WillOnce(Return(hash_len_ + salt_len_));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS))).WillOnce(Return(true));
+        EXPECT_CALL(*mock_crypto_ptr_, KdfLanes()).WillRepeatedly(Return(1));
+        EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+        EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    }
+
+    // Store header, encryption header, directory ciphertext and record_segments runs of sealed records go out in a
+    // single gather write
+    inline void ValidWriteDataExpects(size_t record_segments) {
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 2 + record_segments)))
+            .WillOnce(Return(true));
 
-        EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _)).WillOnce(Return(0)).WillOnce(Return(0));
         EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
         EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     }
 
-    inline void ValidWriteDataExpects(uint64_t decrypted_data_size) {
-        EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-        EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-        EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(0));
+    // The cards added so far are sealed into one buffer and the store is committed
+    inline void ValidSaveNewCardsExpects(size_t new_cards) {
+        EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+        EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, sizeof(uint32_t), _))
+            .Times(static_cast<int>(new_cards))
+            .WillRepeatedly(Return(0));
+        ValidWriteDataExpects(1);
+        EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+        EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(static_cast<int>(new_cards) + 1);
+        EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+        EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    }
 
-        EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _)).WillOnce(Return(0)).WillOnce(Return(0));
+    // Autosave times its saves by a clock that stands still until the test moves it on
+    inline auto SetFakeAutosaveClock() -> std::shared_ptr<std::atomic<std::chrono::milliseconds>> {
+        auto elapsed = std::make_shared<std::atomic<std::chrono::milliseconds>>(std::chrono::milliseconds(0));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        store_->SetAutosaveClock([elapsed, start] { return start + elapsed->load(); });
+        return elapsed;
+    }
 
+    // Reads move over to the store a background save committed
+    inline void ValidApplySaveExpects() {
         EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
         EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-        EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-            .WillOnce(
-                Return(hash_len_ + salt_len_ + encryption_header_len_ + decrypted_data_size + encryption_added_bytes_));
+        EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+        EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    }
+
+    // Saves the cards added so far, leaving them as stored records
+    inline void SaveNewCards(size_t new_cards) {
+        ValidSaveNewCardsExpects(new_cards);
+        EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+        EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+        ASSERT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+        ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+        ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
     }
+
+    static const size_t HEADER_SEGMENTS = 7;
+    static constexpr uint64_t ROTATION_CHUNK_LEN = 64 * 1024;
+    static constexpr unsigned char HEADER_MAGIC[] = {'W', 'C', 'S', 'T'};
+    static constexpr uint8_t HEADER_VERSION = 1;
+    static constexpr size_t HEADER_PREFIX_LEN = sizeof(HEADER_MAGIC) + 2;
+    static constexpr unsigned char EXTRA_SLOT_KEY_BYTE = 1;
+    static const uint8_t HEADER_WRAPPED_KEY = 0x80;
+    static const uint8_t HEADER_KEY_SLOTS = 0x40;
+    static const uint8_t HEADER_KDF_LANES = 0x20;
 };
 
-// InitNewStore
+// The wrapped key's tag authenticates the password, so no password hash is computed or written
 TEST_F(StoreTest, InitNewStore_ValidInput_Returns0) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
 
-    EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).Times(0);
     EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    ValidWrapKeyExpects();
     EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
-    ValidWriteHeaderExpects();
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS)))
+        .WillOnce(Invoke([](std::span<const iovec> seg) {
+            EXPECT_EQ(seg[1].iov_len, 0);
+            return true;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, KdfLanes()).WillRepeatedly(Return(1));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
     EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2); // password key, data key
 
     unsigned char password[] = "pwd";
     EXPECT_EQ(0, store_->InitNewStore(password));
 }
 
-TEST_F(StoreTest, InitNewStore_HashPasswordFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).WillOnce(Return(-1));
+TEST_F(StoreTest, InitNewStore_WrapKeyFails_ReturnsNegative1) {
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, GenerateKey(_)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
 
     unsigned char password[] = "pwd";
     EXPECT_EQ(store_->InitNewStore(password), -1);
 }
 
 TEST_F(StoreTest, InitNewStore_OpenWriteTempFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-
-    EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    ValidWrapKeyExpects();
     EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(-1));
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
 
     unsigned char password[] = "pwd";
     EXPECT_EQ(store_->InitNewStore(password), -1);
 }
 
 TEST_F(StoreTest, InitNewStore_WriteHeaderFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-
-    EXPECT_CALL(*mock_crypto_ptr_, HashPassword(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    ValidWrapKeyExpects();
 
     EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-        .WillOnce(Return(-1)); // Invalid initial position for WriteHeader
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, KdfLanes()).WillOnce(Return(1));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS))).WillOnce(Return(false));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
     EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
 
     unsigned char password[] = "pwd";
     EXPECT_EQ(store_->InitNewStore(password), -1);
 }
 
+TEST_F(StoreTest, InitNewStore_SeveralKdfLanes_RecordsLaneCountInHeader) {
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    ValidWrapKeyExpects();
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, KdfLanes()).WillOnce(Return(4));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS)))
+        .WillOnce(Invoke([](std::span<const iovec> seg) {
+            EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[HEADER_PREFIX_LEN - 1],
+                      CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY | HEADER_KDF_LANES);
+            EXPECT_EQ(seg[5].iov_len, 1);
+            EXPECT_EQ(*static_cast<uint8_t *>(seg[5].iov_base), 4);
+            return true;
+        }));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->InitNewStore(password), 0);
+}
+
 // LoadStore
 TEST_F(StoreTest, LoadStore_NoData_ReturnsValid) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_TRUE(store_->CardsDisplayList().empty());
+}
+
+TEST_F(StoreTest, LoadStore_Data_ReturnsValidAndDecryptsOnlyDirectory) {
+    RecordDirectory directory;
+    directory.Add("Card1");
+    directory.Add("Card2");
+    uint64_t records_len = 2 * (card_formatted_.size() + record_added_bytes_);
+    uint64_t directory_len = encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + records_len));
+    ValidReadDirectoryExpects(directory, {{0, static_cast<uint32_t>(records_len / 2)},
+                                          {records_len / 2, static_cast<uint32_t>(records_len / 2)}});
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    auto cards_list = store_->CardsDisplayList();
+    ASSERT_EQ(cards_list.size(), 2);
+    EXPECT_EQ(cards_list[0], std::make_pair(0U, std::string("Card1")));
+    EXPECT_EQ(cards_list[1], std::make_pair(1U, std::string("Card2")));
+}
+
+// The key derivation only returns once the directory has been read, which deadlocks unless the read runs alongside it
+TEST_F(StoreTest, LoadStore_Data_ReadsDirectoryWhileKeyIsDerived) {
+    RecordDirectory directory;
+    directory.Add("Card1");
+    uint64_t records_len = card_formatted_.size() + record_added_bytes_;
+    uint64_t directory_len = encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+    std::vector<unsigned char> plain(directory.SerializedSize());
+    directory.Serialize(plain.data(), {{0, static_cast<uint32_t>(records_len)}});
+
+    std::promise<void> read;
+    std::future<void> read_done = read.get_future();
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects(directory_len);
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + records_len));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Invoke([&read](std::span<const iovec>) {
+        read.set_value();
+        return true;
+    }));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _))
+        .WillOnce(Invoke([&read_done](unsigned char *, size_t, const unsigned char *, const unsigned char *) {
+            return read_done.wait_for(std::chrono::seconds(10)) == std::future_status::ready ? 0 : -1;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptBufInPlace(_, _, _, directory_len - encryption_header_len_, _))
+        .WillOnce(Invoke([this, plain](unsigned char *buf, uint64_t *out_len, unsigned char *, uintmax_t,
+                                       const unsigned char *) {
+            memcpy(buf + encryption_in_place_offset_, plain.data(), plain.size());
+            *out_len = plain.size();
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_EQ(store_->CardsDisplayList().size(), 1);
+}
+
+TEST_F(StoreTest, LoadStore_DecryptDirectoryFails_ReturnsDataDecryptErr) {
+    uint64_t directory_len = 64;
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptBufInPlace(_, _, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_DECRYPT_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_WrappedKey_UnwrapsDataKeyUnderPasswordKey) {
+    ValidUnlockExpects(0, 0, true);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2); // password key, data key
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + wrapped_key_len_));
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+}
+
+// A wrong password fails the wrapped key's tag, so the password hash is never checked
+TEST_F(StoreTest, LoadStore_WrappedKeyFailsToOpen_ReturnsPwdVerifyErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects(0, true);
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).Times(0);
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "bad";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_PWD_VERIFY_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_WrappedKeyDerivationFails_ReturnsKeyDerivationErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects(0, true);
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_KEY_DERIVATION_ERR);
+}
+
+// The lane count byte follows the wrapped key and is handed to the crypto layer before the password key is derived
+TEST_F(StoreTest, LoadStore_KdfLanesInHeader_SetsLanesBeforeDerivingKey) {
+    uint8_t cipher_suite = CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY | HEADER_KDF_LANES;
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadPrefixExpects(cipher_suite);
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(HEADER_SEGMENTS - 1))).WillOnce(Invoke([](std::span<const iovec> seg) {
+        StoreLE64(static_cast<unsigned char *>(seg[2].iov_base), 0);
+        return true;
+    }));
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, 1)).WillOnce(Invoke([](char *buf, int64_t) {
+        *buf = 4;
+        return true;
+    }));
+    ::testing::Sequence sequence;
+    EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(4)).InSequence(sequence).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).InSequence(sequence).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+        .WillOnce(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                const unsigned char *, uint64_t, const unsigned char *) {
+            *out_len = encryption_key_len_;
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + wrapped_key_len_ + 1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+}
+
+TEST_F(StoreTest, LoadStore_KdfLanesUnsupported_ReturnsHeaderReadErr) {
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(1)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_HEADER_READ_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_Version1Directory_RebuildsMetadataFromRecords) {
+    uint32_t record_len = card_formatted_.size() + record_added_bytes_;
+    // version, next id, count, then one entry: id, offset, length, name length, name
+    std::vector<unsigned char> plain(9 + 18 + 5);
+    plain[0] = 1;
+    StoreLE32(plain.data() + 1, 1);
+    StoreLE32(plain.data() + 5, 1);
+    StoreLE32(plain.data() + 9, 0);
+    StoreLE64(plain.data() + 13, 0);
+    StoreLE32(plain.data() + 21, record_len);
+    StoreLE16(plain.data() + 25, 5);
+    memcpy(plain.data() + 27, "Card1", 5);
+    uint64_t directory_len = encryption_header_len_ + plain.size() + encryption_added_bytes_;
+
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + record_len));
+    ValidReadDirectoryExpects(plain);
+
+    // The one record is opened to fingerprint its number
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, record_len, header_len_ + directory_len)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, record_len, _, _, _))
+        .WillOnce(Invoke([this](unsigned char *out, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                const unsigned char *, uint64_t, const unsigned char *) {
+            memcpy(out, card_formatted_.data(), card_formatted_.size());
+            *out_len = card_formatted_.size();
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, RecordDirectory::FINGERPRINT_LEN, _, 16, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([](unsigned char *out, size_t out_len, const unsigned char *, uint64_t,
+                                  const unsigned char *) {
+            memset(out, 7, out_len);
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(3);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_EQ(store_->FindByNumber("4111111111111111"), (std::vector<uint32_t>{0}));
+}
+
+// Records in different segments are opened as separate tasks, and each entry gets the metadata of its own record
+TEST_F(StoreTest, LoadStore_Version1DirectoryTwoSegments_RebuildsEverySegment) {
+    uint32_t record_len = card_formatted_.size() + record_added_bytes_;
+    // version, next id, count, then two entries: id, offset, length, name length, name
+    std::vector<unsigned char> plain(9 + 2 * (18 + 5));
+    plain[0] = 1;
+    StoreLE32(plain.data() + 1, 257);
+    StoreLE32(plain.data() + 5, 2);
+    for (uint32_t i = 0; i < 2; ++i) {
+        unsigned char *entry = plain.data() + 9 + i * (18 + 5);
+        StoreLE32(entry, i * 256);
+        StoreLE64(entry + 4, i * record_len);
+        StoreLE32(entry + 12, record_len);
+        StoreLE16(entry + 16, 5);
+        memcpy(entry + 18, i == 0 ? "Card1" : "Card2", 5);
+    }
+    uint64_t directory_len = encryption_header_len_ + plain.size() + encryption_added_bytes_;
+
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + 2 * record_len));
+    ValidReadDirectoryExpects(plain);
+
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, record_len, header_len_ + directory_len)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, record_len, header_len_ + directory_len + record_len))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, record_len, _, _, _))
+        .Times(2)
+        .WillRepeatedly(Invoke([this](unsigned char *out, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                      const unsigned char *ad, uint64_t, const unsigned char *) {
+            std::string text = card_formatted_;
+            if (LoadLE32(ad) == 256) {
+                text.replace(text.find("4111111111111111"), 16, "5555555555554444");
+            }
+            memcpy(out, text.data(), text.size());
+            *out_len = text.size();
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, RecordDirectory::FINGERPRINT_LEN, _, 16, _))
+        .Times(3)
+        .WillRepeatedly(Invoke([](unsigned char *out, size_t out_len, const unsigned char *number, uint64_t,
+                                  const unsigned char *) {
+            memset(out, number[0], out_len);
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(4);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_EQ(store_->FindByNumber("5555555555554444"), (std::vector<uint32_t>{256}));
+}
+
+TEST_F(StoreTest, LoadStore_RecordOutsideFile_ReturnsDataReadErr) {
+    RecordDirectory directory;
+    directory.Add("Card1");
+    uint64_t directory_len = encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + 10));
+    ValidReadDirectoryExpects(directory, {{0, 11}});
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_READ_ERR);
+    EXPECT_TRUE(store_->CardsDisplayList().empty());
+}
+
+TEST_F(StoreTest, LoadStore_OpenReadFails_ReturnsOpenErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(-1));
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_OPEN_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_ReadHeaderFails_ReturnsReadErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadPrefixExpects(CIPHER_XCHACHA20POLY1305);
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(HEADER_SEGMENTS - 1))).WillOnce(Return(false));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_HEADER_READ_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_VerifyPasswordHashFails_ReturnsPwdVerifyErr) {
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_PWD_VERIFY_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_DeriveEncryptionKeyFails_ReturnsKeyDerivationErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_KEY_DERIVATION_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_DeriveSubkeyFails_ReturnsKeyDerivationErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
     ValidReadHeaderExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
     EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
     EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, 1, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, encryption_key_len_)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_KEY_DERIVATION_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_InvalidGetSize_ReturnsDataReadErr) {
+    ValidUnlockExpects(0, 0);
     EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
-    EXPECT_CALL(*mock_file_io_ptr_, GetSize(_)).WillOnce(Return(hash_len_ + salt_len_));
+
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(0));
     EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
 
     unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_READ_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_DirectoryPastEndOfFile_ReturnsDataReadErr) {
+    ValidUnlockExpects(0, 200);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+
+    // The prefetch cannot tell the header length yet, so it reads until the file ends short
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + 199));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Return(false));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_READ_ERR);
 }
 
-TEST_F(StoreTest, LoadStore_Data_ReturnsValid) {
+TEST_F(StoreTest, LoadStore_ReadDirectoryFails_ReturnsDataDecryptErr) {
+    uintmax_t directory_len = 64;
+    ValidUnlockExpects(0, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Return(false)); // Invalid read of the directory
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(directory_len + header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_DECRYPT_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_DataShorterThanEncryptionOverhead_ReturnsDataReadErr) {
+    ValidUnlockExpects(0, encryption_header_len_);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_READ_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_UnsupportedCipherSuite_ReturnsCipherSuiteErr) {
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(_)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_CIPHER_SUITE_ERR);
+}
+
+TEST_F(StoreTest, LoadStore_BackupGeneration_SavesAsLiveStore) {
+    ValidUnlockExpects(2, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password, 2), Store::LOAD_STORE_VALID);
+
+    // Nothing was edited, but the restored generation still has to be written back as the live store
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    ValidWriteHeaderExpects();
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, LoadStore_BaselineStoreWithAutosave_SchedulesOneSaveOfEveryCard) {
+    std::string text = card_formatted_ + "Card2,5500000000000004,222,11,2031;";
+    ValidLegacyUnlockExpects(text, 2);
+    store_->SetAutosave(60000, 60000);
+
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    std::shared_future<Store::SaveStoreStatus> save = store_->ScheduledSave();
+    ASSERT_TRUE(save.valid());
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    ValidSaveNewCardsExpects(2);
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+}
+
+// Stores from before the header magic are read whole and written in the current format by the next save
+TEST_F(StoreTest, LoadStore_BaselineStore_LoadsCardsAndSavesCurrentFormat) {
+    std::string text = card_formatted_ + "Card2,5500000000000004,222,11,2031;";
+    ValidLegacyUnlockExpects(text, 2);
+
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    std::vector<std::pair<uint32_t, std::string>> cards = store_->CardsDisplayList();
+    ASSERT_EQ(cards.size(), 2);
+    EXPECT_EQ(cards[0].second, "Card1");
+    EXPECT_EQ(cards[1].second, "Card2");
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, sizeof(uint32_t), _)).Times(2).WillRepeatedly(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 3)))
+        .WillOnce(Invoke([this](std::span<const iovec> seg) {
+            EXPECT_EQ(memcmp(seg[0].iov_base, HEADER_MAGIC, sizeof(HEADER_MAGIC)), 0);
+            EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[sizeof(HEADER_MAGIC)], HEADER_VERSION);
+            EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[HEADER_PREFIX_LEN - 1],
+                      CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY);
+            EXPECT_EQ(seg[4].iov_len, wrapped_key_len_);
+            return true;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, LoadStore_BaselineStoreWrongPassword_ReturnsPwdVerifyErr) {
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, HEADER_PREFIX_LEN)).WillOnce(Invoke([](char *buf, int64_t len) {
+        memcpy(buf, "$argon2id$", len);
+        return true;
+    }));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(hash_len_ + salt_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, _, _)).Times(2).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, SetKdfLanes(1)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).Times(0);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_PWD_VERIFY_ERR);
+}
+
+// SaveStore
+TEST_F(StoreTest, SaveStore_NoData_ReturnsValid) {
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStore_Data_ReturnsValid) {
+    CreditCard card;
+    store_->AddCard(card);
+    store_->AddCard(card);
+
+    // Both new records are sealed into one buffer and written as one segment
+    SaveNewCards(2);
+
+    // A second save with no edits in between has nothing to write
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStore_NewCardsInSeveralSegments_SealsEachOnce) {
+    CreditCard card;
+    for (int i = 0; i < 600; ++i) {
+        store_->AddCard(card);
+    }
+
+    // Three dirty segments are sealed concurrently into one buffer, which is still written as one segment
+    SaveNewCards(600);
+}
+
+TEST_F(StoreTest, SaveStore_StoredRecords_CarriedOverWithoutReencrypting) {
+    CreditCard card;
+    store_->AddCard(card);
+    store_->AddCard(card);
+    store_->AddCard(card);
+    SaveNewCards(3);
+    uint64_t record_len = card.FormatText().size() + record_added_bytes_;
+
+    RecordDirectory directory;
+    directory.Add(card.GetName());
+    directory.Add(card.GetName());
+    directory.Add(card.GetName());
+    uint64_t records_offset =
+        unhashed_header_len_ + encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    store_->DeleteCard(1);
+    store_->AddCard(card);
+
+    // The surviving records are copied straight from the current store, and only the new one is sealed
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    {
+        ::testing::InSequence in_order;
+        // records 0 and 2 are no longer adjacent, the new record comes from the sealed buffer
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 2))).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(records_offset, record_len)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(records_offset + 2 * record_len, record_len))
+            .WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(1))).WillOnce(Return(true));
+    }
     EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _))
-        .WillOnce(Return(true))
-        .WillOnce(Return(true))
-        .WillOnce(Return(true))
-        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStore_CleanSegments_CopiedWholeWithoutSealing) {
+    RecordDirectory directory;
+    directory.Add("Card1");
+    directory.Add("Card2");
+    uint64_t records_len = 2 * (card_formatted_.size() + record_added_bytes_);
+    uint64_t directory_len = encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    ValidUnlockExpects(1, directory_len);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len + records_len));
+    ValidReadDirectoryExpects(directory, {{0, static_cast<uint32_t>(records_len / 2)},
+                                          {records_len / 2, static_cast<uint32_t>(records_len / 2)}});
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password, 1), Store::LOAD_STORE_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // A restored generation has no edits, so its whole record region is one copy and nothing is sealed
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    ValidWriteDataExpects(0);
+    EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(header_len_ + directory_len, records_len)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStore_CopyToTempFails_ReturnsWriteDataErr) {
+    CreditCard card;
+    store_->AddCard(card);
+    store_->AddCard(card);
+    SaveNewCards(2);
+    store_->DeleteCard(0);
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    ValidWriteDataExpects(0);
+    EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(_, _)).WillOnce(Return(false));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0)).WillOnce(Return(hash_len_ + salt_len_));
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_WRITE_DATA_ERR);
+}
 
-    uintmax_t store_data_size = 200;
-    EXPECT_CALL(*mock_file_io_ptr_, GetSize(_)).WillOnce(Return(store_data_size + hash_len_ + salt_len_));
+TEST_F(StoreTest, SaveStore_OpenWriteTempFails_ReturnsOpenErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(-1));
+    EXPECT_EQ(Store::SAVE_STORE_OPEN_ERR, store_->SaveStore());
+}
+
+TEST_F(StoreTest, SaveStore_WriteHeaderFails_ReturnsHeaderErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    store_->DeleteCard(0); // an empty store only writes the header
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS))).WillOnce(Return(false));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_HEADER_ERR);
+}
+
+TEST_F(StoreTest, SaveStore_EncryptRecordFails_ReturnsWriteDataErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_WRITE_DATA_ERR);
+}
+
+TEST_F(StoreTest, SaveStore_WriteDataFails_ReturnsWriteDataErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).WillOnce(Return(0));
+
+    // EncryptBufInPlace call fails in WriteData
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_WRITE_DATA_ERR);
+}
+
+TEST_F(StoreTest, SaveStore_CommitTempFails_ReturnsCommitTempErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).WillOnce(Return(0));
+    ValidWriteDataExpects(1);
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(-1));
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_COMMIT_TEMP_ERR);
+}
+
+TEST_F(StoreTest, SaveStore_ReopenFails_ReturnsReopenErr) {
+    CreditCard card;
+    store_->AddCard(card);
+
+    ValidSaveNewCardsExpects(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(-1));
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_REOPEN_ERR);
+
+    // The save was committed, so there is nothing left to write
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+// SaveStoreAsync
+TEST_F(StoreTest, SaveStoreAsync_NoData_ReturnsReadyValid) {
+    std::shared_future<Store::SaveStoreStatus> save = store_->SaveStoreAsync();
+    ASSERT_EQ(save.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStoreAsync_NewCards_ReadFileSwitchedOnFinish) {
+    CreditCard card;
+    store_->AddCard(card);
+    store_->AddCard(card);
+
+    ValidSaveNewCardsExpects(2);
+    EXPECT_EQ(store_->SaveStoreAsync().get(), Store::SAVE_STORE_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // Reads only move to the committed store once the main thread collects the save
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SaveStoreAsync_CardAddedAfterSnapshot_StaysUnsaved) {
+    CreditCard card;
+    store_->AddCard(card);
+    ValidSaveNewCardsExpects(1);
+    std::shared_future<Store::SaveStoreStatus> save = store_->SaveStoreAsync();
+    store_->AddCard(card);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    RecordDirectory directory;
+    directory.Add(card.GetName());
+    uint64_t record_len = card.FormatText().size() + record_added_bytes_;
+    uint64_t records_offset =
+        unhashed_header_len_ + encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    // The first card is copied from the committed store and only the second is sealed
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, DecryptBuf(_, _, _, _, _, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).WillOnce(Return(encryption_in_place_offset_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    {
+        ::testing::InSequence in_order;
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 2))).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, CopyToTemp(records_offset, record_len)).WillOnce(Return(true));
+        EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(1))).WillOnce(Return(true));
+    }
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
     EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+// While the first save is held in its commit, the two later requests share one save of the newest snapshot, which
+// seals all three cards again since the first save has not been applied yet
+TEST_F(StoreTest, SaveStoreAsync_RequestsWhileSaving_Coalesce) {
+    std::promise<void> committing;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).Times(2).WillRepeatedly(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillRepeatedly(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, _, _, _, _)).Times(4).WillRepeatedly(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionInPlaceOffset()).Times(2).WillRepeatedly(Return(1));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).Times(2).WillRepeatedly(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).Times(2).WillRepeatedly(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 3))).Times(2).WillRepeatedly(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(6);
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(2);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp())
+        .WillOnce(Invoke([&committing, released] {
+            committing.set_value();
+            released.wait();
+            return 0;
+        }))
+        .WillOnce(Return(0));
+
+    CreditCard card;
+    store_->AddCard(card);
+    std::shared_future<Store::SaveStoreStatus> first = store_->SaveStoreAsync();
+    committing.get_future().wait();
+    store_->AddCard(card);
+    std::shared_future<Store::SaveStoreStatus> second = store_->SaveStoreAsync();
+    store_->AddCard(card);
+    std::shared_future<Store::SaveStoreStatus> third = store_->SaveStoreAsync();
+    EXPECT_EQ(second.wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+    EXPECT_EQ(third.wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+    release.set_value();
+
+    EXPECT_EQ(first.get(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(second.get(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(third.get(), Store::SAVE_STORE_VALID);
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+
+    // Everything was in the last snapshot saved
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+// SetAutosave
+TEST_F(StoreTest, SetAutosave_BurstOfChanges_SavedOnce) {
+    store_->SetAutosave(60000, 60000);
+    CreditCard card;
+    store_->AddCard(card);
+    store_->AddCard(card);
+    store_->AddCard(card);
+    store_->DeleteCard(1);
+    std::shared_future<Store::SaveStoreStatus> save = store_->ScheduledSave();
+    ASSERT_TRUE(save.valid());
+    EXPECT_EQ(save.wait_for(std::chrono::seconds(0)), std::future_status::timeout);
+
+    // The save is still waiting out its window, so finishing writes the whole burst at once
+    ValidSaveNewCardsExpects(2);
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SetAutosave_WindowPasses_SavesInBackground) {
+    auto elapsed = SetFakeAutosaveClock();
+    store_->SetAutosave(10, 60000);
+    ValidSaveNewCardsExpects(1);
+    CreditCard card;
+    store_->AddCard(card);
+    std::shared_future<Store::SaveStoreStatus> save = store_->ScheduledSave();
+    EXPECT_EQ(save.wait_for(std::chrono::milliseconds(20)), std::future_status::timeout);
+
+    *elapsed = std::chrono::milliseconds(10);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SetAutosave_ChangesWithinWindow_SavedByMaxUnsaved) {
+    auto elapsed = SetFakeAutosaveClock();
+    store_->SetAutosave(60000, 10);
+    ValidSaveNewCardsExpects(2);
+    CreditCard card;
+    store_->AddCard(card);
+    *elapsed = std::chrono::milliseconds(5);
+    store_->AddCard(card);
+
+    // The second change would push the save a window back, but max_unsaved holds it to 10 ms after the first
+    *elapsed = std::chrono::milliseconds(10);
+    EXPECT_EQ(store_->ScheduledSave().get(), Store::SAVE_STORE_VALID);
+
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SetAutosave_MarkUsed_SavesInBackground) {
+    CreditCard card;
+    store_->AddCard(card);
+    auto elapsed = SetFakeAutosaveClock();
+    store_->SetAutosave(10, 60000);
+    ASSERT_FALSE(store_->ScheduledSave().valid());
+
+    ValidSaveNewCardsExpects(1);
+    store_->MarkUsed(0);
+    std::shared_future<Store::SaveStoreStatus> save = store_->ScheduledSave();
+    ASSERT_TRUE(save.valid());
+    *elapsed = std::chrono::milliseconds(10);
+    EXPECT_EQ(save.get(), Store::SAVE_STORE_VALID);
+
+    ValidApplySaveExpects();
+    EXPECT_EQ(store_->FinishSaves(), Store::SAVE_STORE_VALID);
+}
+
+TEST_F(StoreTest, SetAutosave_Off_NothingScheduled) {
+    CreditCard card;
+    store_->AddCard(card);
+    EXPECT_FALSE(store_->ScheduledSave().valid());
+}
+
+// ChangePassword
+TEST_F(StoreTest, ChangePassword_NotLoaded_ReturnsVerifyErr) {
+    unsigned char password[] = "pwd";
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_VERIFY_ERR);
+}
+
+TEST_F(StoreTest, ChangePassword_WrongPassword_ReturnsVerifyErr) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(-1));
+
+    unsigned char password[] = "bad";
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_VERIFY_ERR);
+}
+
+TEST_F(StoreTest, ChangePassword_SavedStore_RewritesOnlyHeader) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+
+    // The directory and records follow the old header unchanged; no record is decrypted or sealed
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+
+    unsigned char password[] = "pwd";
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // The header now carries the wrapped key in place of the password hash, and the new password unwraps it
+    ValidChangePasswordExpects(directory_len, unhashed_header_len_ + wrapped_key_len_, directory_len + records_len,
+                               true);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_EQ(store_->ChangePassword(new_password, password), Store::CHANGE_PASSWORD_VALID);
+}
+
+TEST_F(StoreTest, ChangePassword_WrappedKeyWrongPassword_ReturnsVerifyErr) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->ChangePassword(password, password), Store::CHANGE_PASSWORD_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // The wrapped key fails to open, and nothing is derived or written for the new password
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).Times(0);
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
 
-    unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    unsigned char bad_password[] = "bad";
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(bad_password, new_password), Store::CHANGE_PASSWORD_VERIFY_ERR);
 }
 
-TEST_F(StoreTest, LoadStore_OpenReadFails_ReturnsOpenErr) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(-1));
+TEST_F(StoreTest, ChangePassword_CommitTempFails_KeepsCurrentHeader) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(-1));
 
     unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_OPEN_ERR);
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_WRITE_ERR);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_VALID);
 }
 
-TEST_F(StoreTest, LoadStore_ReadHeaderFails_ReturnsReadErr) {
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
+TEST_F(StoreTest, ChangePassword_ReopenFails_KeepsNewHeader) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead).WillOnce(Return(-1)); // Invalid position ReadHeader fails
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
     EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(-1));
 
     unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_HEADER_READ_ERR);
+    unsigned char new_password[] = "new";
+    EXPECT_EQ(store_->ChangePassword(password, new_password), Store::CHANGE_PASSWORD_REOPEN_ERR);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // The committed header is the one kept: the new password unwraps its key
+    ValidChangePasswordExpects(directory_len, unhashed_header_len_ + wrapped_key_len_, directory_len + records_len,
+                               true);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    EXPECT_EQ(store_->ChangePassword(new_password, password), Store::CHANGE_PASSWORD_VALID);
 }
 
-TEST_F(StoreTest, LoadStore_VerifyPasswordHashFails_ReturnsPwdVerifyErr) {
-    // Uses WillRepeatedly because of calls in helper functions
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+// Key slots
+TEST_F(StoreTest, LoadStore_KeySlots_OpensWithExtraSlot) {
+    ValidReadKeySlotsExpects();
+    ValidSlotPasswordKeysExpects(true);
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+        .Times(::testing::Between(1, 2))
+        .WillRepeatedly(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                      const unsigned char *, uint64_t, const unsigned char *password_key) {
+            *out_len = encryption_key_len_;
+            return password_key[0] == EXTRA_SLOT_KEY_BYTE ? 0 : -1;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead())
+        .WillOnce(Return(header_len_ + wrapped_key_len_ + 1 + key_slot_len_));
+
+    unsigned char password[] = "slot";
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    EXPECT_EQ(store_->KeySlotCount(), 2);
+}
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    ValidReadHeaderExpects();
-    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(-1));
+TEST_F(StoreTest, LoadStore_KeySlots_NoSlotOpens_ReturnsPwdVerifyErr) {
+    ValidReadKeySlotsExpects();
+    ValidSlotPasswordKeysExpects(false);
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).Times(0);
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+        .Times(2)
+        .WillRepeatedly(Return(-1));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
     EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
 
-    unsigned char password[] = "pwd";
+    unsigned char password[] = "bad";
     EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_PWD_VERIFY_ERR);
 }
 
-TEST_F(StoreTest, LoadStore_DeriveEncryptionKeyFails_ReturnsKeyDerivationErr) {
-    // Uses WillRepeatedly because of calls in helper functions
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+TEST_F(StoreTest, AddKeySlot_UnwrappedStore_ReturnsUnwrappedErr) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    ValidReadHeaderExpects();
     EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(-1));
-    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
 
     unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_KEY_DERIVATION_ERR);
+    unsigned char new_password[] = "slot";
+    EXPECT_EQ(store_->AddKeySlot(password, new_password), Store::KEY_SLOT_UNWRAPPED_ERR);
+    EXPECT_EQ(store_->KeySlotCount(), 1);
 }
 
-TEST_F(StoreTest, LoadStore_InvalidGetSize_ReturnsDataReadErr) {
+TEST_F(StoreTest, AddKeySlot_SavedStore_RewritesHeaderWithSlot) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+    ValidChangePasswordExpects(directory_len, header_len_, directory_len + records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->ChangePassword(password, password), Store::CHANGE_PASSWORD_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // The slot records the limits it was derived with, and the directory and records are carried over untouched
+    ValidVerifyWrappedPasswordExpects();
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
-
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    ValidReadHeaderExpects();
-    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
-
-    EXPECT_CALL(*mock_file_io_ptr_, GetSize(_)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, KdfOpsLimit()).WillOnce(Return(ops_limit_));
+    EXPECT_CALL(*mock_crypto_ptr_, KdfMemLimit()).WillOnce(Return(mem_limit_));
+    EXPECT_CALL(*mock_crypto_ptr_, GenerateSalt(_)).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKeyWithLimits(_, encryption_key_len_, _, _, ops_limit_, mem_limit_))
+        .WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptRecord(_, _, encryption_key_len_, _, salt_len_, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(3);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS)))
+        .WillOnce(Invoke([this](std::span<const iovec> seg) {
+            EXPECT_EQ(static_cast<uint8_t *>(seg[0].iov_base)[HEADER_PREFIX_LEN - 1],
+                      CIPHER_XCHACHA20POLY1305 | HEADER_WRAPPED_KEY | HEADER_KEY_SLOTS);
+            EXPECT_EQ(seg[6].iov_len, 1 + key_slot_len_);
+            const auto *slots = static_cast<const unsigned char *>(seg[6].iov_base);
+            EXPECT_EQ(slots[0], 1);
+            EXPECT_EQ(LoadLE64(slots + 1), ops_limit_);
+            EXPECT_EQ(LoadLE64(slots + 1 + sizeof(uint64_t)), mem_limit_);
+            return true;
+        }));
+    EXPECT_CALL(*mock_file_io_ptr_,
+                CopyToTemp(unhashed_header_len_ + wrapped_key_len_, directory_len + records_len))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
     EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
 
-    unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_READ_ERR);
-}
+    unsigned char new_password[] = "slot";
+    EXPECT_EQ(store_->AddKeySlot(password, new_password), Store::KEY_SLOT_VALID);
+    EXPECT_EQ(store_->KeySlotCount(), 2);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
 
-TEST_F(StoreTest, LoadStore_ReadDataFails_ReturnsDataDecryptErr) {
+    // With an extra slot the password is tried against every slot; the extra one may be skipped once slot 0 opens
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, encryption_key_len_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKeyWithLimits(_, _, _, _, _, _))
+        .Times(::testing::AtMost(1))
+        .WillRepeatedly(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+        .WillOnce(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                const unsigned char *, uint64_t, const unsigned char *) {
+            *out_len = encryption_key_len_;
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+    EXPECT_EQ(store_->RemoveKeySlot(password, 2), Store::KEY_SLOT_NOT_FOUND_ERR);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+}
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenRead()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0)).WillOnce(Return(hash_len_ + salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _))
-        .WillOnce(Return(true))
-        .WillOnce(Return(true))
-        .WillOnce(Return(true))
-        .WillOnce(Return(false)); // Invalid read for ReadData
-    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(2);
+// Key cache
+TEST_F(StoreTest, LoadStore_KeyCache_CachesDataKeyAndWrappedKey) {
+    auto key_cache = std::make_shared<::testing::NaggyMock<MockKeyCache>>();
+    store_->SetKeyCache(key_cache, 300);
 
-    uintmax_t store_data_size = 64;
-    EXPECT_CALL(*mock_file_io_ptr_, GetSize(_)).WillOnce(Return(store_data_size + hash_len_ + salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    ValidUnlockExpects(0, 0, true);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + wrapped_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+    EXPECT_CALL(*key_cache, Put(StartsWith("walletcache:"), _, encryption_key_len_ + wrapped_key_len_, 300))
+        .WillOnce(Return(0));
 
     unsigned char password[] = "pwd";
-    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_DATA_DECRYPT_ERR);
-}
-
-// SaveStore
-TEST_F(StoreTest, SaveStore_NoData_ReturnsValid) {
-    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
 }
 
-TEST_F(StoreTest, SaveStore_Data_ReturnsValid) {
-    CreditCard card;
-    store_->AddCard(card);
+TEST_F(StoreTest, LoadCachedStore_EntryMatchesHeader_SkipsKdf) {
+    auto key_cache = std::make_shared<::testing::NaggyMock<MockKeyCache>>();
+    store_->SetKeyCache(key_cache, 300);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    // The wrapped key read from the header is all zeros, as is the one cached after the data key
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects(0, true);
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+    EXPECT_CALL(*key_cache, Get(StartsWith("walletcache:"), _, encryption_key_len_ + wrapped_key_len_))
+        .WillOnce(Invoke([](const std::string &, unsigned char *data, size_t len) {
+            memset(data, 0, len);
+            return static_cast<int64_t>(len);
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).Times(0);
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).Times(0);
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + wrapped_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(::testing::AnyNumber());
+
+    EXPECT_EQ(store_->LoadCachedStore(), Store::LOAD_STORE_VALID);
+}
 
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-        .WillOnce(Return(0))
-        .WillOnce(Return(hash_len_ + salt_len_))
-        .WillOnce(
-            Return(hash_len_ + salt_len_ + encryption_header_len_ + TestGetCardsSize() + encryption_added_bytes_));
-    EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(0));
+TEST_F(StoreTest, LoadCachedStore_WrappedKeyChanged_ReturnsPwdVerifyErr) {
+    auto key_cache = std::make_shared<::testing::NaggyMock<MockKeyCache>>();
+    store_->SetKeyCache(key_cache, 300);
 
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionKeyLen()).WillRepeatedly(Return(encryption_key_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+    ValidReadHeaderExpects(0, true);
+    EXPECT_CALL(*mock_crypto_ptr_, SetCipherSuite(CIPHER_XCHACHA20POLY1305)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, wrapped_key_len_)).WillOnce(Return(true));
+    EXPECT_CALL(*key_cache, Get(_, _, encryption_key_len_ + wrapped_key_len_))
+        .WillOnce(Invoke([](const std::string &, unsigned char *data, size_t len) {
+            memset(data, 1, len);
+            return static_cast<int64_t>(len);
+        }));
     EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
-    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
-    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
 
-    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_VALID);
+    EXPECT_EQ(store_->LoadCachedStore(), Store::LOAD_STORE_PWD_VERIFY_ERR);
 }
 
-TEST_F(StoreTest, SaveStore_OpenWriteTempFails_ReturnsOpenErr) {
-    CreditCard card;
-    store_->AddCard(card);
-
-    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(-1));
-    EXPECT_EQ(Store::SAVE_STORE_OPEN_ERR, store_->SaveStore());
+TEST_F(StoreTest, LoadCachedStore_NoKeyCache_ReturnsPwdVerifyErr) {
+    EXPECT_EQ(store_->LoadCachedStore(), Store::LOAD_STORE_PWD_VERIFY_ERR);
 }
 
-TEST_F(StoreTest, SaveStore_WriteHeaderFails_ReturnsHeaderErr) {
-    CreditCard card;
-    store_->AddCard(card);
+// RotateDataKey
+TEST_F(StoreTest, RotateDataKey_WrongPassword_ReturnsVerifyErr) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-        .WillOnce(Return(-1)); // Invalid initial position for WriteHeader
-    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    EXPECT_CALL(*mock_crypto_ptr_, VerifyPasswordHash(_, _)).WillOnce(Return(-1));
 
-    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_HEADER_ERR);
+    unsigned char password[] = "bad";
+    EXPECT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_VERIFY_ERR);
+    EXPECT_FALSE(store_->KeyRotationStarted());
 }
 
-TEST_F(StoreTest, SaveStore_WriteDataFails_ReturnsWriteDataErr) {
+// The extra slots wrap the current key and cannot be wrapped again without their passwords, so nothing is started
+TEST_F(StoreTest, RotateDataKey_ExtraKeySlots_ReturnsSlotsErr) {
+    ValidReadKeySlotsExpects();
+    ValidSlotPasswordKeysExpects(true);
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, wrapped_key_len_, _, salt_len_, _))
+        .Times(::testing::Between(1, 2))
+        .WillRepeatedly(Invoke([this](unsigned char *, uint64_t *out_len, const unsigned char *, uintmax_t,
+                                      const unsigned char *, uint64_t, const unsigned char *password_key) {
+            *out_len = encryption_key_len_;
+            return password_key[0] == EXTRA_SLOT_KEY_BYTE ? 0 : -1;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveSubkey(_, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead())
+        .WillOnce(Return(unhashed_header_len_ + wrapped_key_len_ + 1 + key_slot_len_));
+    unsigned char password[] = "slot";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    EXPECT_CALL(*mock_crypto_ptr_, DeriveEncryptionKey(_, _, _, _)).Times(0);
+    EXPECT_CALL(*mock_crypto_ptr_, GenerateKey(_)).Times(0);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).Times(0);
+
+    EXPECT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_SLOTS_ERR);
+    EXPECT_FALSE(store_->KeyRotationStarted());
+    EXPECT_EQ(store_->KeySlotCount(), 2);
+}
+
+TEST_F(StoreTest, RotateDataKey_SavedStore_ResealsRecordsBehindNewHeader) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+
+    ValidRotateDataKeyExpects(directory_len, records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
+
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_VALID);
+    EXPECT_TRUE(store_->KeyRotationStarted());
+    EXPECT_EQ(store_->FinishKeyRotation(), Store::ROTATE_KEY_VALID);
+    EXPECT_FALSE(store_->KeyRotationStarted());
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
+
+    // The record is now read from behind the header with its wrapped key and without the password hash
+    ValidReadRecordExpects(unhashed_header_len_ + wrapped_key_len_ + directory_len, records_len);
     CreditCard card;
-    store_->AddCard(card);
+    EXPECT_EQ(store_->GetCardById(0, &card), 0);
+    EXPECT_EQ(card.GetName(), "Card1");
+}
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
-    ValidWriteHeaderExpects();
+TEST_F(StoreTest, RotateDataKey_CommitTempFails_KeepsCurrentKey) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
 
-    // EncryptBuf call fails in WriteData
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(-1));
+    ValidRotateDataKeyExpects(directory_len, records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(-1));
 
-    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_VALID);
+    EXPECT_EQ(store_->FinishKeyRotation(), Store::ROTATE_KEY_WRITE_ERR);
+    ::testing::Mock::VerifyAndClearExpectations(mock_crypto_ptr_);
+    ::testing::Mock::VerifyAndClearExpectations(mock_file_io_ptr_);
 
-    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_WRITE_DATA_ERR);
+    ValidReadRecordExpects(header_len_ + directory_len, records_len);
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(0, &card), 0);
 }
 
-TEST_F(StoreTest, SaveStore_CommitTempFails_ReturnsCommitTempErr) {
-    CreditCard card;
-    store_->AddCard(card);
+// A record longer than the rotation's chunk is rotated through a chunk of its own length
+TEST_F(StoreTest, RotateDataKey_RecordLongerThanChunk_Resealed) {
+    card_formatted_ = std::string(ROTATION_CHUNK_LEN, 'C') + ",4111111111111111,111,10,2030;";
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+    ASSERT_GT(records_len, ROTATION_CHUNK_LEN);
 
-    EXPECT_CALL(*mock_file_io_ptr_, OpenWriteTemp()).WillOnce(Return(0));
+    ValidRotateDataKeyExpects(directory_len, records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(0));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
 
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp())
-        .WillOnce(Return(0))
-        .WillOnce(Return(hash_len_ + salt_len_))
-        .WillOnce(
-            Return(hash_len_ + salt_len_ + encryption_header_len_ + TestGetCardsSize() + encryption_added_bytes_));
-    EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0))
-        .WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(0));
+    unsigned char password[] = "pwd";
+    EXPECT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_VALID);
+    EXPECT_EQ(store_->FinishKeyRotation(), Store::ROTATE_KEY_VALID);
+}
 
-    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
-    EXPECT_CALL(*mock_file_io_ptr_, CloseWriteTemp()).Times(1);
-    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Return(-1));
+// The rotation is held at its commit while a card is deleted and another added, neither of which waits for it; the
+// deleted card is skipped once it ends and the added one is fingerprinted again under the new key
+TEST_F(StoreTest, RotateDataKey_CardsChangedWhileRunning_KeptAfterFinish) {
+    uint64_t directory_len = 0;
+    uint64_t records_len = 0;
+    LoadOneRecord(&directory_len, &records_len);
+
+    std::promise<void> reached;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    ValidRotateDataKeyExpects(directory_len, records_len);
+    EXPECT_CALL(*mock_file_io_ptr_, CommitTemp()).WillOnce(Invoke([&reached, released] {
+        reached.set_value();
+        released.wait();
+        return 0;
+    }));
+    EXPECT_CALL(*mock_file_io_ptr_, CloseRead()).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, OpenRead(0)).WillOnce(Return(0));
 
-    EXPECT_EQ(store_->SaveStore(), Store::SAVE_STORE_COMMIT_TEMP_ERR);
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->RotateDataKey(password), Store::ROTATE_KEY_VALID);
+    reached.get_future().wait();
+    EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, _, _, _, _)).Times(2).WillRepeatedly(Return(0));
+
+    store_->DeleteCard(0);
+    CreditCard card;
+    card.SetName("Card2");
+    card.SetCardNumber("5555555555554444");
+    EXPECT_EQ(store_->AddCard(card), Store::ADD_CARD_VALID);
+    EXPECT_FALSE(store_->KeyRotationDone());
+
+    release.set_value();
+    EXPECT_EQ(store_->FinishKeyRotation(), Store::ROTATE_KEY_VALID);
+    std::vector<std::pair<uint32_t, std::string>> cards = store_->CardsDisplayList();
+    ASSERT_EQ(cards.size(), 1);
+    EXPECT_EQ(cards[0].first, 1);
+    EXPECT_EQ(cards[0].second, "Card2");
 }
 
 // AddCard
@@ -540,7 +2052,8 @@ TEST_F(StoreTest, GetCardById_OnlyCard_ReturnsCorrectCard) {
     card1.SetName("Card1");
 
     store_->AddCard(card1);
-    auto card = store_->GetCardById(0);
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(0, &card), 0);
 
     EXPECT_EQ(card.FormatText(), card1.FormatText());
 }
@@ -549,115 +2062,336 @@ TEST_F(StoreTest, GetCardById_SelectSecondFromThreeCards_ReturnsCorrectCard) {
     CreditCard card1;
     card1.SetName("Card1");
     CreditCard card2;
-    card1.SetName("Card2");
+    card2.SetName("Card2");
     CreditCard card3;
-    card1.SetName("Card3");
+    card3.SetName("Card3");
 
     store_->AddCard(card1);
     store_->AddCard(card2);
     store_->AddCard(card3);
-    auto card = store_->GetCardById(1);
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(1, &card), 0);
 
     EXPECT_EQ(card.FormatText(), card2.FormatText());
 }
 
-// ReadHeader
-TEST_F(StoreTest, ReadHeader_Valid_Returns0) {
-    ValidReadHeaderExpects();
+TEST_F(StoreTest, GetCardById_UnknownId_ReturnsNegative1) {
+    CreditCard card1;
+    store_->AddCard(card1);
+    store_->DeleteCard(0);
 
-    unsigned char hash[hash_len_];
-    unsigned char salt[salt_len_];
-    EXPECT_EQ(TestReadHeader(hash, salt), 0);
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(0, &card), -1);
+    EXPECT_EQ(store_->GetCardById(1, &card), -1);
 }
 
-TEST_F(StoreTest, ReadHeader_InvalidInitialReadPos_ReturnsNegative1) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(-1));
+TEST_F(StoreTest, GetCardById_StoredCard_ReadsAndDecryptsOneRecord) {
+    CreditCard card1;
+    card1.SetName("Card1");
+    CreditCard card2;
+    card2.SetName("Card2");
+    card2.SetCardNumber("4111111111111111");
+    card2.SetCvv("111");
+    card2.SetMonth("10");
+    card2.SetYear("2030");
+    store_->AddCard(card1);
+    store_->AddCard(card2);
+    SaveNewCards(2);
+    uint64_t record1_len = card1.FormatText().size() + record_added_bytes_;
+    uint64_t record2_len = card2.FormatText().size() + record_added_bytes_;
+
+    RecordDirectory directory;
+    directory.Add(card1.GetName());
+    directory.Add(card2.GetName());
+    uint64_t records_offset =
+        unhashed_header_len_ + encryption_header_len_ + directory.SerializedSize() + encryption_added_bytes_;
+
+    // Only the second record is read, and it is opened with its id as the associated data
+    std::string text = card2.FormatText();
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, record2_len, records_offset + record1_len)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, record2_len, _, sizeof(uint32_t), _))
+        .WillOnce(Invoke([&](unsigned char *out, uint64_t *out_len, const unsigned char *, uintmax_t,
+                             const unsigned char *ad, uint64_t, const unsigned char *) {
+            EXPECT_EQ(LoadLE32(ad), 1);
+            memcpy(out, text.data(), text.size());
+            *out_len = text.size();
+            return 0;
+        }));
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
 
-    unsigned char hash[hash_len_];
-    unsigned char salt[salt_len_];
-    EXPECT_EQ(TestReadHeader(hash, salt), -1);
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(1, &card), 0);
+    EXPECT_EQ(card.FormatText(), card2.FormatText());
 }
 
-TEST_F(StoreTest, ReadHeader_HashReadFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0));
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(false));
+TEST_F(StoreTest, GetCardById_StoredRecordFailsToOpen_ReturnsNegative1) {
+    CreditCard card1;
+    store_->AddCard(card1);
+    SaveNewCards(1);
+
+    EXPECT_CALL(*mock_crypto_ptr_, RecordAddedBytes()).WillRepeatedly(Return(record_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadAt(_, _, _)).WillOnce(Return(true));
+    EXPECT_CALL(*mock_crypto_ptr_, DecryptRecord(_, _, _, _, _, _, _)).WillOnce(Return(-1));
+
+    CreditCard card;
+    EXPECT_EQ(store_->GetCardById(0, &card), -1);
+}
+
+// FindByName + FindByNamePrefix + FindByNumber
+TEST_F(StoreTest, FindBy_IndexesFollowAddAndDelete) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    // The mock fingerprint folds the number into the output
+    EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, RecordDirectory::FINGERPRINT_LEN, _, _, _))
+        .WillRepeatedly(Invoke([](unsigned char *out, size_t out_len, const unsigned char *in, uint64_t in_len,
+                                  const unsigned char *) {
+            memset(out, 0, out_len);
+            for (uint64_t i = 0; i < in_len; ++i) {
+                out[i % out_len] ^= in[i];
+            }
+            return 0;
+        }));
+
+    CreditCard visa;
+    visa.SetName("Work Visa");
+    visa.SetCardNumber("4111111111111111");
+    CreditCard mastercard;
+    mastercard.SetName("Travel");
+    mastercard.SetCardNumber("5555555555554444");
+    CreditCard visa2;
+    visa2.SetName("work visa 2");
+    visa2.SetCardNumber("4012888888881881");
+    store_->AddCard(visa);
+    store_->AddCard(mastercard);
+    store_->AddCard(visa2);
+
+    EXPECT_EQ(store_->FindByName("WORK VISA"), (std::vector<uint32_t>{0}));
+    EXPECT_EQ(store_->FindByNamePrefix("work"), (std::vector<uint32_t>{0, 2}));
+    EXPECT_EQ(store_->FindByNumber("4111111111111111"), (std::vector<uint32_t>{0}));
+    EXPECT_EQ(store_->FindByNumber("5555555555554444"), (std::vector<uint32_t>{1}));
+
+    store_->DeleteCard(0);
+    EXPECT_TRUE(store_->FindByName("work visa").empty());
+    EXPECT_EQ(store_->FindByNamePrefix("work"), (std::vector<uint32_t>{2}));
+    EXPECT_TRUE(store_->FindByNumber("4111111111111111").empty());
+}
+
+// FindByExpiry + FindExpired + CardsByExpiry
+TEST_F(StoreTest, FindByExpiry_IndexFollowsAddAndDelete) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    const std::vector<std::pair<std::string, std::string>> expiries = {
+        {"10", "2030"}, {"1", "2025"}, {"12", "2026"}, {"1", "2025"}};
+    for (const auto &[month, year] : expiries) {
+        CreditCard card;
+        card.SetMonth(month);
+        card.SetYear(year);
+        store_->AddCard(card);
+    }
+    store_->AddCard(CreditCard());
+
+    uint16_t current = CreditCard::PackExpiry(1, 2026);
+    EXPECT_EQ(store_->CardsByExpiry(), (std::vector<uint32_t>{1, 3, 2, 0}));
+    EXPECT_EQ(store_->FindExpired(current), (std::vector<uint32_t>{1, 3}));
+    EXPECT_EQ(store_->FindByExpiry(current, current + 11), (std::vector<uint32_t>{2}));
+    EXPECT_EQ(store_->CardsDisplayList(store_->FindExpired(current)).size(), 2);
+
+    store_->DeleteCard(1);
+    EXPECT_EQ(store_->FindExpired(current), (std::vector<uint32_t>{3}));
+    EXPECT_EQ(store_->CardsDisplayList({1, 3}).size(), 1);
+}
+
+// FilterCards
+TEST_F(StoreTest, FilterCards_IndexFollowsAddAndDelete) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    const std::vector<std::vector<std::string>> tags = {{"team1", "travel"}, {"team1"}, {"Travel"}};
+    for (const std::vector<std::string> &card_tags : tags) {
+        CreditCard card;
+        card.SetTags(card_tags);
+        store_->AddCard(card);
+    }
+
+    const CardFilter travel = {.all_tags = {"travel"}, .any_tags = {}, .none_tags = {}, .networks = {}};
+    EXPECT_EQ(store_->FilterCards(travel), (std::vector<uint32_t>{0, 2}));
+    EXPECT_EQ(
+        store_->FilterCards({.all_tags = {"team1"}, .any_tags = {}, .none_tags = {"travel"}, .networks = {}}),
+        (std::vector<uint32_t>{1}));
+
+    store_->DeleteCard(0);
+    EXPECT_EQ(store_->FilterCards(travel), (std::vector<uint32_t>{2}));
+    EXPECT_EQ(store_->CardsDisplayList(store_->FilterCards({})).size(), 2);
+}
+
+// CardsDisplayList + MarkUsed
+TEST_F(StoreTest, CardsDisplayList_OrdersFollowAddDeleteAndUse) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    for (const char *name : {"travel", "Bills", "groceries"}) {
+        CreditCard card;
+        card.SetName(name);
+        store_->AddCard(card);
+    }
+
+    using Names = std::vector<std::pair<uint32_t, std::string>>;
+    EXPECT_EQ(store_->CardsDisplayList(CardOrders::ORDER_NAME), (Names{{1, "Bills"}, {2, "groceries"}, {0, "travel"}}));
+    EXPECT_EQ(store_->CardsDisplayList(CardOrders::ORDER_CREATED), store_->CardsDisplayList());
+
+    store_->MarkUsed(2);
+    store_->MarkUsed(0);
+    EXPECT_EQ(store_->CardsDisplayList(CardOrders::ORDER_LAST_USED),
+              (Names{{0, "travel"}, {2, "groceries"}, {1, "Bills"}}));
+
+    store_->DeleteCard(0);
+    EXPECT_EQ(store_->CardsDisplayList(CardOrders::ORDER_LAST_USED), (Names{{2, "groceries"}, {1, "Bills"}}));
+    EXPECT_EQ(store_->CardsDisplayList(CardOrders::ORDER_NAME), (Names{{1, "Bills"}, {2, "groceries"}}));
+}
+
+TEST_F(StoreTest, AddCard_DuplicateNumber_ReturnsDuplicateUntilDeleted) {
+    ValidUnlockExpects(0, 0);
+    EXPECT_CALL(*mock_crypto_ptr_, Memzero(_, _)).Times(1);
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    unsigned char password[] = "pwd";
+    ASSERT_EQ(store_->LoadStore(password), Store::LOAD_STORE_VALID);
+
+    EXPECT_CALL(*mock_crypto_ptr_, KeyedHash(_, RecordDirectory::FINGERPRINT_LEN, _, _, _))
+        .WillRepeatedly(Invoke([](unsigned char *out, size_t out_len, const unsigned char *in, uint64_t,
+                                  const unsigned char *) {
+            memset(out, in[0], out_len);
+            return 0;
+        }));
+
+    CreditCard card;
+    card.SetName("Card1");
+    card.SetCardNumber("4111111111111111");
+    CreditCard copy;
+    copy.SetName("Card2");
+    copy.SetCardNumber("4111111111111111");
+    EXPECT_EQ(store_->AddCard(card), Store::ADD_CARD_VALID);
+    EXPECT_EQ(store_->AddCard(copy), Store::ADD_CARD_DUPLICATE);
+    EXPECT_EQ(store_->CardsDisplayList().size(), 1);
+
+    store_->DeleteCard(0);
+    EXPECT_EQ(store_->AddCard(copy), Store::ADD_CARD_VALID);
+}
+
+// ReadHeader
+TEST_F(StoreTest, ReadHeader_Valid_Returns0) {
+    ValidReadHeaderExpects(123);
 
     unsigned char hash[hash_len_];
     unsigned char salt[salt_len_];
-    EXPECT_EQ(TestReadHeader(hash, salt), -1);
+    uint8_t cipher_suite;
+    uint64_t directory_len;
+    bool legacy = true;
+    EXPECT_EQ(TestReadHeader(hash, salt, &cipher_suite, &directory_len, &legacy), 0);
+    EXPECT_EQ(directory_len, 123);
+    EXPECT_EQ(cipher_suite, CIPHER_XCHACHA20POLY1305);
+    EXPECT_FALSE(legacy);
 }
 
-TEST_F(StoreTest, ReadHeader_SaltReadFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0));
+TEST_F(StoreTest, ReadHeader_ReadFails_ReturnsNegative1) {
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillOnce(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillOnce(Return(salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(false));
+    ValidReadPrefixExpects(CIPHER_XCHACHA20POLY1305);
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(HEADER_SEGMENTS - 1))).WillOnce(Return(false));
 
     unsigned char hash[hash_len_];
     unsigned char salt[salt_len_];
-    EXPECT_EQ(TestReadHeader(hash, salt), -1);
+    uint8_t cipher_suite;
+    uint64_t directory_len;
+    bool legacy;
+    EXPECT_EQ(TestReadHeader(hash, salt, &cipher_suite, &directory_len, &legacy), -1);
 }
 
-TEST_F(StoreTest, ReadHeader_InvalidFinalReadPos_ReturnsNegative1) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionRead()).WillOnce(Return(0)).WillOnce(Return(-1));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
+// A store from before the header magic starts with its password hash; nothing past the prefix is read
+TEST_F(StoreTest, ReadHeader_NoMagic_ReportsLegacy) {
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, HEADER_PREFIX_LEN)).WillOnce(Invoke([](char *buf, int64_t len) {
+        memcpy(buf, "$argon2id$", len);
+        return true;
+    }));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(_)).Times(0);
 
     unsigned char hash[hash_len_];
     unsigned char salt[salt_len_];
-    EXPECT_EQ(TestReadHeader(hash, salt), -1);
+    uint8_t cipher_suite;
+    uint64_t directory_len;
+    bool legacy = false;
+    EXPECT_EQ(TestReadHeader(hash, salt, &cipher_suite, &directory_len, &legacy), 0);
+    EXPECT_TRUE(legacy);
 }
 
-// ReadData
-TEST_F(StoreTest, ReadData_DataSize0_Returns0) {
-    ValidReadDataExpects();
+TEST_F(StoreTest, ReadHeader_NewerVersion_ReturnsNegative1) {
+    EXPECT_CALL(*mock_file_io_ptr_, Read(_, HEADER_PREFIX_LEN)).WillOnce(Invoke([](char *buf, int64_t) {
+        memcpy(buf, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+        buf[sizeof(HEADER_MAGIC)] = HEADER_VERSION + 1;
+        buf[sizeof(HEADER_MAGIC) + 1] = CIPHER_XCHACHA20POLY1305;
+        return true;
+    }));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(_)).Times(0);
 
-    uintmax_t data_size = 0;
-    unsigned char decrypted_data[data_size];
-    uint64_t dec_data_size;
-    EXPECT_EQ(TestReadData(decrypted_data, data_size, &dec_data_size), 0);
+    unsigned char hash[hash_len_];
+    unsigned char salt[salt_len_];
+    uint8_t cipher_suite;
+    uint64_t directory_len;
+    bool legacy;
+    EXPECT_EQ(TestReadHeader(hash, salt, &cipher_suite, &directory_len, &legacy), -1);
 }
 
-TEST_F(StoreTest, ReadData_LargeDataSize_Returns0) {
-    ValidReadDataExpects();
+// PrefetchDirectory
+TEST_F(StoreTest, PrefetchDirectory_NoDirectory_ReadsNothing) {
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(_)).Times(0);
 
-    uintmax_t data_size = 1000000;
-    unsigned char decrypted_data[data_size];
-    uint64_t dec_data_size;
-    EXPECT_EQ(TestReadData(decrypted_data, data_size, &dec_data_size), 0);
+    EXPECT_EQ(TestPrefetchDirectory(0), Store::LOAD_STORE_DATA_READ_ERR);
 }
 
-TEST_F(StoreTest, ReadData_EncryptionHeaderReadFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(false));
+TEST_F(StoreTest, PrefetchDirectory_DirectoryLongerThanFile_ReadsNothing) {
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(100));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(_)).Times(0);
 
-    uintmax_t data_size = 16;
-    unsigned char decrypted_data[data_size];
-    uint64_t dec_data_size;
-    EXPECT_EQ(TestReadData(decrypted_data, data_size, &dec_data_size), -1);
+    EXPECT_EQ(TestPrefetchDirectory(101), Store::LOAD_STORE_DATA_READ_ERR);
 }
 
-TEST_F(StoreTest, ReadData_EncryptedDataReadFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(false));
-
-    uintmax_t data_size = 16;
-    unsigned char decrypted_data[data_size];
-    uint64_t dec_data_size;
-    EXPECT_EQ(TestReadData(decrypted_data, data_size, &dec_data_size), -1);
+TEST_F(StoreTest, PrefetchDirectory_ValidDirectory_ReadsEncryptionHeaderAndBody) {
+    uint64_t directory_len = 1000000;
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + directory_len));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2)))
+        .WillOnce(Invoke([this, directory_len](std::span<const iovec> seg) {
+            EXPECT_EQ(seg[0].iov_len, encryption_header_len_);
+            EXPECT_EQ(seg[1].iov_len, directory_len - encryption_header_len_);
+            return true;
+        }));
+
+    EXPECT_EQ(TestPrefetchDirectory(directory_len), Store::LOAD_STORE_VALID);
 }
 
-TEST_F(StoreTest, ReadData_DecryptBufFails_ReturnsNegative1) {
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(hash_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, Read(_, _)).WillOnce(Return(true)).WillOnce(Return(true));
-    EXPECT_CALL(*mock_crypto_ptr_, DecryptBuf(_, _, _, _, _, _)).WillOnce(Return(-1));
+TEST_F(StoreTest, PrefetchDirectory_ReadFails_ReturnsDataDecryptErr) {
+    EXPECT_CALL(*mock_file_io_ptr_, GetSizeRead()).WillOnce(Return(header_len_ + 64));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillRepeatedly(Return(encryption_header_len_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_file_io_ptr_, ReadV(SizeIs(2))).WillOnce(Return(false));
 
-    uintmax_t data_size = 16;
-    unsigned char decrypted_data[data_size];
-    uint64_t dec_data_size;
-    EXPECT_EQ(TestReadData(decrypted_data, data_size, &dec_data_size), -1);
+    EXPECT_EQ(TestPrefetchDirectory(64), Store::LOAD_STORE_DATA_DECRYPT_ERR);
 }
 
 // WriteHeader
@@ -677,18 +2411,9 @@ TEST_F(StoreTest, WriteHeader_TestData_Returns0) {
     EXPECT_EQ(TestWriteHeader(hash, salt), 0);
 }
 
-TEST_F(StoreTest, WriteHeader_InvalidInitialWritePos_ReturnsNegative1) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp()).WillOnce(Return(-1));
-
-    const auto *hash = reinterpret_cast<const unsigned char *>("test");
-    const auto *salt = reinterpret_cast<const unsigned char *>("test");
-    EXPECT_EQ(TestWriteHeader(hash, salt), -1);
-}
-
-TEST_F(StoreTest, WriteHeader_InvalidFinalWritePos_Returns0) {
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp()).WillOnce(Return(0)).WillOnce(Return(-1));
-
-    EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _)).WillOnce(Return(0)).WillOnce(Return(0));
+TEST_F(StoreTest, WriteHeader_WriteFails_ReturnsNegative1) {
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS))).WillOnce(Return(false));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
 
@@ -699,102 +2424,53 @@ TEST_F(StoreTest, WriteHeader_InvalidFinalWritePos_Returns0) {
 
 // WriteData
 TEST_F(StoreTest, WriteData_NoData_Returns0) {
-    unsigned char dec_data[0];
+    const auto *hash = reinterpret_cast<const unsigned char *>("test");
+    const auto *salt = reinterpret_cast<const unsigned char *>("test");
+    unsigned char dec_data[encryption_added_bytes_];
     uintmax_t dec_data_size = 0;
 
-    ValidWriteDataExpects(dec_data_size);
+    ValidWriteDataExpects(0);
 
-    EXPECT_EQ(TestWriteData(dec_data, dec_data_size), 0);
+    EXPECT_EQ(TestWriteData(hash, salt, dec_data, dec_data_size), 0);
 }
 
 TEST_F(StoreTest, WriteData_TestData_Returns0) {
+    const auto *hash = reinterpret_cast<const unsigned char *>("test");
+    const auto *salt = reinterpret_cast<const unsigned char *>("test");
     uint64_t dec_data_size = 10;
-    unsigned char dec_data[dec_data_size];
+    unsigned char dec_data[dec_data_size + encryption_added_bytes_];
 
-    ValidWriteDataExpects(dec_data_size);
+    ValidWriteDataExpects(0);
 
-    EXPECT_EQ(TestWriteData(dec_data, dec_data_size), 0);
+    EXPECT_EQ(TestWriteData(hash, salt, dec_data, dec_data_size), 0);
 }
 
 TEST_F(StoreTest, WriteData_EncryptionFails_ReturnsNegative1) {
+    const auto *hash = reinterpret_cast<const unsigned char *>("test");
+    const auto *salt = reinterpret_cast<const unsigned char *>("test");
     uint64_t dec_data_size = 10;
-    unsigned char dec_data[dec_data_size];
+    unsigned char dec_data[dec_data_size + encryption_added_bytes_];
 
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(-1));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(-1));
 
-    EXPECT_EQ(TestWriteData(dec_data, dec_data_size), -1);
+    EXPECT_EQ(TestWriteData(hash, salt, dec_data, dec_data_size), -1);
 }
 
-TEST_F(StoreTest, WriteData_InvalidWriteTempPos_ReturnsNegative1) {
+TEST_F(StoreTest, WriteData_WriteFails_ReturnsNegative1) {
+    const auto *hash = reinterpret_cast<const unsigned char *>("test");
+    const auto *salt = reinterpret_cast<const unsigned char *>("test");
     uint64_t dec_data_size = 10;
-    unsigned char dec_data[dec_data_size];
+    unsigned char dec_data[dec_data_size + encryption_added_bytes_];
 
     EXPECT_CALL(*mock_crypto_ptr_, EncryptionHeaderLen()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_header_len_));
-    EXPECT_CALL(*mock_crypto_ptr_, EncryptBuf(_, _, _, _, _)).WillOnce(Return(0));
-
-    EXPECT_CALL(*mock_file_io_ptr_, WriteTemp(_, _)).WillOnce(Return(0)).WillOnce(Return(0));
-
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptionAddedBytes()).WillOnce(Return(encryption_added_bytes_));
+    EXPECT_CALL(*mock_crypto_ptr_, EncryptBufInPlace(_, _, _, _)).WillOnce(Return(0));
+    EXPECT_CALL(*mock_crypto_ptr_, GetCipherSuite()).WillOnce(Return(CIPHER_XCHACHA20POLY1305));
     EXPECT_CALL(*mock_crypto_ptr_, HashLen()).WillRepeatedly(Return(hash_len_));
     EXPECT_CALL(*mock_crypto_ptr_, SaltLen()).WillRepeatedly(Return(salt_len_));
-    EXPECT_CALL(*mock_file_io_ptr_, GetPositionWriteTemp()).WillOnce(Return(-1));
-
-    EXPECT_EQ(TestWriteData(dec_data, dec_data_size), -1);
-}
-
-// GetCardsSize
-TEST_F(StoreTest, GetCardsSize_NoCards_Returns0) { EXPECT_EQ(TestGetCardsSize(), 0); }
-
-TEST_F(StoreTest, GetCardsSize_OneCard_ReturnsLoadedStringSize) {
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(one_card_formatted_.c_str())));
-    EXPECT_EQ(TestGetCardsSize(), one_card_formatted_.size());
-}
-
-TEST_F(StoreTest, GetCardsSize_TwoCards_ReturnsLoadedStringSize) {
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(two_cards_formatted_.c_str())));
-    EXPECT_EQ(TestGetCardsSize(), two_cards_formatted_.size());
-}
-
-// CardsFormatted
-TEST_F(StoreTest, CardsFormatted_NoCards_Returns0) {
-    unsigned char cards[10];
-    cards[0] = 0;
-
-    EXPECT_EQ(TestCardsFormatted(cards), 0);
-}
-
-TEST_F(StoreTest, CardsFormatted_OneCard_ReturnsCardsSizeAndLoadedString) {
-    std::string card_formatted_cpy = one_card_formatted_;
-    unsigned char cards[card_formatted_cpy.size()];
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(card_formatted_cpy.c_str())));
-
-    EXPECT_EQ(TestCardsFormatted(cards), one_card_formatted_.size());
-    EXPECT_EQ(memcmp(cards, one_card_formatted_.c_str(), one_card_formatted_.size()), 0);
-}
-
-TEST_F(StoreTest, CardsFormatted_TwoCards_ReturnsCardsSizeAndLoadedString) {
-    std::string cards_formatted_cpy = two_cards_formatted_;
-    unsigned char cards[cards_formatted_cpy.size()];
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(cards_formatted_cpy.c_str())));
-
-    EXPECT_EQ(TestCardsFormatted(cards), two_cards_formatted_.size());
-    EXPECT_EQ(memcmp(cards, two_cards_formatted_.c_str(), two_cards_formatted_.size()), 0);
-}
-
-// LoadCards
-TEST_F(StoreTest, LoadCards_EmptyData_ExpectCardsSize0) {
-    TestLoadCards(nullptr);
-    EXPECT_EQ(TestGetCardsSize(), 0);
-}
-
-TEST_F(StoreTest, LoadCards_OneCard_ExpectOneCardsSize) {
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(one_card_formatted_.c_str())));
-    EXPECT_EQ(TestGetCardsSize(), one_card_formatted_.size());
-}
+    EXPECT_CALL(*mock_file_io_ptr_, WriteTempV(SizeIs(HEADER_SEGMENTS + 2))).WillOnce(Return(false));
 
-TEST_F(StoreTest, LoadCards_OneCard_ExpectTwoCardsSize) {
-    TestLoadCards(const_cast<unsigned char *>(reinterpret_cast<const unsigned char *>(two_cards_formatted_.c_str())));
-    EXPECT_EQ(TestGetCardsSize(), two_cards_formatted_.size());
+    EXPECT_EQ(TestWriteData(hash, salt, dec_data, dec_data_size), -1);
 }
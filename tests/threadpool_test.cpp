@@ -0,0 +1,42 @@
+#include "threadpool.hpp"
+
+#include <atomic>
+#include <gtest/gtest.h>
+
+TEST(ThreadPoolTest, Wait_AfterSubmit_EveryTaskHasRun) {
+    ThreadPool pool(4);
+    std::atomic<int> ran = 0;
+    for (int i = 0; i < 100; ++i) {
+        pool.Submit([&ran] { ++ran; });
+    }
+    pool.Wait();
+    EXPECT_EQ(ran, 100);
+}
+
+TEST(ThreadPoolTest, Wait_NoTasks_ReturnsImmediately) {
+    ThreadPool pool(2);
+    pool.Wait();
+    EXPECT_EQ(pool.Size(), 2);
+}
+
+TEST(ThreadPoolTest, Wait_Reused_RunsLaterTasks) {
+    ThreadPool pool(2);
+    std::atomic<int> ran = 0;
+    pool.Submit([&ran] { ++ran; });
+    pool.Wait();
+    pool.Submit([&ran] { ++ran; });
+    pool.Submit([&ran] { ++ran; });
+    pool.Wait();
+    EXPECT_EQ(ran, 3);
+}
+
+TEST(ThreadPoolTest, Destructor_QueuedTasks_RunBeforeExit) {
+    std::atomic<int> ran = 0;
+    {
+        ThreadPool pool(1);
+        for (int i = 0; i < 10; ++i) {
+            pool.Submit([&ran] { ++ran; });
+        }
+    }
+    EXPECT_EQ(ran, 10);
+}
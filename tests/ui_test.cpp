@@ -169,6 +169,12 @@ void ExpectProfileMenuOutput(const std::string &output) {
     EXPECT_NE(output.find(UIStrings::PROFILE_MENU_LIST), std::string::npos);
     EXPECT_NE(output.find(UIStrings::PROFILE_MENU_ADD), std::string::npos);
     EXPECT_NE(output.find(UIStrings::PROFILE_MENU_DELETE), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_EXPIRING), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_FILTER), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_CHANGE_PASSWORD), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_ROTATE_KEY), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_ADD_KEY_SLOT), std::string::npos);
+    EXPECT_NE(output.find(UIStrings::PROFILE_MENU_REMOVE_KEY_SLOT), std::string::npos);
 }
 
 TEST_F(UITest, ProfileMenu_InputExit) {
@@ -219,6 +225,66 @@ TEST_F(UITest, ProfileMenu_InputDelete) {
     EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_DEL);
 }
 
+TEST_F(UITest, ProfileMenu_InputExpiring) {
+    UI ui;
+    std::string error_msg;
+    input_stream_ << "4\n";
+
+    UI::ProfileMenuOption selection = ui.ProfileMenu(error_msg);
+
+    std::string output = output_stream_.str();
+    ExpectProfileMenuOutput(output);
+    EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_EXPIRING);
+}
+
+TEST_F(UITest, ProfileMenu_InputFilter) {
+    UI ui;
+    std::string error_msg;
+    input_stream_ << "5\n";
+
+    UI::ProfileMenuOption selection = ui.ProfileMenu(error_msg);
+
+    std::string output = output_stream_.str();
+    ExpectProfileMenuOutput(output);
+    EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_FILTER);
+}
+
+TEST_F(UITest, ProfileMenu_InputChangePassword) {
+    UI ui;
+    std::string error_msg;
+    input_stream_ << "6\n";
+
+    UI::ProfileMenuOption selection = ui.ProfileMenu(error_msg);
+
+    std::string output = output_stream_.str();
+    ExpectProfileMenuOutput(output);
+    EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_CHANGE_PASSWORD);
+}
+
+TEST_F(UITest, ProfileMenu_InputRotateKey) {
+    UI ui;
+    std::string error_msg;
+    input_stream_ << "7\n";
+
+    UI::ProfileMenuOption selection = ui.ProfileMenu(error_msg);
+
+    std::string output = output_stream_.str();
+    ExpectProfileMenuOutput(output);
+    EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_ROTATE_KEY);
+}
+
+TEST_F(UITest, ProfileMenu_InputRemoveKeySlot) {
+    UI ui;
+    std::string error_msg;
+    input_stream_ << "9\n";
+
+    UI::ProfileMenuOption selection = ui.ProfileMenu(error_msg);
+
+    std::string output = output_stream_.str();
+    ExpectProfileMenuOutput(output);
+    EXPECT_EQ(selection, UI::ProfileMenuOption::OPT_PROFILE_REMOVE_KEY_SLOT);
+}
+
 TEST_F(UITest, ProfileMenu_InputWithErrorMessage) {
     UI ui;
     std::string error_msg = "ERR: Test Error!";
@@ -281,6 +347,34 @@ TEST_F(UITest, CardListMenu_TwoCards_InputSecondCard) {
     EXPECT_EQ(selection, 1);
 }
 
+TEST_F(UITest, CardListMenu_WithOrderLabel_InputNextOrderKey) {
+    UI ui;
+    const std::vector<std::pair<uint32_t, std::string>> test_list = {
+        std::make_pair(0, "Card 1"),
+    };
+    input_stream_ << UIStrings::LIST_CARDS_NEXT_ORDER_KEY << "\n";
+
+    int selection = ui.CardListMenu(test_list, UIStrings::ORDER_NAME_LABEL);
+
+    EXPECT_NE(output_stream_.str().find(UIStrings::LIST_CARDS_NEXT_ORDER + UIStrings::ORDER_NAME_LABEL),
+              std::string::npos);
+    EXPECT_EQ(selection, UI::CARD_LIST_NEXT_ORDER);
+}
+
+TEST_F(UITest, CardListMenu_WithoutOrderLabel_RejectsNextOrderKey) {
+    UI ui;
+    const std::vector<std::pair<uint32_t, std::string>> test_list = {
+        std::make_pair(0, "Card 1"),
+    };
+    input_stream_ << UIStrings::LIST_CARDS_NEXT_ORDER_KEY << "\n1\n";
+
+    int selection = ui.CardListMenu(test_list);
+
+    EXPECT_EQ(output_stream_.str().find(UIStrings::LIST_CARDS_NEXT_ORDER), std::string::npos);
+    EXPECT_NE(output_stream_.str().find(UIStrings::REQUEST_VALID_INPUT), std::string::npos);
+    EXPECT_EQ(selection, 0);
+}
+
 // CardInfoMenu
 void CardInfoMenuExpectOptions(const std::string &output) {
     EXPECT_NE(output.find(UIStrings::CARD_INFO_RETURN), std::string::npos);
@@ -419,6 +513,20 @@ TEST_F(UITest, CardInfoMenu_FieldsVisibleAndSelectFieldSeven_ReturnsCopyAndField
     EXPECT_EQ(selected_field, 4); 
 }
 
+// KeySlotRemoveMenu
+TEST_F(UITest, KeySlotRemoveMenu_ThreeSlots_InputSecondSlot) {
+    UI ui;
+    input_stream_ << "2\n";
+
+    int selection = ui.KeySlotRemoveMenu(3);
+
+    std::string output = output_stream_.str();
+    EXPECT_NE(output.find(UIStrings::REMOVE_KEY_SLOT_RETURN), std::string::npos);
+    EXPECT_NE(output.find("[2] " + UIStrings::KEY_SLOT_LABEL + "2"), std::string::npos);
+    EXPECT_EQ(output.find("[3]"), std::string::npos);
+    EXPECT_EQ(selection, 2);
+}
+
 // DisplayHashing
 TEST_F(UITest, DisplayHashing_ShowsCorrectMessage) {
     UI ui;
@@ -583,6 +691,33 @@ TEST_F(UITest, PromptCardNumber_InputWithErrorMessage) {
     EXPECT_EQ(number, "1111111111111111");
 }
 
+// PromptCardTags
+TEST_F(UITest, PromptCardTags_InputTags) {
+    UI ui;
+    std::string error_msg;
+    std::string tags;
+    input_stream_ << "travel team1\n";
+
+    ui.PromptCardTags(error_msg, tags);
+
+    EXPECT_NE(output_stream_.str().find(UIStrings::CARD_TAGS_PROMPT), std::string::npos);
+    EXPECT_EQ(tags, "travel team1");
+}
+
+TEST_F(UITest, PromptCardTags_InputWithErrorMessage) {
+    UI ui;
+    std::string error_msg = "ERR: Test Error!";
+    std::string tags;
+    input_stream_ << "\n";
+
+    ui.PromptCardTags(error_msg, tags);
+
+    std::string output = output_stream_.str();
+    EXPECT_NE(output.find(UIStrings::CARD_TAGS_PROMPT), std::string::npos);
+    EXPECT_NE(output.find("ERR: Test Error!"), std::string::npos);
+    EXPECT_EQ(tags, "");
+}
+
 // PromptCardYear
 TEST_F(UITest, PromptCardYear_InputYear) {
     UI ui;
@@ -622,6 +757,18 @@ TEST_F(UITest, PromptCardYear_InputWithErrorMessage) {
     EXPECT_EQ(year, "1000");
 }
 
+// PromptFilterTags
+TEST_F(UITest, PromptFilterTags_InputTags) {
+    UI ui;
+    std::string tags;
+    input_stream_ << "team1 -archived\n";
+
+    ui.PromptFilterTags(tags);
+
+    EXPECT_NE(output_stream_.str().find(UIStrings::FILTER_TAGS_PROMPT), std::string::npos);
+    EXPECT_EQ(tags, "team1 -archived");
+}
+
 // PromptLogin
 TEST_F(UITest, PromptLogin_InputPassword) {
     UI ui;